@@ -0,0 +1,165 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <string>
+#include "sqlite_db.h"
+
+//######################################################################
+
+/*
+ * Column access benchmark: the std::map<FieldName, int> lookup SqlRows
+ * used to do (reproduced here over the raw statement), against the
+ * ColumnIndex lookup by name and against ColumnRef handles.
+ */
+
+//######################################################################
+
+struct FieldName {
+	const char* field;
+	FieldName(const char* cstr)
+		:field(cstr)
+	{}
+};
+
+inline bool operator<(const FieldName& fieldNameL, const FieldName& fieldNameR) {
+	return std::strcmp(fieldNameL.field, fieldNameR.field) < 0;
+}
+
+// lookup as done before: find, then operator[]
+int mapFindKey(std::map<FieldName, int>& fieldNames, const char* field){
+	if(fieldNames.find(field)!=fieldNames.end()){
+		return fieldNames[field];
+	}
+	throw "Key not found.";
+}
+
+std::map<FieldName, int> mapFieldNames(sqlite3_stmt* statement){
+	std::map<FieldName, int> fieldNames;
+	for (int i = 0; i < sqlite3_column_count(statement); i++) {
+		fieldNames[sqlite3_column_name(statement, i)] = i;
+	}
+	return fieldNames;
+}
+
+//######################################################################
+
+class BenchDB : public SQLiteDB
+{
+	public:
+		using SQLiteDB::SQLiteDB;
+
+		sqlite3* handle(){
+			return m_DB;
+		}
+};
+
+//######################################################################
+
+const int NUM_ROWS=200000;
+const int NUM_QUERIES=100000;
+const char* SELECT_ALL="select ID, Name, Age, Address, Salary, Code from COMPANY";
+const char* SELECT_ONE="select ID, Name, Age, Address, Salary, Code from COMPANY where ID=?";
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start){
+	return std::chrono::duration<double, std::milli>(Clock::now()-start).count();
+}
+
+void report(const char* name, double ms, int n, long long checksum){
+	std::cout<<name<<": "<<ms<<" ms, "<<static_cast<long long>(n/(ms/1000.0))<<" per second (checksum "<<checksum<<")\n";
+}
+
+//######################################################################
+
+int main() {
+	BenchDB dbConnection(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+
+	dbConnection.executeQuery("CREATE TABLE COMPANY(ID INT PRIMARY KEY NOT NULL, Name TEXT NOT NULL, Age INT NOT NULL, Address CHAR(50), Salary REAL, Code INT)");
+	dbConnection.executeQuery("BEGIN");
+	for(int i=0; i<NUM_ROWS; i++){
+		dbConnection.executeSecureQueryNf("insert into COMPANY values (?,?,?,?,?,?)", i, "name", 20+i%50, "address", 10.5+i%100, i%7);
+	}
+	dbConnection.executeQuery("COMMIT");
+
+	std::cout<<"* * * * * * * Row loop ("<<NUM_ROWS<<" rows, 4 columns per row) * * * * * * *\n";
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		sqlite3_stmt* statement;
+		sqlite3_prepare_v2(dbConnection.handle(), SELECT_ALL, -1, &statement, nullptr);
+		std::map<FieldName, int> fieldNames=mapFieldNames(statement);
+		while(SQLITE_ROW==sqlite3_step(statement)){
+			checksum+=sqlite3_column_int(statement, mapFindKey(fieldNames, "ID"));
+			checksum+=sqlite3_column_int(statement, mapFindKey(fieldNames, "Age"));
+			checksum+=static_cast<long long>(sqlite3_column_double(statement, mapFindKey(fieldNames, "Salary")));
+			checksum+=sqlite3_column_int(statement, mapFindKey(fieldNames, "Code"));
+		}
+		sqlite3_finalize(statement);
+		report("std::map by name ", elapsedMs(start), NUM_ROWS, checksum);
+	}
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		while(rows.yield()){
+			checksum+=rows.as_int("ID");
+			checksum+=rows.as_int("Age");
+			checksum+=static_cast<long long>(rows.as_double("Salary"));
+			checksum+=rows.as_int("Code");
+		}
+		report("ColumnIndex by name", elapsedMs(start), NUM_ROWS, checksum);
+	}
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		ColumnRef id=rows.column("ID");
+		ColumnRef age=rows.column("Age");
+		ColumnRef salary=rows.column("Salary");
+		ColumnRef code=rows.column("Code");
+		while(rows.yield()){
+			checksum+=rows.as_int(id);
+			checksum+=rows.as_int(age);
+			checksum+=static_cast<long long>(rows.as_double(salary));
+			checksum+=rows.as_int(code);
+		}
+		report("ColumnRef          ", elapsedMs(start), NUM_ROWS, checksum);
+	}
+
+	std::cout<<"\n* * * * * * * Point queries ("<<NUM_QUERIES<<" queries, one row each) * * * * * * *\n";
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		for(int i=0; i<NUM_QUERIES; i++){
+			sqlite3_stmt* statement;
+			sqlite3_prepare_v2(dbConnection.handle(), SELECT_ONE, -1, &statement, nullptr);
+			sqlite3_bind_int(statement, 1, i);
+			std::map<FieldName, int> fieldNames=mapFieldNames(statement);
+			while(SQLITE_ROW==sqlite3_step(statement)){
+				checksum+=sqlite3_column_int(statement, mapFindKey(fieldNames, "Age"));
+			}
+			sqlite3_finalize(statement);
+		}
+		report("std::map, prepare per query", elapsedMs(start), NUM_QUERIES, checksum);
+	}
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		for(int i=0; i<NUM_QUERIES; i++){
+			SqlRows rows=dbConnection.executeSecureQueryNf(SELECT_ONE, i);
+			while(rows.yield()){
+				checksum+=rows.as_int("Age");
+			}
+		}
+		report("ColumnIndex, cached stmt   ", elapsedMs(start), NUM_QUERIES, checksum);
+	}
+
+	return 0;
+}
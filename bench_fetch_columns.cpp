@@ -0,0 +1,88 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "sqlite_db.h"
+
+//######################################################################
+
+/*
+ * Columnar fetch benchmark: filling per column vectors with the per cell
+ * accessors in a SqlRows::yield() loop, against SqlRows::fetchColumns
+ * with a reused ColumnBatch, for several batch sizes.
+ */
+
+//######################################################################
+
+const int NUM_ROWS=500000;
+const char* SELECT_ALL="select ID, Name, Age, Address, Salary, Code from COMPANY";
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedMs(Clock::time_point start){
+	return std::chrono::duration<double, std::milli>(Clock::now()-start).count();
+}
+
+void report(const std::string& name, double ms, int n, long long checksum){
+	std::cout<<name<<": "<<ms<<" ms, "<<static_cast<long long>(n/(ms/1000.0))<<" rows per second (checksum "<<checksum<<")\n";
+}
+
+//######################################################################
+
+int main() {
+	SQLiteDB dbConnection(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+
+	dbConnection.executeQuery("CREATE TABLE COMPANY(ID INT PRIMARY KEY NOT NULL, Name TEXT NOT NULL, Age INT NOT NULL, Address CHAR(50), Salary REAL, Code INT)");
+	std::vector<std::tuple<int, std::string, int, std::string, double, int>> data;
+	data.reserve(NUM_ROWS);
+	for(int i=0; i<NUM_ROWS; i++){
+		data.emplace_back(i, "name "+std::to_string(i), 20+i%50, "address "+std::to_string(i%1000), 10.5+i%100, i%7);
+	}
+	dbConnection.executeMany("insert into COMPANY values (?,?,?,?,?,?)", data);
+	data.clear();
+
+	std::cout<<"* * * * * * * Fetch "<<NUM_ROWS<<" rows, 6 columns * * * * * * *\n";
+
+	{
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		std::vector<sqlite3_int64> id, age, code;
+		std::vector<double> salary;
+		std::vector<std::string> name, address;
+		while(rows.yield()){
+			id.push_back(rows.as_int64(ColumnRef(0)));
+			name.emplace_back(rows.as_string_view(ColumnRef(1)));
+			age.push_back(rows.as_int64(ColumnRef(2)));
+			address.emplace_back(rows.as_string_view(ColumnRef(3)));
+			salary.push_back(rows.as_double(ColumnRef(4)));
+			code.push_back(rows.as_int64(ColumnRef(5)));
+		}
+		for(size_t i=0; i<id.size(); i++){
+			checksum+=id[i]+age[i]+code[i]+static_cast<long long>(salary[i])+name[i].size()+address[i].size();
+		}
+		report("per cell accessors    ", elapsedMs(start), NUM_ROWS, checksum);
+	}
+
+	for(size_t batchSize : {256, 4096, 65536}){
+		long long checksum=0;
+		Clock::time_point start=Clock::now();
+		SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		ColumnBatch batch;
+		while(rows.fetchColumns(batch, batchSize)>0){
+			const ColumnBatch::Column& id=batch.column(0);
+			const ColumnBatch::Column& name=batch.column(1);
+			const ColumnBatch::Column& age=batch.column(2);
+			const ColumnBatch::Column& address=batch.column(3);
+			const ColumnBatch::Column& salary=batch.column(4);
+			const ColumnBatch::Column& code=batch.column(5);
+			for(size_t i=0; i<batch.rows(); i++){
+				checksum+=id.integers[i]+age.integers[i]+code.integers[i]+static_cast<long long>(salary.reals[i]);
+				checksum+=name.offsets[i+1]-name.offsets[i]+address.offsets[i+1]-address.offsets[i];
+			}
+		}
+		report("fetchColumns, batch "+std::to_string(batchSize)+std::string(6-std::to_string(batchSize).size(), ' '), elapsedMs(start), NUM_ROWS, checksum);
+	}
+
+	return 0;
+}
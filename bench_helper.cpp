@@ -0,0 +1,445 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "sqlite_db.h"
+
+//######################################################################
+
+/*
+ * Wrapper overhead benchmark: every operation of the wrapper next to a
+ * hand-written baseline with the raw SQLite C API doing the same work.
+ *
+ * usage: sqlite_helper_bench [--json file] [--csv file] [--repetitions n]
+ *
+ * Every case runs a fixed number of iterations over the same in-memory
+ * data, repetitions times; the median time per operation is reported, so
+ * results can be compared from one version of the wrapper to the next.
+ */
+
+//######################################################################
+
+class BenchDB : public SQLiteDB
+{
+	public:
+		using SQLiteDB::SQLiteDB;
+
+		sqlite3* handle(){
+			return m_DB;
+		}
+};
+
+//######################################################################
+
+struct BenchResult
+{
+	std::string name;
+	double wrapperNs;
+	double rawNs;
+	long iterations;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+const int NUM_ROWS=10000;
+const long ITERATIONS=200000;
+const char* SELECT_ALL="select ID, Name, Age, Address, Salary from COMPANY";
+const char* SELECT_ONE="select Age from COMPANY where ID=?";
+const char* SELECT_PARAM="select ?";
+
+int repetitions=5;
+std::vector<BenchResult> results;
+
+// keeps the compiler from dropping the work measured
+volatile long long sink=0;
+
+/*
+ * Median over repetitions of the time per operation of f(iterations),
+ * in nanoseconds.
+ */
+template<typename F>
+double measure(F f, long iterations){
+	std::vector<double> times;
+	for(int r=0; r<repetitions; r++){
+		Clock::time_point start=Clock::now();
+		f(iterations);
+		times.push_back(std::chrono::duration<double, std::nano>(Clock::now()-start).count()/iterations);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size()/2];
+}
+
+template<typename W, typename R>
+void compare(const std::string& name, long iterations, W wrapper, R raw){
+	BenchResult result;
+	result.name=name;
+	result.iterations=iterations;
+	result.wrapperNs=measure(wrapper, iterations);
+	result.rawNs=measure(raw, iterations);
+	results.push_back(result);
+	std::cout.width(24);
+	std::cout<<std::left<<name<<std::right;
+	std::cout.width(12);
+	std::cout<<result.wrapperNs;
+	std::cout.width(12);
+	std::cout<<result.rawNs;
+	std::cout.width(10);
+	std::cout<<result.wrapperNs/result.rawNs<<"\n";
+}
+
+//######################################################################
+
+/*
+ * Bind value through the wrapper (binding, the BindDataTrait dispatch)
+ * against bindRaw(statement, value), on the statement "select ?".
+ */
+template<typename T, typename B>
+void compareBind(const std::string& type, sqlite3_stmt* statement, T value, B bindRaw){
+	compare("bind "+type, ITERATIONS*5, [&](long n){
+		for(long i=0; i<n; i++){
+			sink+=binding(statement, 0, value);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			sink+=bindRaw(statement, value);
+		}
+	});
+}
+
+//######################################################################
+
+void writeJson(const char* path){
+	std::ofstream out(path);
+	out<<"{\n  \"sqlite_version\": \""<<sqlite3_libversion()<<"\",\n";
+	out<<"  \"repetitions\": "<<repetitions<<",\n  \"unit\": \"ns/op\",\n  \"results\": [\n";
+	for(size_t i=0; i<results.size(); i++){
+		const BenchResult& r=results[i];
+		out<<"    {\"name\": \""<<r.name<<"\", \"iterations\": "<<r.iterations
+			<<", \"wrapper\": "<<r.wrapperNs<<", \"raw\": "<<r.rawNs
+			<<", \"ratio\": "<<r.wrapperNs/r.rawNs<<"}"<<(i+1<results.size() ? ",\n" : "\n");
+	}
+	out<<"  ]\n}\n";
+}
+
+void writeCsv(const char* path){
+	std::ofstream out(path);
+	out<<"name,iterations,wrapper_ns,raw_ns,ratio\n";
+	for(const BenchResult& r : results){
+		out<<r.name<<","<<r.iterations<<","<<r.wrapperNs<<","<<r.rawNs<<","<<r.wrapperNs/r.rawNs<<"\n";
+	}
+}
+
+//######################################################################
+
+int main(int argc, char* argv[]) {
+	const char* jsonPath=nullptr;
+	const char* csvPath=nullptr;
+	for(int i=1; i+1<argc; i+=2){
+		if(std::strcmp(argv[i], "--json")==0){
+			jsonPath=argv[i+1];
+		}
+		else if(std::strcmp(argv[i], "--csv")==0){
+			csvPath=argv[i+1];
+		}
+		else if(std::strcmp(argv[i], "--repetitions")==0){
+			repetitions=std::max(1, std::atoi(argv[i+1]));
+		}
+	}
+
+	BenchDB dbConnection(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+	sqlite3* db=dbConnection.handle();
+
+	dbConnection.executeQuery("CREATE TABLE COMPANY(ID INT PRIMARY KEY NOT NULL, Name TEXT NOT NULL, Age INT NOT NULL, Address CHAR(50), Salary REAL)");
+	dbConnection.executeQuery("BEGIN");
+	for(int i=0; i<NUM_ROWS; i++){
+		dbConnection.executeSecureQueryNf("insert into COMPANY values (?,?,?,?,?)", i, "name", 20+i%50, "address", 10.5+i%100);
+	}
+	dbConnection.executeQuery("COMMIT");
+
+	std::cout<<"SQLite "<<sqlite3_libversion()<<", median of "<<repetitions<<" repetitions, ns per operation\n\n";
+	std::cout<<"case                     wrapper         raw     ratio\n";
+
+	//----------------------------------------------------------------------
+
+	compare("prepare (cached)", ITERATIONS, [&](long n){
+		for(long i=0; i<n; i++){
+			SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			sqlite3_stmt* statement;
+			sqlite3_prepare_v2(db, SELECT_ALL, -1, &statement, nullptr);
+			sqlite3_finalize(statement);
+		}
+	});
+
+	dbConnection.setStatementCacheSize(0);
+	compare("prepare (no cache)", ITERATIONS/4, [&](long n){
+		for(long i=0; i<n; i++){
+			SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			sqlite3_stmt* statement;
+			sqlite3_prepare_v2(db, SELECT_ALL, -1, &statement, nullptr);
+			sqlite3_finalize(statement);
+		}
+	});
+	dbConnection.setStatementCacheSize(SQLiteDB::STATEMENT_CACHE_SIZE);
+
+	//----------------------------------------------------------------------
+
+	sqlite3_stmt* param;
+	sqlite3_prepare_v2(db, SELECT_PARAM, -1, &param, nullptr);
+	static const char bytes[64]={'x'};
+	static const char16_t utf16[]=u"name";
+	static int pointee=0;
+	std::string str("a std::string value");
+	sqlite3_stmt* valueSource;
+	sqlite3_prepare_v2(db, "select 42", -1, &valueSource, nullptr);
+	sqlite3_step(valueSource);
+	sqlite3_value* value=sqlite3_column_value(valueSource, 0);
+
+	compareBind("int", param, 42, [](sqlite3_stmt* s, int v){ return sqlite3_bind_int(s, 1, v); });
+	compareBind("double", param, 4.2, [](sqlite3_stmt* s, double v){ return sqlite3_bind_double(s, 1, v); });
+	compareBind("sqlite3_int64", param, sqlite3_int64(42), [](sqlite3_stmt* s, sqlite3_int64 v){ return sqlite3_bind_int64(s, 1, v); });
+	compareBind("std::string", param, str, [](sqlite3_stmt* s, const std::string& v){ return sqlite3_bind_text(s, 1, v.c_str(), static_cast<int>(v.size()), SQLITE_TRANSIENT); });
+	compareBind("const char*", param, static_cast<const char*>("a C string"), [](sqlite3_stmt* s, const char* v){ return sqlite3_bind_text(s, 1, v, -1, SQLITE_STATIC); });
+	compareBind("sqlite3_value*", param, value, [](sqlite3_stmt* s, sqlite3_value* v){ return sqlite3_bind_value(s, 1, v); });
+	compareBind("blob", param, blob(bytes, sizeof(bytes), SQLITE_STATIC), [](sqlite3_stmt* s, blob){ return sqlite3_bind_blob(s, 1, bytes, sizeof(bytes), SQLITE_STATIC); });
+	compareBind("blob64", param, blob64(bytes, sizeof(bytes), SQLITE_STATIC), [](sqlite3_stmt* s, blob64){ return sqlite3_bind_blob64(s, 1, bytes, sizeof(bytes), SQLITE_STATIC); });
+	compareBind("text", param, text(bytes, sizeof(bytes), SQLITE_STATIC), [](sqlite3_stmt* s, text){ return sqlite3_bind_text(s, 1, bytes, sizeof(bytes), SQLITE_STATIC); });
+	compareBind("text16", param, text16(utf16, sizeof(utf16)-2, SQLITE_STATIC), [](sqlite3_stmt* s, text16){ return sqlite3_bind_text16(s, 1, utf16, sizeof(utf16)-2, SQLITE_STATIC); });
+	compareBind("text64", param, text64(bytes, sizeof(bytes), SQLITE_STATIC, SQLITE_UTF8), [](sqlite3_stmt* s, text64){ return sqlite3_bind_text64(s, 1, bytes, sizeof(bytes), SQLITE_STATIC, SQLITE_UTF8); });
+	compareBind("zeroblob", param, zeroblob(64), [](sqlite3_stmt* s, zeroblob){ return sqlite3_bind_zeroblob(s, 1, 64); });
+	compareBind("zeroblob64", param, zeroblob64(64), [](sqlite3_stmt* s, zeroblob64){ return sqlite3_bind_zeroblob64(s, 1, 64); });
+	compareBind("sqlite_ptr", param, sqlite_ptr(&pointee, "bench", nullptr), [](sqlite3_stmt* s, sqlite_ptr){ return sqlite3_bind_pointer(s, 1, &pointee, "bench", nullptr); });
+	compareBind("null_data", param, null_data(), [](sqlite3_stmt* s, null_data){ return sqlite3_bind_null(s, 1); });
+
+	sqlite3_stmt* params;
+	sqlite3_prepare_v2(db, "select ?, ?, ?, ?, ?", -1, &params, nullptr);
+	const char* cstr="a C string";
+	compare("bind 5 parameters", ITERATIONS*2, [&](long n){
+		for(long i=0; i<n; i++){
+			sink+=binding(params, 0, 42, str, 4.2, sqlite3_int64(42), cstr);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			sink+=sqlite3_bind_int(params, 1, 42);
+			sink+=sqlite3_bind_text(params, 2, str.c_str(), static_cast<int>(str.size()), SQLITE_TRANSIENT);
+			sink+=sqlite3_bind_double(params, 3, 4.2);
+			sink+=sqlite3_bind_int64(params, 4, 42);
+			sink+=sqlite3_bind_text(params, 5, cstr, -1, SQLITE_STATIC);
+		}
+	});
+	sqlite3_finalize(params);
+
+	sqlite3_finalize(valueSource);
+	sqlite3_finalize(param);
+
+	//----------------------------------------------------------------------
+
+	sqlite3_stmt* all;
+	sqlite3_prepare_v2(db, SELECT_ALL, -1, &all, nullptr);
+
+	compare("step", NUM_ROWS*20, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+			while(rows.yield()){
+				sink++;
+			}
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			while(SQLITE_ROW==sqlite3_step(all)){
+				sink++;
+			}
+			sqlite3_reset(all);
+		}
+	});
+
+	compare("column by name", NUM_ROWS*20, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+			while(rows.yield()){
+				sink+=rows.as_int("Age");
+			}
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			while(SQLITE_ROW==sqlite3_step(all)){
+				sink+=sqlite3_column_int(all, 2);
+			}
+			sqlite3_reset(all);
+		}
+	});
+
+	compare("column by ColumnRef", NUM_ROWS*20, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			SqlRows rows=dbConnection.getResultRows(SELECT_ALL);
+			ColumnRef age=rows.column("Age");
+			while(rows.yield()){
+				sink+=rows.as_int(age);
+			}
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			while(SQLITE_ROW==sqlite3_step(all)){
+				sink+=sqlite3_column_int(all, 2);
+			}
+			sqlite3_reset(all);
+		}
+	});
+
+	sqlite3_finalize(all);
+
+	//----------------------------------------------------------------------
+
+	sqlite3_stmt* count;
+	sqlite3_prepare_v2(db, "select max(Age) from COMPANY where ID<10", -1, &count, nullptr);
+
+	compare("uniqueAsInt", ITERATIONS, [&](long n){
+		int result=0;
+		for(long i=0; i<n; i++){
+			dbConnection.uniqueAsInt("select max(Age) from COMPANY where ID<10", result);
+			sink+=result;
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			if(SQLITE_ROW==sqlite3_step(count)){
+				sink+=sqlite3_column_int(count, 0);
+			}
+			sqlite3_reset(count);
+		}
+	});
+
+	compare("uniqueAsDouble", ITERATIONS, [&](long n){
+		double result=0.0;
+		for(long i=0; i<n; i++){
+			dbConnection.uniqueAsDouble("select max(Age) from COMPANY where ID<10", result);
+			sink+=static_cast<long long>(result);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			if(SQLITE_ROW==sqlite3_step(count)){
+				sink+=static_cast<long long>(sqlite3_column_double(count, 0));
+			}
+			sqlite3_reset(count);
+		}
+	});
+
+	compare("uniqueAsString", ITERATIONS, [&](long n){
+		std::string result;
+		for(long i=0; i<n; i++){
+			dbConnection.uniqueAsString("select max(Age) from COMPANY where ID<10", result);
+			sink+=result.size();
+		}
+	}, [&](long n){
+		std::string result;
+		for(long i=0; i<n; i++){
+			if(SQLITE_ROW==sqlite3_step(count)){
+				result.assign(reinterpret_cast<const char*>(sqlite3_column_text(count, 0)), sqlite3_column_bytes(count, 0));
+				sink+=result.size();
+			}
+			sqlite3_reset(count);
+		}
+	});
+
+	sqlite3_finalize(count);
+
+	//----------------------------------------------------------------------
+
+	sqlite3_stmt* one;
+	sqlite3_prepare_v2(db, SELECT_ONE, -1, &one, nullptr);
+
+	compare("executeSecureQuery", ITERATIONS, [&](long n){
+		for(long i=0; i<n; i++){
+			SqlRows rows=dbConnection.executeSecureQueryNf(SELECT_ONE, static_cast<int>(i%NUM_ROWS));
+			while(rows.yield()){
+				sink+=rows.as_int(ColumnRef(0));
+			}
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i++){
+			sqlite3_bind_int(one, 1, static_cast<int>(i%NUM_ROWS));
+			while(SQLITE_ROW==sqlite3_step(one)){
+				sink+=sqlite3_column_int(one, 0);
+			}
+			sqlite3_reset(one);
+		}
+	});
+
+	sqlite3_finalize(one);
+
+	//----------------------------------------------------------------------
+
+	struct Sum
+	{
+		sqlite3_int64 total;
+	};
+	// the same flags as the raw functions below
+	dbConnection.registerFunction("twice", [](int age){ return 2*age; }, true, true);
+	dbConnection.registerAggregate<Sum>("age_sum", [](Sum& sum, int age){ sum.total+=age; }, [](const Sum& sum){ return sum.total; }, true, true);
+	sqlite3_create_function_v2(db, "twice_raw", 1, SQLITE_UTF8|SQLITE_DETERMINISTIC|SQLITE_INNOCUOUS, nullptr, [](sqlite3_context* context, int, sqlite3_value** argv){
+		sqlite3_result_int(context, 2*sqlite3_value_int(argv[0]));
+	}, nullptr, nullptr, nullptr);
+	sqlite3_create_function_v2(db, "age_sum_raw", 1, SQLITE_UTF8|SQLITE_DETERMINISTIC|SQLITE_INNOCUOUS, nullptr, nullptr, [](sqlite3_context* context, int, sqlite3_value** argv){
+		Sum* sum=static_cast<Sum*>(sqlite3_aggregate_context(context, sizeof(Sum)));
+		if(sum){
+			sum->total+=sqlite3_value_int(argv[0]);
+		}
+	}, [](sqlite3_context* context){
+		Sum* sum=static_cast<Sum*>(sqlite3_aggregate_context(context, 0));
+		sqlite3_result_int64(context, sum ? sum->total : 0);
+	}, nullptr);
+
+	sqlite3_stmt* function;
+	sqlite3_stmt* functionRaw;
+	sqlite3_prepare_v2(db, "select max(twice(Age)) from COMPANY", -1, &function, nullptr);
+	sqlite3_prepare_v2(db, "select max(twice_raw(Age)) from COMPANY", -1, &functionRaw, nullptr);
+	compare("scalar function", NUM_ROWS*20, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			sqlite3_step(function);
+			sink+=sqlite3_column_int(function, 0);
+			sqlite3_reset(function);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			sqlite3_step(functionRaw);
+			sink+=sqlite3_column_int(functionRaw, 0);
+			sqlite3_reset(functionRaw);
+		}
+	});
+	sqlite3_finalize(function);
+	sqlite3_finalize(functionRaw);
+
+	sqlite3_prepare_v2(db, "select age_sum(Age) from COMPANY", -1, &function, nullptr);
+	sqlite3_prepare_v2(db, "select age_sum_raw(Age) from COMPANY", -1, &functionRaw, nullptr);
+	compare("aggregate function", NUM_ROWS*20, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			sqlite3_step(function);
+			sink+=sqlite3_column_int64(function, 0);
+			sqlite3_reset(function);
+		}
+	}, [&](long n){
+		for(long i=0; i<n; i+=NUM_ROWS){
+			sqlite3_step(functionRaw);
+			sink+=sqlite3_column_int64(functionRaw, 0);
+			sqlite3_reset(functionRaw);
+		}
+	});
+	sqlite3_finalize(function);
+	sqlite3_finalize(functionRaw);
+
+	if(jsonPath){
+		writeJson(jsonPath);
+	}
+	if(csvPath){
+		writeCsv(csvPath);
+	}
+
+	return 0;
+}
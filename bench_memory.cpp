@@ -0,0 +1,208 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "sqlite_db.h"
+#include "sqlite_memory_config.h"
+
+//######################################################################
+
+/*
+ * Allocator benchmark: the same workloads run with the SQLite default
+ * allocator and page cache, then with the SQLiteMemory size class pools
+ * and page arena. The library is shut down and configured again between
+ * configurations; the median time per operation is reported, and the
+ * MemoryStats counters of each configuration.
+ */
+
+//######################################################################
+
+typedef std::chrono::steady_clock Clock;
+
+const char* DB_FILE="sqlite_memory_bench.db";
+const int NUM_ROWS=50000;
+const long QUERIES=100000;
+const long OPENS=5000;
+const int REPETITIONS=5;
+
+volatile long long sink=0;
+
+template<typename F>
+double measure(F f, long iterations){
+	std::vector<double> times;
+	for(int r=0; r<REPETITIONS; r++){
+		Clock::time_point start=Clock::now();
+		f(iterations);
+		times.push_back(std::chrono::duration<double, std::nano>(Clock::now()-start).count()/iterations);
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size()/2];
+}
+
+void createDatabase(){
+	std::remove(DB_FILE);
+	SQLiteDB dbConnection(DB_FILE, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+	dbConnection.executeQuery("CREATE TABLE COMPANY(ID INT PRIMARY KEY NOT NULL, Name TEXT NOT NULL, Age INT NOT NULL, Address TEXT, Salary REAL)");
+	dbConnection.executeQuery("BEGIN");
+	for(int i=0; i<NUM_ROWS; i++){
+		dbConnection.executeSecureQueryNf("insert into COMPANY values (?,?,?,?,?)", i, "name "+std::to_string(i), 20+i%50, std::string(200, 'a'+i%26), 10.5+i%100);
+	}
+	dbConnection.executeQuery("COMMIT");
+}
+
+//######################################################################
+
+/*
+ * sqlite3_malloc and sqlite3_free of mixed sizes, 64 blocks live at a
+ * time: the allocator alone, through the SQLite memory statistics.
+ */
+double mallocFree(){
+	void* blocks[64]={};
+	double ns=measure([&](long n){
+		for(long i=0; i<n; i++){
+			void*& block=blocks[i%64];
+			sqlite3_free(block);
+			block=sqlite3_malloc(static_cast<int>(16+(i*37)%1000));
+		}
+	}, QUERIES*10);
+	for(void* block : blocks){
+		sqlite3_free(block);
+	}
+	return ns;
+}
+
+/*
+ * Short queries prepared every time (statement cache disabled), on an
+ * in-memory database: parse, plan and VDBE allocations.
+ */
+double shortQueries(){
+	SQLiteDB dbConnection(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+	dbConnection.executeQuery("CREATE TABLE COMPANY(ID INT PRIMARY KEY NOT NULL, Name TEXT NOT NULL, Age INT NOT NULL)");
+	dbConnection.executeQuery("BEGIN");
+	for(int i=0; i<1000; i++){
+		dbConnection.executeSecureQueryNf("insert into COMPANY values (?,?,?)", i, "name", 20+i%50);
+	}
+	dbConnection.executeQuery("COMMIT");
+	dbConnection.setStatementCacheSize(0);
+	return measure([&](long n){
+		for(long i=0; i<n; i++){
+			for(auto [age, name] : dbConnection.query<int, std::string>("select Age, Name from COMPANY where ID=?", static_cast<int>(i%1000))){
+				sink+=age+name.size();
+			}
+		}
+	}, QUERIES);
+}
+
+/*
+ * Open a connection to the file database, run a query, close it.
+ */
+double openQueryClose(){
+	return measure([](long n){
+		for(long i=0; i<n; i++){
+			SQLiteDB dbConnection(DB_FILE, SQLITE_OPEN_READONLY);
+			int age=0;
+			dbConnection.uniqueAsInt("select Age from COMPANY where ID=7", age);
+			sink+=age;
+		}
+	}, OPENS);
+}
+
+/*
+ * Random point lookups on the file database with a 100 page cache, so
+ * pages are evicted and recycled all the time.
+ */
+double pointLookups(){
+	SQLiteDB dbConnection(DB_FILE, SQLITE_OPEN_READONLY);
+	dbConnection.executeQuery("PRAGMA cache_size=100");
+	unsigned seed=1;
+	return measure([&](long n){
+		for(long i=0; i<n; i++){
+			seed=seed*1103515245u+12345u;
+			for(auto [salary] : dbConnection.query<double>("select Salary from COMPANY where ID=?", static_cast<int>((seed>>8)%NUM_ROWS))){
+				sink+=static_cast<long long>(salary);
+			}
+		}
+	}, QUERIES);
+}
+
+//######################################################################
+
+int main(){
+	createDatabase();
+
+	MemoryConfig defaults;
+	defaults.pools=false;
+	defaults.memStatus=true;
+
+	MemoryConfig defaultsNoStatus=defaults;
+	defaultsNoStatus.memStatus=false;
+
+	MemoryConfig pools;
+	pools.memStatus=true;
+
+	MemoryConfig arena=pools;
+	arena.arenaPages=2048;
+
+	MemoryConfig noStatus=arena;
+	noStatus.memStatus=false;
+
+	struct Configuration
+	{
+		const char* name;
+		MemoryConfig config;
+	};
+	std::vector<Configuration> configurations={
+		{"SQLite default", defaults},
+		{"  memstatus off", defaultsNoStatus},
+		{"size class pools", pools},
+		{"pools + page arena", arena},
+		{"  memstatus off", noStatus}
+	};
+
+	std::cout<<"median of "<<REPETITIONS<<", ns/op\n";
+	std::cout.width(22);
+	std::cout<<std::left<<"configuration"<<std::right;
+	std::cout.width(16);
+	std::cout<<"malloc+free";
+	std::cout.width(16);
+	std::cout<<"short query";
+	std::cout.width(16);
+	std::cout<<"open+close";
+	std::cout.width(16);
+	std::cout<<"point lookup"<<"\n";
+
+	std::vector<MemoryStats> stats;
+	for(const Configuration& configuration : configurations){
+		sqlite3_shutdown();
+		if(SQLiteMemory::install(configuration.config)!=SQLITE_OK){
+			std::cout<<configuration.name<<": install failed\n";
+			continue;
+		}
+		double allocation=mallocFree();
+		double query=shortQueries();
+		double open=openQueryClose();
+		double lookup=pointLookups();
+		stats.push_back(SQLiteMemory::stats());
+
+		std::cout.width(22);
+		std::cout<<std::left<<configuration.name<<std::right;
+		std::cout.width(16);
+		std::cout<<allocation;
+		std::cout.width(16);
+		std::cout<<query;
+		std::cout.width(16);
+		std::cout<<open;
+		std::cout.width(16);
+		std::cout<<lookup<<"\n";
+	}
+
+	// counters are cumulative over the configurations using them
+	const MemoryStats& last=stats.back();
+	std::cout<<"\npool hits "<<last.poolHits<<", fallbacks "<<last.poolFallbacks<<", peak "<<last.peakBytes/1024<<" KiB in use, "<<last.poolBytes/1024<<" KiB reserved\n";
+	std::cout<<"arena pages "<<last.pageHits<<", fallbacks "<<last.pageFallbacks<<", peak "<<last.peakPages<<" pages\n";
+
+	std::remove(DB_FILE);
+	return 0;
+}
@@ -3,6 +3,8 @@
 #include <ctime>
 #include <stdlib.h>
 #include <vector>
+#include <tuple>
+#include <fstream>
 #include <sqlite3.h> 
 
 #include "sqlite_db.h"
@@ -23,7 +25,7 @@ void mkDBfile(const char* filePath){
 	std::ifstream file;
 	file.open(filePath);
 	if(!file.is_open()){
-		std::ofstream outfile(dataBaseFile, std::ios::out);
+		std::ofstream outfile(filePath, std::ios::out);
 	}
 	file.close();
 }
@@ -53,28 +55,26 @@ int main() {
 			std::cout<<"Fail: "<<"\n";
 	}
 
+	// ID, Name, Age, Address, Salary, utf16, Data, Ħφ
+	std::vector<std::tuple<int, std::string, int, std::string, double, const char*, const char*, int>> rows;
 	for(int i=0; i<40; i++){
-		query="insert into COMPANY values ('";
-		query+=std::to_string(i)+"',";        // ID
-		query+="'"+randomStr(5+rand()%51)+"',";// Name
-		query+="'"+std::to_string(5+rand()%53)+"',"; // Age
-		query+="'"+randomStr(5+rand()%61)+"',";   // Address
-		query+="'"+std::to_string(5.27+rand()%100)+"',";   // Salary		
+		rows.emplace_back(
+			i,
+			randomStr(5+rand()%51),
+			5+rand()%53,
+			randomStr(5+rand()%61),
+			5.27+rand()%100,
+			(i%2==0) ? "ψϬ࠽" : "నಋሯᐮ",
+			"",
+			rand()%10+rand()%100
+		);
+	}
 
-		if(i%2==0){
-			query+="'ψϬ࠽',";   // utf16
-		}
-		else{
-			query+="'నಋሯᐮ',"; // utf16
-		}
-		query+="'',";   //Data
-		query+="'"+std::to_string(rand()%10+rand()%100)+"')";   // Ħφ
-		
-		if(!dbConnection.executeQuery(query.c_str())){
-			std::cout<<"Fail: "<<i<<"\n";
-			break;
-		}
+	BatchResult result=dbConnection.executeMany("insert into COMPANY values (?,?,?,?,?,?,?,?)", rows);
+	if(result.errorCode!=SQLITE_OK){
+		std::cout<<"Fail: "<<result.rows<<" "<<dbConnection.lastErrorMsg()<<"\n";
 	}
+	std::cout<<result.rows<<" rows, "<<result.rowsPerSecond()<<" rows/second\n";
 
 	return 0;
 }
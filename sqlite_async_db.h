@@ -0,0 +1,462 @@
+/*********************************************************************
+* AsyncSQLiteDB class                                                *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_ASYNC_DB_H
+#define SQLITE_ASYNC_DB_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sqlite3.h>
+
+#include "sqlite_db.h"
+
+//######################################################################
+
+/*
+ * Type an argument is stored as until the query runs in the worker
+ * thread: C strings are copied into std::string, everything else is
+ * stored by value.
+ */
+template<typename T>
+struct AsyncArg
+{
+	typedef T type;
+};
+
+template<>
+struct AsyncArg<const char*>
+{
+	typedef std::string type;
+};
+
+template<>
+struct AsyncArg<char*>
+{
+	typedef std::string type;
+};
+
+//######################################################################
+
+/**
+ * Connection running every query in its own worker thread, so the
+ * caller never blocks on sqlite3_step.
+ *
+ * Queries are pushed to a lock-free multiple producer single consumer
+ * queue and run by the worker in order of submission. The result is
+ * returned through a std::future, or passed to a callback run by the
+ * worker thread once the query completes.
+ *
+ * Example:
+ * AsyncSQLiteDB dbConnection("database_test.db", SQLITE_OPEN_READWRITE);
+ * std::future<int> done=dbConnection.executeSecureQuery("update COMPANY set Salary=? where ID=?", 2500.0, 3);
+ * std::future<std::optional<int>> count=dbConnection.uniqueAsInt("select count(*) from COMPANY");
+ * ...
+ * if(done.get()==SQLITE_OK && count.get()){...}
+ *
+ * @note the SQL and const char* arguments are copied; blob and text
+ *     wrappers are passed as they are, so the memory they point to must
+ *     stay valid until the query completes (or use SQLITE_TRANSIENT).
+ */
+
+class AsyncSQLiteDB
+{
+	public:
+		/**
+		 * Counters of the queue, latency is measured from submission to
+		 * completion of a task.
+		 */
+		struct Stats
+		{
+			uint64_t submitted;
+			uint64_t completed;
+			size_t queueDepth;       // tasks submitted and not completed
+			size_t maxQueueDepth;
+			double meanLatency;      // seconds
+			double maxLatency;       // seconds
+		};
+
+		/**
+		 * Open the connection and start the worker thread.
+		 *
+		 * @param dbName Database file name.
+		 * @param openMode The flags parameter to sqlite3_open_v2, the
+		 *     connection is only used from the worker thread so
+		 *     SQLITE_OPEN_NOMUTEX is added.
+		 * @throws const char* if the connection cannot be opened.
+		 */
+		explicit AsyncSQLiteDB(const char* dbName, int openMode=SQLITE_OPEN_READWRITE);
+
+		/**
+		 * Destructor, run the tasks still in the queue, then stop the
+		 * worker thread and close the connection.
+		 */
+		virtual ~AsyncSQLiteDB();
+
+		AsyncSQLiteDB(const AsyncSQLiteDB&)=delete;
+		AsyncSQLiteDB& operator=(const AsyncSQLiteDB&)=delete;
+
+		/**
+		 * Run task(SQLiteDB&) in the worker thread.
+		 *
+		 * @return std::future with the value returned by task, or the
+		 *     exception it threw.
+		 */
+		template<typename F>
+		std::future<std::invoke_result_t<F, SQLiteDB&>> submit(F task);
+
+		/**
+		 * Run task(SQLiteDB&) in the worker thread and then pass its
+		 * result to onComplete, also in the worker thread.
+		 *
+		 * @note neither task nor onComplete should throw, an exception
+		 *     escaping the worker thread calls std::terminate.
+		 */
+		template<typename F, typename C>
+		void submit(F task, C onComplete);
+
+		/**
+		 * Bind args and execute query, see SQLiteDB::executeSecureQuery.
+		 * The statement is stepped to completion and rows in the result, 
+		 * if any, are discarded (use query to read the rows of 
+		 * INSERT/UPDATE/DELETE ... RETURNING).
+		 *
+		 * @return std::future with SQLITE_OK or the error code.
+		 */
+		template<typename... Args>
+		std::future<int> executeSecureQuery(std::string query, Args... args);
+
+		/**
+		 * @see SQLiteDB::uniqueAsInt
+		 * @return std::future with the value, or std::nullopt if the
+		 *     query failed or returned no row.
+		 */
+		std::future<std::optional<int>> uniqueAsInt(std::string query);
+
+		/**
+		 * @see SQLiteDB::uniqueAsDouble
+		 */
+		std::future<std::optional<double>> uniqueAsDouble(std::string query);
+
+		/**
+		 * @see SQLiteDB::uniqueAsString
+		 */
+		std::future<std::optional<std::string>> uniqueAsString(std::string query);
+
+		/**
+		 * Execute query and copy all the rows of the result, decoded as
+		 * in SQLiteDB::query.
+		 *
+		 * @tparam Ts the column types, they must own their value
+		 *     (std::string rather than std::string_view).
+		 * @return std::future with the rows, or the exception thrown if
+		 *     the result does not have sizeof...(Ts) columns.
+		 */
+		template<typename... Ts, typename... Args>
+		std::future<std::vector<std::tuple<typename ColumnData<Ts>::returnType...>>> query(std::string query, Args... args);
+
+		/**
+		 * Number of tasks submitted and not completed yet.
+		 */
+		size_t queueDepth() const;
+
+		Stats stats() const;
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Node
+		{
+			std::atomic<Node*> next;
+			Clock::time_point submitted;
+
+			Node()
+			:next(nullptr)
+			{}
+
+			virtual ~Node()=default;
+
+			virtual void run(SQLiteDB&){}
+		};
+
+		template<typename F>
+		struct Task : public Node
+		{
+			F task;
+
+			explicit Task(F&& f)
+			:task(std::move(f))
+			{}
+
+			void run(SQLiteDB& db) override{
+				task(db);
+			}
+		};
+
+		std::unique_ptr<SQLiteDB> m_db;
+
+		// Vyukov's intrusive MPSC queue: producers exchange m_head, the
+		// worker pops from m_tail, m_stub keeps the queue never empty.
+		std::atomic<Node*> m_head;
+		Node* m_tail;
+		Node m_stub;
+
+		std::atomic<size_t> m_depth;
+		std::atomic<size_t> m_maxDepth;
+		std::atomic<uint64_t> m_submitted;
+		std::atomic<uint64_t> m_completed;
+		std::atomic<uint64_t> m_latencyNs;
+		std::atomic<uint64_t> m_maxLatencyNs;
+
+		// only used to put the worker to sleep when the queue is empty
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeUp;
+		bool m_stop;
+
+		std::thread m_worker;
+
+		void push(Node* node);
+		void enqueue(Node* node);
+		Node* pop();
+		void work();
+};
+
+//----------------------------------------------------------------------
+
+inline AsyncSQLiteDB::AsyncSQLiteDB(const char* dbName, int openMode)
+:m_db(new SQLiteDB(dbName, openMode|SQLITE_OPEN_NOMUTEX)),
+m_head(&m_stub),
+m_tail(&m_stub),
+m_depth(0),
+m_maxDepth(0),
+m_submitted(0),
+m_completed(0),
+m_latencyNs(0),
+m_maxLatencyNs(0),
+m_stop(false),
+m_worker(&AsyncSQLiteDB::work, this)
+{}
+
+//----------------------------------------------------------------------
+
+inline AsyncSQLiteDB::~AsyncSQLiteDB(){
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop=true;
+	}
+	m_wakeUp.notify_one();
+	m_worker.join();
+}
+
+//----------------------------------------------------------------------
+
+inline void AsyncSQLiteDB::push(Node* node){
+	node->next.store(nullptr, std::memory_order_relaxed);
+	Node* prev=m_head.exchange(node, std::memory_order_acq_rel);
+	prev->next.store(node, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------
+
+inline AsyncSQLiteDB::Node* AsyncSQLiteDB::pop(){
+	Node* tail=m_tail;
+	Node* next=tail->next.load(std::memory_order_acquire);
+	if(tail==&m_stub){
+		if(!next){
+			return nullptr;
+		}
+		m_tail=next;
+		tail=next;
+		next=next->next.load(std::memory_order_acquire);
+	}
+	if(next){
+		m_tail=next;
+		return tail;
+	}
+	if(tail!=m_head.load(std::memory_order_acquire)){
+		// a producer is between the exchange and the link
+		return nullptr;
+	}
+	push(&m_stub);
+	next=tail->next.load(std::memory_order_acquire);
+	if(next){
+		m_tail=next;
+		return tail;
+	}
+	return nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline void AsyncSQLiteDB::enqueue(Node* node){
+	node->submitted=Clock::now();
+	m_submitted.fetch_add(1, std::memory_order_relaxed);
+	size_t depth=m_depth.fetch_add(1, std::memory_order_acq_rel)+1;
+	size_t maxDepth=m_maxDepth.load(std::memory_order_relaxed);
+	while(depth>maxDepth && !m_maxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)){
+	}
+	push(node);
+	if(depth==1){
+		// the worker may be sleeping, take the lock so the wake up
+		// cannot fall between its check and its wait
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wakeUp.notify_one();
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void AsyncSQLiteDB::work(){
+	while(true){
+		Node* node=pop();
+		if(!node){
+			if(m_depth.load(std::memory_order_acquire)>0){
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeUp.wait(lock, [this]{
+				return m_stop || m_depth.load(std::memory_order_acquire)>0;
+			});
+			if(m_depth.load(std::memory_order_acquire)==0){
+				return;
+			}
+			continue;
+		}
+
+		node->run(*m_db);
+
+		uint64_t latency=std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now()-node->submitted).count();
+		m_latencyNs.fetch_add(latency, std::memory_order_relaxed);
+		if(latency>m_maxLatencyNs.load(std::memory_order_relaxed)){
+			m_maxLatencyNs.store(latency, std::memory_order_relaxed);
+		}
+		m_completed.fetch_add(1, std::memory_order_relaxed);
+		delete node;
+		m_depth.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+//----------------------------------------------------------------------
+
+template<typename F>
+std::future<std::invoke_result_t<F, SQLiteDB&>> AsyncSQLiteDB::submit(F task){
+	typedef std::invoke_result_t<F, SQLiteDB&> R;
+	std::packaged_task<R(SQLiteDB&)> packaged(std::move(task));
+	std::future<R> result=packaged.get_future();
+	enqueue(new Task<std::packaged_task<R(SQLiteDB&)>>(std::move(packaged)));
+	return result;
+}
+
+//----------------------------------------------------------------------
+
+template<typename F, typename C>
+void AsyncSQLiteDB::submit(F task, C onComplete){
+	auto run=[task=std::move(task), onComplete=std::move(onComplete)](SQLiteDB& db) mutable{
+		if constexpr(std::is_void_v<std::invoke_result_t<F&, SQLiteDB&>>){
+			task(db);
+			onComplete();
+		}
+		else{
+			onComplete(task(db));
+		}
+	};
+	enqueue(new Task<decltype(run)>(std::move(run)));
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Args>
+std::future<int> AsyncSQLiteDB::executeSecureQuery(std::string query, Args... args){
+	return submit([query=std::move(query), params=std::tuple<typename AsyncArg<Args>::type...>(args...)](SQLiteDB& db){
+		SqlRows rows=std::apply([&db, &query](const auto&... values){
+			return db.executeSecureQueryNf(query.c_str(), values...);
+		}, params);
+		// a statement with result columns (INSERT ... RETURNING) is
+		// returned unstepped: run it to the end
+		if(rows.columnCount()>0){
+			while(rows.yield()){
+			}
+		}
+		int rc=db.lastErrorCode();
+		return (rc==SQLITE_DONE || rc==SQLITE_ROW) ? SQLITE_OK : rc;
+	});
+}
+
+//----------------------------------------------------------------------
+
+inline std::future<std::optional<int>> AsyncSQLiteDB::uniqueAsInt(std::string query){
+	return submit([query=std::move(query)](SQLiteDB& db){
+		int value;
+		return db.uniqueAsInt(query.c_str(), value) ? std::optional<int>(value) : std::nullopt;
+	});
+}
+
+//----------------------------------------------------------------------
+
+inline std::future<std::optional<double>> AsyncSQLiteDB::uniqueAsDouble(std::string query){
+	return submit([query=std::move(query)](SQLiteDB& db){
+		double value;
+		return db.uniqueAsDouble(query.c_str(), value) ? std::optional<double>(value) : std::nullopt;
+	});
+}
+
+//----------------------------------------------------------------------
+
+inline std::future<std::optional<std::string>> AsyncSQLiteDB::uniqueAsString(std::string query){
+	return submit([query=std::move(query)](SQLiteDB& db){
+		std::string value;
+		return db.uniqueAsString(query.c_str(), value) ? std::optional<std::string>(std::move(value)) : std::nullopt;
+	});
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts, typename... Args>
+std::future<std::vector<std::tuple<typename ColumnData<Ts>::returnType...>>> AsyncSQLiteDB::query(std::string query, Args... args){
+	return submit([query=std::move(query), params=std::tuple<typename AsyncArg<Args>::type...>(args...)](SQLiteDB& db){
+		std::vector<std::tuple<typename ColumnData<Ts>::returnType...>> result;
+		std::apply([&db, &query, &result](const auto&... values){
+			for(auto&& row : db.query<Ts...>(query.c_str(), values...)){
+				result.push_back(std::move(row));
+			}
+		}, params);
+		return result;
+	});
+}
+
+//----------------------------------------------------------------------
+
+inline size_t AsyncSQLiteDB::queueDepth() const{
+	return m_depth.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+inline AsyncSQLiteDB::Stats AsyncSQLiteDB::stats() const{
+	Stats stats;
+	stats.submitted=m_submitted.load(std::memory_order_relaxed);
+	stats.completed=m_completed.load(std::memory_order_relaxed);
+	stats.queueDepth=m_depth.load(std::memory_order_relaxed);
+	stats.maxQueueDepth=m_maxDepth.load(std::memory_order_relaxed);
+	stats.meanLatency=stats.completed>0 ? m_latencyNs.load(std::memory_order_relaxed)/1e9/stats.completed : 0.0;
+	stats.maxLatency=m_maxLatencyNs.load(std::memory_order_relaxed)/1e9;
+	return stats;
+}
+
+#endif
@@ -0,0 +1,427 @@
+/*********************************************************************
+* BlobStream class                                                   *
+* BlobStreamBuf class                                                *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_BLOB_STREAM_H
+#define SQLITE_BLOB_STREAM_H
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+#include <sqlite3.h>
+
+//######################################################################
+
+class SQLiteDB;
+
+/**
+ * Wrapper for an open BLOB handle, to read and write a BLOB
+ * incrementally instead of loading it whole in memory.
+ *
+ * A BlobStream is obtained with SQLiteDB::openBlob. The size of the
+ * BLOB cannot be changed through the handle: to write a new value
+ * reserve the space first binding a zeroblob/zeroblob64.
+ *
+ * @see [Incremental BLOB I/O](https://www.sqlite.org/c3ref/blob_open.html)
+ */
+
+class BlobStream
+{
+	public:
+		/**
+		 * Default chunk size for copies and stream buffers.
+		 */
+		static constexpr int CHUNK_SIZE=64*1024;
+
+		BlobStream(BlobStream&& other);
+
+		BlobStream(const BlobStream&)=delete;
+		BlobStream& operator=(const BlobStream&)=delete;
+
+		/**
+		 * Destructor, close the BLOB handle.
+		 */
+		virtual ~BlobStream();
+
+		/**
+		 * Returns true if the BLOB handle was opened successfully.
+		 */
+		bool isOpen() const;
+
+		/**
+		 * Error code of sqlite3_blob_open or of the last operation.
+		 */
+		int errorCode() const;
+
+		/**
+		 * Wrapper for sqlite3_blob_bytes.
+		 */
+		int size() const;
+
+		/**
+		 * Wrapper for sqlite3_blob_read.
+		 *
+		 * @param buffer destination of the data
+		 * @param n number of bytes to read
+		 * @param offset offset within the BLOB
+		 * @return SQLITE_OK or the error code.
+		 */
+		int read(void* buffer, int n, int offset);
+
+		/**
+		 * Wrapper for sqlite3_blob_write.
+		 *
+		 * @param buffer data to write
+		 * @param n number of bytes to write
+		 * @param offset offset within the BLOB, offset+n cannot be
+		 *     greater than BlobStream::size()
+		 * @return SQLITE_OK or the error code.
+		 */
+		int write(const void* buffer, int n, int offset);
+
+		/**
+		 * Wrapper for sqlite3_blob_reopen, point the handle to the same
+		 * column of a different row.
+		 *
+		 * @return SQLITE_OK or the error code.
+		 */
+		int reopen(sqlite3_int64 rowid);
+
+		/**
+		 * Wrapper for sqlite3_blob_close.
+		 *
+		 * @return SQLITE_OK or the error code.
+		 */
+		int close();
+
+		/**
+		 * Copy the whole BLOB to out, chunkSize bytes at a time.
+		 *
+		 * @return SQLITE_OK, the error code of sqlite3_blob_read or
+		 *     SQLITE_IOERR if writing to out fails.
+		 */
+		int copyTo(std::ostream& out, int chunkSize);
+
+		/**
+		 * Fill the BLOB from in, chunkSize bytes at a time, until the
+		 * BLOB is full or in is exhausted.
+		 *
+		 * @return SQLITE_OK, the error code of sqlite3_blob_write or
+		 *     SQLITE_IOERR if reading from in fails.
+		 */
+		int copyFrom(std::istream& in, int chunkSize);
+
+	private:
+		sqlite3_blob* m_blob;
+		int m_errorCode;
+
+		BlobStream(sqlite3_blob* blob, int errorCode);
+
+	friend SQLiteDB;
+};
+
+//----------------------------------------------------------------------
+
+inline BlobStream::BlobStream(sqlite3_blob* blob, int errorCode)
+:m_blob(blob),
+m_errorCode(errorCode)
+{}
+
+//----------------------------------------------------------------------
+
+inline BlobStream::BlobStream(BlobStream&& other)
+:m_blob(other.m_blob),
+m_errorCode(other.m_errorCode)
+{
+	other.m_blob=nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStream::~BlobStream(){
+	close();
+}
+
+//----------------------------------------------------------------------
+
+inline bool BlobStream::isOpen() const{
+	return m_blob!=nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::errorCode() const{
+	return m_errorCode;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::size() const{
+	return sqlite3_blob_bytes(m_blob);
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::read(void* buffer, int n, int offset){
+	m_errorCode=sqlite3_blob_read(m_blob, buffer, n, offset);
+	return m_errorCode;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::write(const void* buffer, int n, int offset){
+	m_errorCode=sqlite3_blob_write(m_blob, buffer, n, offset);
+	return m_errorCode;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::reopen(sqlite3_int64 rowid){
+	m_errorCode=sqlite3_blob_reopen(m_blob, rowid);
+	return m_errorCode;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::close(){
+	if(!m_blob){
+		return SQLITE_OK;
+	}
+	int rc=sqlite3_blob_close(m_blob);
+	m_blob=nullptr;
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::copyTo(std::ostream& out, int chunkSize){
+	std::vector<char> chunk(chunkSize);
+	int total=size();
+	for(int offset=0; offset<total; offset+=chunkSize){
+		int n=std::min(chunkSize, total-offset);
+		if(read(chunk.data(), n, offset)!=SQLITE_OK){
+			return m_errorCode;
+		}
+		if(!out.write(chunk.data(), n)){
+			return SQLITE_IOERR;
+		}
+	}
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStream::copyFrom(std::istream& in, int chunkSize){
+	std::vector<char> chunk(chunkSize);
+	int total=size();
+	for(int offset=0; offset<total; offset+=chunkSize){
+		int n=std::min(chunkSize, total-offset);
+		in.read(chunk.data(), n);
+		n=static_cast<int>(in.gcount());
+		if(n==0){
+			break;
+		}
+		if(write(chunk.data(), n, offset)!=SQLITE_OK){
+			return m_errorCode;
+		}
+		if(in.bad()){
+			return SQLITE_IOERR;
+		}
+	}
+	return SQLITE_OK;
+}
+
+//######################################################################
+
+/**
+ * std::streambuf over a BlobStream, reading and writing through
+ * buffers of a fixed size. Seeking is supported within the BLOB;
+ * writing past its end fails.
+ */
+
+class BlobStreamBuf : public std::streambuf
+{
+	public:
+		explicit BlobStreamBuf(BlobStream& blob, int bufferSize=BlobStream::CHUNK_SIZE);
+
+		virtual ~BlobStreamBuf();
+
+	protected:
+		int_type underflow() override;
+		int_type overflow(int_type ch) override;
+		int sync() override;
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+		pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+	private:
+		BlobStream& m_blob;
+		std::vector<char> m_getBuffer;
+		std::vector<char> m_putBuffer;
+		int m_getOffset;   // BLOB offset of eback()
+		int m_putOffset;   // BLOB offset of pbase()
+
+		bool flush();
+		void moveTo(int offset);
+};
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::BlobStreamBuf(BlobStream& blob, int bufferSize)
+:m_blob(blob),
+m_getBuffer(bufferSize),
+m_putBuffer(bufferSize),
+m_getOffset(0),
+m_putOffset(0)
+{
+	moveTo(0);
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::~BlobStreamBuf(){
+	flush();
+}
+
+//----------------------------------------------------------------------
+
+inline void BlobStreamBuf::moveTo(int offset){
+	m_getOffset=offset;
+	m_putOffset=offset;
+	setg(m_getBuffer.data(), m_getBuffer.data(), m_getBuffer.data());
+	setp(m_putBuffer.data(), m_putBuffer.data()+m_putBuffer.size());
+}
+
+//----------------------------------------------------------------------
+
+inline bool BlobStreamBuf::flush(){
+	int n=static_cast<int>(pptr()-pbase());
+	if(n==0){
+		return true;
+	}
+	if(m_blob.write(pbase(), n, m_putOffset)!=SQLITE_OK){
+		return false;
+	}
+	m_putOffset+=n;
+	setp(m_putBuffer.data(), m_putBuffer.data()+m_putBuffer.size());
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::int_type BlobStreamBuf::underflow(){
+	if(gptr()<egptr()){
+		return traits_type::to_int_type(*gptr());
+	}
+	int offset=m_getOffset+static_cast<int>(egptr()-eback());
+	int n=std::min(static_cast<int>(m_getBuffer.size()), m_blob.size()-offset);
+	if(n<=0 || m_blob.read(m_getBuffer.data(), n, offset)!=SQLITE_OK){
+		return traits_type::eof();
+	}
+	m_getOffset=offset;
+	setg(m_getBuffer.data(), m_getBuffer.data(), m_getBuffer.data()+n);
+	return traits_type::to_int_type(*gptr());
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::int_type BlobStreamBuf::overflow(int_type ch){
+	if(!flush()){
+		return traits_type::eof();
+	}
+	if(traits_type::eq_int_type(ch, traits_type::eof())){
+		return traits_type::not_eof(ch);
+	}
+	*pptr()=traits_type::to_char_type(ch);
+	pbump(1);
+	return ch;
+}
+
+//----------------------------------------------------------------------
+
+inline int BlobStreamBuf::sync(){
+	return flush() ? 0 : -1;
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::pos_type BlobStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which){
+	off_type current;
+	if(which & std::ios_base::out){
+		current=m_putOffset+(pptr()-pbase());
+	}
+	else{
+		current=m_getOffset+(gptr()-eback());
+	}
+
+	off_type target;
+	switch(dir){
+		case std::ios_base::beg:
+			target=off;
+			break;
+		case std::ios_base::cur:
+			target=current+off;
+			break;
+		default:
+			target=m_blob.size()+off;
+			break;
+	}
+	if(target<0 || target>m_blob.size() || !flush()){
+		return pos_type(off_type(-1));
+	}
+	moveTo(static_cast<int>(target));
+	return pos_type(target);
+}
+
+//----------------------------------------------------------------------
+
+inline BlobStreamBuf::pos_type BlobStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which){
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+//######################################################################
+
+/**
+ * std::istream reading a BLOB through a BlobStreamBuf.
+ */
+
+class BlobIStream : public std::istream
+{
+	public:
+		explicit BlobIStream(BlobStream& blob, int bufferSize=BlobStream::CHUNK_SIZE)
+		:std::istream(nullptr),
+		m_buffer(blob, bufferSize)
+		{
+			rdbuf(&m_buffer);
+		}
+
+	private:
+		BlobStreamBuf m_buffer;
+};
+
+//######################################################################
+
+/**
+ * std::ostream writing a BLOB through a BlobStreamBuf.
+ */
+
+class BlobOStream : public std::ostream
+{
+	public:
+		explicit BlobOStream(BlobStream& blob, int bufferSize=BlobStream::CHUNK_SIZE)
+		:std::ostream(nullptr),
+		m_buffer(blob, bufferSize)
+		{
+			rdbuf(&m_buffer);
+		}
+
+	private:
+		BlobStreamBuf m_buffer;
+};
+
+#endif
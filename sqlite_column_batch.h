@@ -0,0 +1,273 @@
+/*********************************************************************
+* ColumnBatch class                                                  *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_COLUMN_BATCH_H
+#define SQLITE_COLUMN_BATCH_H
+
+#include <cstdint>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sqlite3.h>
+
+//######################################################################
+
+/**
+ * A batch of rows stored column by column (structure of arrays), filled
+ * by SqlRows::fetchColumns.
+ *
+ * Each column is stored according to its kind:
+ * - Integer: contiguous int64_t values in Column::integers
+ * - Real: contiguous double values in Column::reals
+ * - Bytes: text or blob, Column::offsets (rows+1 entries) into the
+ *     contiguous Column::bytes buffer
+ *
+ * NULL values are flagged in Column::nulls, a bitmap with one bit per row
+ * (bit r%64 of word r/64); their slot holds 0, 0.0 or an empty value.
+ *
+ * The kind of a column comes from the affinity of its declared type or,
+ * when that gives no hint (expressions, BLOB or NUMERIC columns), from
+ * the type of its value in the first row of the batch. Values of other
+ * types are converted by SQLite.
+ */
+
+class ColumnBatch
+{
+	public:
+		enum class Kind
+		{
+			Integer,
+			Real,
+			Bytes,
+		};
+
+		struct Column
+		{
+			std::string name;
+			Kind kind;
+			std::vector<int64_t> integers;
+			std::vector<double> reals;
+			std::vector<size_t> offsets;
+			std::vector<char> bytes;
+			std::vector<uint64_t> nulls;
+
+			bool isNull(size_t row) const{
+				return (nulls[row>>6]>>(row & 63)) & 1;
+			}
+
+			std::string_view bytesAt(size_t row) const{
+				return std::string_view(bytes.data()+offsets[row], offsets[row+1]-offsets[row]);
+			}
+		};
+
+		ColumnBatch();
+
+		/**
+		 * Number of rows in the batch.
+		 */
+		size_t rows() const;
+
+		/**
+		 * Number of columns in the batch.
+		 */
+		int columnCount() const;
+
+		const Column& column(int i) const;
+
+		const std::vector<Column>& columns() const;
+
+		/**
+		 * Remove all the rows, keeping the columns and the memory
+		 * allocated, so the batch can be refilled without allocating.
+		 */
+		void clear();
+
+		/**
+		 * Set up the columns for the result of statement, which must
+		 * be positioned on a row, and remove all the rows. Columns with
+		 * the same names as the current ones keep their names and 
+		 * memory, their kind is taken from statement again.
+		 */
+		void setColumns(sqlite3_stmt* statement);
+
+		/**
+		 * Append the current row of statement.
+		 */
+		void appendRow(sqlite3_stmt* statement);
+
+		/**
+		 * Reserve memory for n rows in the fixed size columns.
+		 */
+		void reserve(size_t n);
+
+	private:
+		std::vector<Column> m_columns;
+		size_t m_rows;
+
+		static Kind kindOf(sqlite3_stmt* statement, int i);
+};
+
+//----------------------------------------------------------------------
+
+inline ColumnBatch::ColumnBatch()
+:m_rows(0)
+{}
+
+//----------------------------------------------------------------------
+
+inline size_t ColumnBatch::rows() const{
+	return m_rows;
+}
+
+//----------------------------------------------------------------------
+
+inline int ColumnBatch::columnCount() const{
+	return static_cast<int>(m_columns.size());
+}
+
+//----------------------------------------------------------------------
+
+inline const ColumnBatch::Column& ColumnBatch::column(int i) const{
+	return m_columns[i];
+}
+
+//----------------------------------------------------------------------
+
+inline const std::vector<ColumnBatch::Column>& ColumnBatch::columns() const{
+	return m_columns;
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnBatch::clear(){
+	for(Column& column : m_columns){
+		column.integers.clear();
+		column.reals.clear();
+		column.bytes.clear();
+		column.offsets.assign(1, 0);
+		column.nulls.clear();
+	}
+	m_rows=0;
+}
+
+//----------------------------------------------------------------------
+
+inline ColumnBatch::Kind ColumnBatch::kindOf(sqlite3_stmt* statement, int i){
+	// affinity rules of https://www.sqlite.org/datatype3.html
+	const char* declType=sqlite3_column_decltype(statement, i);
+	if(declType && *declType){
+		std::string type(declType);
+		for(char& c : type){
+			c=static_cast<char>(toupper(static_cast<unsigned char>(c)));
+		}
+		if(type.find("INT")!=std::string::npos){
+			return Kind::Integer;
+		}
+		if(type.find("CHAR")!=std::string::npos || type.find("CLOB")!=std::string::npos || type.find("TEXT")!=std::string::npos){
+			return Kind::Bytes;
+		}
+		if(type.find("REAL")!=std::string::npos || type.find("FLOA")!=std::string::npos || type.find("DOUB")!=std::string::npos){
+			return Kind::Real;
+		}
+	}
+	switch(sqlite3_column_type(statement, i)){
+		case SQLITE_INTEGER:
+			return Kind::Integer;
+		case SQLITE_FLOAT:
+			return Kind::Real;
+		default:
+			return Kind::Bytes;
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnBatch::setColumns(sqlite3_stmt* statement){
+	int numColumns=sqlite3_column_count(statement);
+	bool same=(numColumns==columnCount());
+	for(int i=0; same && i<numColumns; i++){
+		const char* name=sqlite3_column_name(statement, i);
+		same=(name && m_columns[i].name==name);
+	}
+	if(!same){
+		m_columns.resize(numColumns);
+		for(int i=0; i<numColumns; i++){
+			const char* name=sqlite3_column_name(statement, i);
+			m_columns[i].name=name ? name : "";
+		}
+	}
+	// the same names do not mean the same types: "select 1 as v" and
+	// "select 'abc' as v"
+	for(int i=0; i<numColumns; i++){
+		m_columns[i].kind=kindOf(statement, i);
+	}
+	clear();
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnBatch::reserve(size_t n){
+	for(Column& column : m_columns){
+		switch(column.kind){
+			case Kind::Integer:
+				column.integers.reserve(n);
+				break;
+			case Kind::Real:
+				column.reals.reserve(n);
+				break;
+			default:
+				column.offsets.reserve(n+1);
+				break;
+		}
+		column.nulls.reserve((n+63)/64);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnBatch::appendRow(sqlite3_stmt* statement){
+	const size_t word=m_rows>>6;
+	const uint64_t bit=uint64_t(1)<<(m_rows & 63);
+	for(size_t i=0; i<m_columns.size(); i++){
+		Column& column=m_columns[i];
+		if(column.nulls.size()<=word){
+			column.nulls.push_back(0);
+		}
+		// NULL reads as 0, 0.0 or a null pointer: the type is only
+		// checked for those values, not for every cell
+		const int col=static_cast<int>(i);
+		bool isZero;
+		switch(column.kind){
+			case Kind::Integer:
+				column.integers.push_back(sqlite3_column_int64(statement, col));
+				isZero=(column.integers.back()==0);
+				break;
+			case Kind::Real:
+				column.reals.push_back(sqlite3_column_double(statement, col));
+				isZero=(column.reals.back()==0.0);
+				break;
+			default:
+				{
+					// sqlite3_column_blob before sqlite3_column_bytes
+					const char* data=static_cast<const char*>(sqlite3_column_blob(statement, col));
+					isZero=(data==nullptr);
+					if(!isZero){
+						column.bytes.insert(column.bytes.end(), data, data+sqlite3_column_bytes(statement, col));
+					}
+					column.offsets.push_back(column.bytes.size());
+				}
+				break;
+		}
+		if(isZero && sqlite3_column_type(statement, col)==SQLITE_NULL){
+			column.nulls[word]|=bit;
+		}
+	}
+	m_rows++;
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*********************************************************************
+* ColumnIndex class                                                  *
+* ColumnRef struct                                                   *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_COLUMN_INDEX_H
+#define SQLITE_COLUMN_INDEX_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+//######################################################################
+
+/**
+ * Handle to a column of a result set, obtained once with
+ * SqlRows::column and then used with the accessors of SqlRows
+ * at the cost of an array index.
+ */
+
+struct ColumnRef
+{
+	explicit ColumnRef(int index)
+	:m_index(index)
+	{}
+
+	int m_index;
+};
+
+//######################################################################
+
+/**
+ * Flat open addressing table from column name to column position,
+ * built once per prepared statement.
+ *
+ * When two columns have the same name the last one wins.
+ */
+
+class ColumnIndex
+{
+	public:
+		ColumnIndex();
+
+		/**
+		 * Load the names of the columns of statement, replacing
+		 * any previous content.
+		 */
+		void build(sqlite3_stmt* statement);
+
+		/**
+		 * Remove all the names, ColumnIndex::built will return false.
+		 */
+		void clear();
+
+		bool built() const;
+
+		/**
+		 * @return the position of the column with name field or -1
+		 *     if there is no such column.
+		 */
+		int find(const char* field) const;
+
+	private:
+		struct Slot
+		{
+			uint32_t hash;
+			int offset;
+			int column;
+		};
+
+		std::vector<Slot> m_slots;
+		std::string m_names;
+		uint32_t m_mask;
+		bool m_built;
+
+		static uint32_t hashName(const char* name);
+};
+
+//----------------------------------------------------------------------
+
+inline ColumnIndex::ColumnIndex()
+:m_mask(0),
+m_built(false)
+{}
+
+//----------------------------------------------------------------------
+
+inline uint32_t ColumnIndex::hashName(const char* name){
+	// FNV-1a
+	uint32_t h=2166136261u;
+	for(const unsigned char* p=reinterpret_cast<const unsigned char*>(name); *p; p++){
+		h^=*p;
+		h*=16777619u;
+	}
+	return h;
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnIndex::build(sqlite3_stmt* statement){
+	int numColumns=sqlite3_column_count(statement);
+
+	size_t capacity=4;
+	while(capacity<2*static_cast<size_t>(numColumns)){
+		capacity<<=1;
+	}
+	m_slots.assign(capacity, Slot{0, 0, -1});
+	m_mask=static_cast<uint32_t>(capacity-1);
+	m_names.clear();
+
+	for(int i=0; i<numColumns; i++){
+		const char* name=sqlite3_column_name(statement, i);
+		if(!name){
+			continue;
+		}
+		uint32_t h=hashName(name);
+		uint32_t k=h & m_mask;
+		while(m_slots[k].column>=0){
+			if(m_slots[k].hash==h && std::strcmp(m_names.c_str()+m_slots[k].offset, name)==0){
+				break;
+			}
+			k=(k+1) & m_mask;
+		}
+		if(m_slots[k].column<0){
+			m_slots[k].hash=h;
+			m_slots[k].offset=static_cast<int>(m_names.size());
+			m_names.append(name);
+			m_names.push_back('\0');
+		}
+		m_slots[k].column=i;
+	}
+	m_built=true;
+}
+
+//----------------------------------------------------------------------
+
+inline void ColumnIndex::clear(){
+	m_slots.clear();
+	m_names.clear();
+	m_mask=0;
+	m_built=false;
+}
+
+//----------------------------------------------------------------------
+
+inline bool ColumnIndex::built() const{
+	return m_built;
+}
+
+//----------------------------------------------------------------------
+
+inline int ColumnIndex::find(const char* field) const{
+	if(m_slots.empty()){
+		return -1;
+	}
+	uint32_t h=hashName(field);
+	uint32_t k=h & m_mask;
+	while(m_slots[k].column>=0){
+		if(m_slots[k].hash==h && std::strcmp(m_names.c_str()+m_slots[k].offset, field)==0){
+			return m_slots[k].column;
+		}
+		k=(k+1) & m_mask;
+	}
+	return -1;
+}
+
+#endif
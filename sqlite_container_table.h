@@ -0,0 +1,500 @@
+/*********************************************************************
+* TableColumn class                                                  *
+* ContainerTable class                                               *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_CONTAINER_TABLE_H
+#define SQLITE_CONTAINER_TABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <sqlite3.h>
+
+#include "sqlite_db_traits.h"
+
+//######################################################################
+
+/**
+ * A column of a ContainerTable: the member of the element type T read
+ * by the column, or the element itself for a container of values.
+ * Made with tableColumn, sortedKeyColumn or elementColumn.
+ */
+template<typename T, typename M>
+struct TableColumn
+{
+	typedef M value_type;
+
+	const char* name;
+	M T::* member;
+	bool sortedKey;
+
+	const M& get(const T& element) const{
+		return element.*member;
+	}
+};
+
+
+template<typename T>
+struct ElementColumn
+{
+	typedef T value_type;
+
+	const char* name;
+	bool sortedKey;
+
+	const T& get(const T& element) const{
+		return element;
+	}
+};
+
+//----------------------------------------------------------------------
+
+template<typename T, typename M>
+inline TableColumn<T, M> tableColumn(const char* name, M T::* member){
+	return TableColumn<T, M>{name, member, false};
+}
+
+/**
+ * A column the elements of the container are sorted by (ascending):
+ * equality and range constraints on it are resolved by binary search.
+ */
+template<typename T, typename M>
+inline TableColumn<T, M> sortedKeyColumn(const char* name, M T::* member){
+	return TableColumn<T, M>{name, member, true};
+}
+
+template<typename T>
+inline ElementColumn<T> elementColumn(const char* name, bool sortedKey=false){
+	return ElementColumn<T>{name, sortedKey};
+}
+
+//######################################################################
+
+/*
+ * SQL type of a column of C++ type M, and how its value is handed to
+ * SQLite: text is passed with SQLITE_STATIC, it stays in the container.
+ */
+template<typename M>
+struct TableValue
+{
+	static constexpr bool is_integer=std::is_integral_v<M>;
+	static constexpr bool is_real=std::is_floating_point_v<M>;
+	static constexpr bool is_text=std::is_same_v<M, std::string> || std::is_same_v<M, std::string_view> || std::is_same_v<M, const char*>;
+	static constexpr bool sortable=true;
+
+	static_assert(is_integer || is_real || is_text, "column type should be arithmetic, std::string, std::string_view, const char* or std::optional of one of them");
+
+	static const char* sqlType(){
+		return is_integer ? "INTEGER" : (is_real ? "REAL" : "TEXT");
+	}
+
+	static void result(sqlite3_context* context, const M& value){
+		if constexpr(is_integer){
+			sqlite3_result_int64(context, static_cast<sqlite3_int64>(value));
+		}
+		else if constexpr(is_real){
+			sqlite3_result_double(context, static_cast<double>(value));
+		}
+		else if constexpr(std::is_same_v<M, const char*>){
+			if(value){
+				sqlite3_result_text(context, value, -1, SQLITE_STATIC);
+			}
+			else{
+				sqlite3_result_null(context);
+			}
+		}
+		else{
+			sqlite3_result_text64(context, value.data(), value.size(), SQLITE_STATIC, SQLITE_UTF8);
+		}
+	}
+
+	/*
+	 * Compare key with the value of a constraint as SQLite would (BINARY
+	 * collation): <0, 0 or >0. nullopt when the comparison depends on
+	 * affinity conversions (text against a number), the constraint is
+	 * then not used to narrow the scan and left to SQLite.
+	 */
+	static std::optional<int> compare(const M& key, sqlite3_value* value){
+		int type=sqlite3_value_type(value);
+		if constexpr(is_integer){
+			if(type==SQLITE_INTEGER){
+				sqlite3_int64 v=sqlite3_value_int64(value);
+				return (static_cast<sqlite3_int64>(key)>v)-(static_cast<sqlite3_int64>(key)<v);
+			}
+		}
+		if constexpr(is_integer || is_real){
+			if(type==SQLITE_INTEGER || type==SQLITE_FLOAT){
+				double v=sqlite3_value_double(value);
+				return (static_cast<double>(key)>v)-(static_cast<double>(key)<v);
+			}
+		}
+		else{
+			if(type==SQLITE_TEXT){
+				std::string_view text=ValueData<std::string_view>::getValueData(value);
+				int c;
+				if constexpr(std::is_same_v<M, const char*>){
+					c=(key ? std::string_view(key) : std::string_view()).compare(text);
+				}
+				else{
+					c=std::string_view(key).compare(text);
+				}
+				return (c>0)-(c<0);
+			}
+		}
+		return std::nullopt;
+	}
+};
+
+
+template<typename M>
+struct TableValue<std::optional<M>>
+{
+	// NULL keys have no place in a sorted order
+	static constexpr bool sortable=false;
+
+	static const char* sqlType(){
+		return TableValue<M>::sqlType();
+	}
+
+	static void result(sqlite3_context* context, const std::optional<M>& value){
+		if(value){
+			TableValue<M>::result(context, *value);
+		}
+		else{
+			sqlite3_result_null(context);
+		}
+	}
+};
+
+//######################################################################
+
+/**
+ * A read-only, eponymous virtual table module over a contiguous
+ * container (std::vector, std::array...) of elements, registered by
+ * SQLiteDB::registerContainer. Rows are read straight from the
+ * container, nothing is copied into SQLite.
+ *
+ * With a sorted key column, xBestIndex takes the =, <, <=, >, >= and IN
+ * constraints on the key and xFilter resolves them by binary search; the
+ * rows come out in key order, so ORDER BY key is consumed as well. The
+ * constraints are not omitted: SQLite checks them again on the rows
+ * returned, which keeps the type conversion rules of SQL exact.
+ *
+ * The rowid of a row is its position in the container.
+ */
+template<typename Container, typename... Columns>
+class ContainerTable
+{
+	public:
+		typedef std::remove_cv_t<std::remove_reference_t<decltype(*std::data(std::declval<const Container&>()))>> Element;
+
+		// pAux of the module
+		struct Source
+		{
+			const Container* container;
+			std::tuple<Columns...> columns;
+		};
+
+		static const sqlite3_module* module();
+
+		// xDestroy of sqlite3_create_module_v2
+		static void destroySource(void* source){
+			delete static_cast<Source*>(source);
+		}
+
+		/**
+		 * The CREATE TABLE statement passed to sqlite3_declare_vtab.
+		 */
+		static std::string schema(const Source& source);
+
+	private:
+		enum IndexFlags
+		{
+			EQ=1,
+			LOWER_GT=2,
+			LOWER_GE=4,
+			UPPER_LT=8,
+			UPPER_LE=16
+		};
+
+		struct Table : sqlite3_vtab
+		{
+			const Source* source;
+		};
+
+		struct Cursor : sqlite3_vtab_cursor
+		{
+			size_t row;
+			size_t end;
+		};
+
+		static int sortedKey(const Source& source);
+
+		static int connect(sqlite3* db, void* aux, int argc, const char* const* argv, sqlite3_vtab** vtab, char** error);
+		static int bestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info);
+		static int filter(sqlite3_vtab_cursor* cursor, int idxNum, const char* idxStr, int argc, sqlite3_value** argv);
+		static int column(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int i);
+
+		// narrow [row, end) of cursor to the constraints of idxNum on column K
+		template<size_t K>
+		static void narrow(Cursor* cursor, const Source& source, int idxNum, sqlite3_value** argv);
+
+		template<size_t... I>
+		static void narrowKey(Cursor* cursor, const Source& source, int key, int idxNum, sqlite3_value** argv, std::index_sequence<I...>){
+			((static_cast<int>(I)==key ? narrow<I>(cursor, source, idxNum, argv) : void()), ...);
+		}
+};
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline const sqlite3_module* ContainerTable<Container, Columns...>::module(){
+	static const sqlite3_module tableModule=[]{
+		sqlite3_module m{};
+		m.iVersion=1;
+		// no xCreate: eponymous-only, the table exists in every schema
+		// under the name of the module, without CREATE VIRTUAL TABLE
+		m.xCreate=nullptr;
+		m.xConnect=&connect;
+		m.xBestIndex=&bestIndex;
+		m.xDisconnect=[](sqlite3_vtab* vtab){
+			delete static_cast<Table*>(vtab);
+			return SQLITE_OK;
+		};
+		m.xDestroy=m.xDisconnect;
+		m.xOpen=[](sqlite3_vtab*, sqlite3_vtab_cursor** cursor){
+			Cursor* c=new (std::nothrow) Cursor();
+			*cursor=c;
+			return c ? SQLITE_OK : SQLITE_NOMEM;
+		};
+		m.xClose=[](sqlite3_vtab_cursor* cursor){
+			delete static_cast<Cursor*>(cursor);
+			return SQLITE_OK;
+		};
+		m.xFilter=&filter;
+		m.xNext=[](sqlite3_vtab_cursor* cursor){
+			static_cast<Cursor*>(cursor)->row++;
+			return SQLITE_OK;
+		};
+		m.xEof=[](sqlite3_vtab_cursor* cursor){
+			Cursor* c=static_cast<Cursor*>(cursor);
+			return c->row>=c->end ? 1 : 0;
+		};
+		m.xColumn=&column;
+		m.xRowid=[](sqlite3_vtab_cursor* cursor, sqlite3_int64* rowid){
+			*rowid=static_cast<sqlite3_int64>(static_cast<Cursor*>(cursor)->row);
+			return SQLITE_OK;
+		};
+		return m;
+	}();
+	return &tableModule;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline std::string ContainerTable<Container, Columns...>::schema(const Source& source){
+	std::string sql("CREATE TABLE x(");
+	std::apply([&sql](const Columns&... columns){
+		((sql+=quoteIdentifier(columns.name)+" "+TableValue<typename Columns::value_type>::sqlType()+","), ...);
+	}, source.columns);
+	sql.back()=')';
+	return sql;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline int ContainerTable<Container, Columns...>::sortedKey(const Source& source){
+	int key=-1;
+	int i=0;
+	std::apply([&key, &i](const Columns&... columns){
+		((key=(key<0 && columns.sortedKey && TableValue<typename Columns::value_type>::sortable) ? i : key, i++), ...);
+	}, source.columns);
+	return key;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline int ContainerTable<Container, Columns...>::connect(sqlite3* db, void* aux, int, const char* const*, sqlite3_vtab** vtab, char** error){
+	const Source* source=static_cast<const Source*>(aux);
+	int rc=sqlite3_declare_vtab(db, schema(*source).c_str());
+	if(rc!=SQLITE_OK){
+		*error=sqlite3_mprintf("%s", sqlite3_errmsg(db));
+		return rc;
+	}
+	sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+	Table* table=new (std::nothrow) Table();
+	if(!table){
+		return SQLITE_NOMEM;
+	}
+	table->source=source;
+	*vtab=table;
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline int ContainerTable<Container, Columns...>::bestIndex(sqlite3_vtab* vtab, sqlite3_index_info* info){
+	const Source& source=*static_cast<Table*>(vtab)->source;
+	const double rows=static_cast<double>(std::size(*source.container))+1.0;
+	const int key=sortedKey(source);
+
+	// the constraint used for each flag, in the order of argv in filter
+	int used[3]={-1, -1, -1};
+	int flags=0;
+	for(int i=0; key>=0 && i<info->nConstraint; i++){
+		const sqlite3_index_info::sqlite3_index_constraint& constraint=info->aConstraint[i];
+		if(!constraint.usable || constraint.iColumn!=key || sqlite3_stricmp(sqlite3_vtab_collation(info, i), "BINARY")!=0){
+			continue;
+		}
+		switch(constraint.op){
+			case SQLITE_INDEX_CONSTRAINT_EQ:
+				if(!(flags&EQ)){
+					flags|=EQ;
+					used[0]=i;
+				}
+				break;
+			case SQLITE_INDEX_CONSTRAINT_GT:
+			case SQLITE_INDEX_CONSTRAINT_GE:
+				if(!(flags&(LOWER_GT|LOWER_GE))){
+					flags|=(constraint.op==SQLITE_INDEX_CONSTRAINT_GT) ? LOWER_GT : LOWER_GE;
+					used[1]=i;
+				}
+				break;
+			case SQLITE_INDEX_CONSTRAINT_LT:
+			case SQLITE_INDEX_CONSTRAINT_LE:
+				if(!(flags&(UPPER_LT|UPPER_LE))){
+					flags|=(constraint.op==SQLITE_INDEX_CONSTRAINT_LT) ? UPPER_LT : UPPER_LE;
+					used[2]=i;
+				}
+				break;
+		}
+	}
+	int argvIndex=0;
+	for(int i : used){
+		if(i>=0){
+			info->aConstraintUsage[i].argvIndex=++argvIndex;
+		}
+	}
+	info->idxNum=flags;
+
+	const double search=std::log2(rows);
+	if(flags&EQ){
+		info->estimatedCost=search;
+		info->estimatedRows=1;
+	}
+	else if(flags){
+		int bounds=((flags&(LOWER_GT|LOWER_GE)) ? 1 : 0)+((flags&(UPPER_LT|UPPER_LE)) ? 1 : 0);
+		info->estimatedCost=search+rows/(bounds*2);
+		info->estimatedRows=static_cast<sqlite3_int64>(rows/(bounds*2));
+	}
+	else{
+		info->estimatedCost=rows;
+		info->estimatedRows=static_cast<sqlite3_int64>(rows);
+	}
+
+	if(key>=0 && info->nOrderBy==1 && info->aOrderBy[0].iColumn==key && !info->aOrderBy[0].desc){
+		info->orderByConsumed=1;
+	}
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+template<size_t K>
+inline void ContainerTable<Container, Columns...>::narrow(Cursor* cursor, const Source& source, int idxNum, sqlite3_value** argv){
+	typedef TableValue<typename std::tuple_element_t<K, std::tuple<Columns...>>::value_type> Value;
+	if constexpr(Value::sortable){
+		const Element* data=std::data(*source.container);
+		const auto& keyColumn=std::get<K>(source.columns);
+
+		// first row of [begin, end) whose key compared with value is not below limit
+		auto bound=[&](size_t begin, size_t end, sqlite3_value* value, int limit){
+			return static_cast<size_t>(std::partition_point(data+begin, data+end, [&](const Element& element){
+				return *Value::compare(keyColumn.get(element), value)<limit;
+			})-data);
+		};
+		// the comparison depends on the type of value only: one that goes
+		// through affinity conversions leaves the range to SQLite
+		auto usable=[&](sqlite3_value* value){
+			return cursor->end>0 && Value::compare(keyColumn.get(data[0]), value).has_value();
+		};
+
+		int arg=0;
+		if(idxNum&EQ){
+			sqlite3_value* value=argv[arg++];
+			if(usable(value)){
+				size_t begin=bound(cursor->row, cursor->end, value, 0);
+				cursor->end=bound(begin, cursor->end, value, 1);
+				cursor->row=begin;
+			}
+		}
+		if(idxNum&(LOWER_GT|LOWER_GE)){
+			sqlite3_value* value=argv[arg++];
+			if(usable(value)){
+				cursor->row=bound(cursor->row, cursor->end, value, (idxNum&LOWER_GT) ? 1 : 0);
+			}
+		}
+		if(idxNum&(UPPER_LT|UPPER_LE)){
+			sqlite3_value* value=argv[arg++];
+			if(usable(value)){
+				cursor->end=bound(cursor->row, cursor->end, value, (idxNum&UPPER_LT) ? 0 : 1);
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline int ContainerTable<Container, Columns...>::filter(sqlite3_vtab_cursor* cursor, int idxNum, const char*, int argc, sqlite3_value** argv){
+	Cursor* c=static_cast<Cursor*>(cursor);
+	const Source& source=*static_cast<Table*>(cursor->pVtab)->source;
+	c->row=0;
+	c->end=std::size(*source.container);
+	if(idxNum==0){
+		return SQLITE_OK;
+	}
+
+	// no row is equal to, above or below NULL
+	for(int i=0; i<argc; i++){
+		if(sqlite3_value_type(argv[i])==SQLITE_NULL){
+			c->end=0;
+			return SQLITE_OK;
+		}
+	}
+	narrowKey(c, source, sortedKey(source), idxNum, argv, std::index_sequence_for<Columns...>());
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+template<typename Container, typename... Columns>
+inline int ContainerTable<Container, Columns...>::column(sqlite3_vtab_cursor* cursor, sqlite3_context* context, int i){
+	Cursor* c=static_cast<Cursor*>(cursor);
+	const Source& source=*static_cast<Table*>(cursor->pVtab)->source;
+	const Element& element=std::data(*source.container)[c->row];
+	int k=0;
+	std::apply([&](const Columns&... columns){
+		((k++==i ? TableValue<typename Columns::value_type>::result(context, columns.get(element)) : void()), ...);
+	}, source.columns);
+	return SQLITE_OK;
+}
+
+#endif
@@ -1,555 +1,2018 @@
-/*********************************************************************
-* SqlRow class                               								*
-* SQLiteDB class                                                     *
-*                                                                    *
-* Version: 2.0                                                       *
-* Date:    16-10-2021                                                *
-* Author:  Dan Machado                                               *                                         *
-**********************************************************************/
-#ifndef SQLITE_DB_H
-#define SQLITE_DB_H
-
-#include <cstring>
-#include <string>
-#include <sqlite3.h> 
-
-#include "sqlite_db_traits.h"
-#include "sqlite_result_rows.h"
-
-//######################################################################
-
-typedef void (*SqlRowFunc)(SqlRows&);
-
-/**
- * Wrapper for SQLite C++ Interface.
- * 
- * Simplifies quering a database using the SQLite C++ Interface. 
- * 
- */
-
-class SQLiteDB 
-{
-	public:
-		/**
-		 * Constructor, opens a connection to an SQLite database file 
-		 * using sqlite3_open_v2
-		 *
-	    * @param dbName Database file name.
-	    * @param openMode The flags parameter to sqlite3_open_v2 
-	    * @param zVfs The name of the sqlite3_vfs object that defines 
-	    *     the operating system interface that the new database 
-	    *     connection should use.
-	    * @throws const char* thrown if it is not possible to open 
-	    *     the connection to the database.  
-	    * 
-	    * @see [sqlite3_open_v2](https://www3.sqlite.org/c3ref/open.html)
-       */
-		SQLiteDB(const char* dbName, int openMode, const char* zVfs);
-
-       /**
-		 * Constructor, opens a connection to an SQLite database file 
-		 * using sqlite3_open_v2
-		 *
-	    * @param dbName Database file name.
-	    * @param openMode The flags parameter to sqlite3_open_v2 
-	    * @throws const char* thrown if it is not possible to open 
-	    *    the connection to the database.  
-	    * 
-	    * @see [sqlite3_open_v2](https://www3.sqlite.org/c3ref/open.html)
-       */
-		SQLiteDB(const char* dbName, int openMode=SQLITE_OPEN_READWRITE);
-		
-		 /**
-		 * Constructor, opens a connection to an SQLite database file 
-		 * using sqlite3_open16
-		 *
-	    * @param dbName Database file name.
-	    * @throws const char* thrown if it is not possible to open 
-	    *     the connection to the database.  
-	    * 
-	    * @see [sqlite3_open16](https://www3.sqlite.org/c3ref/open.html) 
-       */
-		SQLiteDB(const void* dbName);
-
-		/**
-		 * Destructor, close the database connection.
-		 */
-		virtual ~SQLiteDB();
-
-		/**
-		 * Return the error code of the last error ocurred 
-		 * 
-		 * @see [errcode](http://www.sqlite.org/c3ref/errcode.html).
-		 */
-		int lastErrorCode();
-
-		/**
-		 * Return a description of the last error 
-		 * 
-		 * @see [errcode](http://www.sqlite.org/c3ref/errcode.html).
-		 */
-		const char* lastErrorMsg();
-		
-		/**
-		 * Returns the rowid of the most recent successful INSERT into a 
-		 * rowid table or virtual table on database connection D. Inserts 
-		 * into WITHOUT ROWID tables are not recorded. If no successful 
-		 * INSERTs into rowid tables have ever occurred on the database 
-		 * connection D, then sqlite3_last_insert_rowid(D) returns zero.
-		 * 
-		 * @see [Last Insert Rowid](https://sqlite.org/c3ref/last_insert_rowid.html)
-		 */
-		sqlite3_int64 lastInsertID();
-
-		/**
-		 * Returns true if any row was modified, inserted or deleted by the 
-		 * most recently completed INSERT, UPDATE or DELETE.
-		 * 
-		 * @see [Count The Number Of Rows Modified](https://sqlite.org/c3ref/changes.html)
-		 */
-		bool dataChanged() const;
-
-		/**
-		 * Execute a SQL query.
-		 *
-		 * @tparam UTF the type for the SQL query to execute it only accept 
-		 *       const char* for UTF8 and
-		 *       const void* for UTF16
-		 * @param query a SQL query
-		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
-		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
-		 * @return bool true if the query executes succefully.
-		 * 
-		 * @note according to the documentation, the only difference between 
-		 *      sqlite3_prepare_v2 and sqlite3_prepare_v3 is the prepFlags parameter.
-		 *      Also, currently there are just 3 valid flags (0x01, 0x02, 0x04).
-		 * 
-		 * @see [Prepare Flags](https://www3.sqlite.org/c3ref/c_prepare_normalize.html#sqlitepreparepersistent)
-		 */
-		template<typename UTF>
-		bool executeQuery(UTF query, unsigned int prepFlags=0);
-
-		/**
-		 * Execute a SQL query.
-		 *
-		 * @tparam UTF the type for the SQL query to execute it only accept 
-		 *       const char* for UTF8 and
-		 *       const void* for UTF16
-		 * @param query a SQL query
-		 * @param qParams wrapper structure for additional parameters needed
-		 *     by sqlite3_prepare_v2 and sqlite3_prepare16_v2
-		 * @return bool true if the query executes succefully.
-		 * 
-		 * @see QParams
-		 */
-		template<typename UTF>
-		bool executeQuery(UTF query, QParams qParams);
-		
-
-		//######################################################
-
-		/**
-		 * Execute a SQL query.
-		 * 
-		 * @param query a SQL query
-		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
-		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
-		 * @return a SqlRows object for the rows of the result of the query.
-		 * 
-		 * @see SqlRows
-		 */ 
-		template<typename UTF>
-		SqlRows getResultRows(UTF query, unsigned int prepFlags=0);
-
-		/**
-		 * Execute a SQL query.
-		 * 
-		 * @param query a SQL query
-		 * @param qParams wrapper for non trivial parameters of sqlite3_prepare_v2
-		 *     sqlite3_prepare_v3
-		 * @return a SqlRows object for the rows of the result of the query.
-		 * 
-		 * @see SqlRows
-		 */
-		template<typename UTF>
-		SqlRows getResultRows(UTF query, QParams qParams);
-
-		//######################################################
-		/**
-		 * Execute a SQL query and apply a callback function on 
-		 * each row of the result.
-		 * 
-		 * @param query a SQL statement to be executed.
-       * @param callback a function of type SqlRowFunc which will be 
-       *    applied to each row of the result.
-		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
-		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
-		 * 
-       * @see SqlRowFunc
-		 * 
-		 */
-		template<typename UTF> 
-		void applyToRows(UTF query, SqlRowFunc callback, unsigned int prepFlags=0);
-
-		/**
-		 * Overload of SQLiteDB::applyToRows using QParams
-		 * 
-		 */
-		template<typename UTF> 
-		void applyToRows(UTF query, SqlRowFunc callback, QParams qParams);
-
-		//######################################################
-
-		/**
-		 * Bind values to prepared SQL statement and execute the prepared query.
-		 * 
-		 * @param query a SQL template query with parameters '?'
-		 * @param args variadic number of arguments, one for each unspecified 
-		 *      parameter '?' and in the same order as they will be applied.
-		 * @return SqlRows object holding the rows in the result.
-		 * 
-		 * @note some of these parameters to be binded are convenient wrapper 
-		 *    structures that encapsulate specific parameters for the appropiate
-		 *    binding routines. For example to bind a blob we can use the wrapper
-		 *    structure blob(const void* v, int n, fn cbk);
-		 * 
-		 * @see BindParams
-		 */
-		template<typename UTF, typename... Args>
-		SqlRows executeSecureQuery(unsigned int prepFlags, UTF query, Args ...args);
-
-		/**
-		 * Overload for SQLiteDB::executeSecureQuery(unsigned int prepFlags, UTF query, Args ...args);
-		 */
-		template<typename UTF, typename... Args>
-		SqlRows executeSecureQuery(QParams qParams, UTF query, Args ...args);
-
-		/**
-		 * Wrapper for SQLiteDB::executeSecureQuery(0, query, args...);
-		 */
-		template<typename UTF, typename... Args>
-		SqlRows executeSecureQueryNf(UTF query, Args ...args);
-
-		//######################################################
-
-		/**
-		 * Execute a SQL query and get the value of the first column of 
-		 * the first row of the results.
-		 *
-		 * @param query a SQL query
-		 * @param[out] resultValue reference to a variable where the value 
-		 *     result of the query will be set
-		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
-		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
-		 * 
-		 * @return bool true if the query executes succefully and the result 
-		 *     has at least one row, false otherwise.
-		 */
-		template<typename UTF>
-		bool uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags=0);
-
-		/**
-		 * Overload for SQLiteDB::uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags=0)
-		 */
-		template<typename UTF>
-		bool uniqueAsInt(UTF query, int& resultValue, QParams qParams);
-
-		//######################################################
-		/**
-		 * Execute a SQL query and get the value of the first column of 
-		 * the first row of the results.
-		 *
-		 * @see SQLiteDB::uniqueAsInt
-		 */
-		template<typename UTF>
-		bool uniqueAsDouble(UTF query, double& resultValue, unsigned int prepFlags=0);
-
-		/**
-		 * Execute a SQL query and get the value of the first column of 
-		 * the first row of the results.
-		 *
-		 * @see SQLiteDB::uniqueAsInt
-		 */
-		template<typename UTF>
-		bool uniqueAsDouble(UTF query, double& resultValue, QParams qParams);
-
-		//######################################################
-
-		/**
-		 * Execute a SQL query and get the value of the first column of 
-		 * the first row of the results.
-		 *
-		 * @see SQLiteDB::uniqueAsInt
-		 */
-		template<typename UTF>
-		bool uniqueAsString(UTF query, std::string& resultValue, QParams qParams);
-	
-		/**
-		 * Execute a SQL query and get the value of the first column of 
-		 * the first row of the results.
-		 *
-		 * @see SQLiteDB::uniqueAsInt
-		 */
-		template<typename UTF>
-		bool uniqueAsString(UTF query, std::string& resultValue, unsigned int prepFlags=0);
-
-
-	protected:
-		sqlite3* m_DB;
-		/*The number of columns in the result set. As far as the 
-		 * query return at least a row, m_numColmns will be the 
-		 * number of columns in that row.
-		*/
-		int m_numColumns;
-
-		template<typename UTF, typename T, typename P=unsigned int>
-		bool getUnique(UTF query, T& resultValue, P qParams=0);
-
-		template<typename UTF, typename P=unsigned int>
-		SqlRows getResultRowsInner(UTF query, P qParams=0);
-
-		template<typename UTF, typename P=unsigned int> 
-		void applyToRowsInner(UTF query, SqlRowFunc callback, P qParams=0);
-
-		template<typename UTF, typename P>
-		bool executeQueryInner(UTF query, P qParams);
-};
-
-//======================================================================
-//======================================================================
-
-SQLiteDB::SQLiteDB(const char* dbName, int openMode, const char* zVfs)
-:m_DB(nullptr)
-{
-	if(sqlite3_open_v2(dbName, &m_DB, openMode, zVfs)>0){
-		throw sqlite3_errmsg(m_DB);
-	}
-}
-
-//======================================================================
-
-SQLiteDB::SQLiteDB(const char* dbName, int openMode)
-:SQLiteDB(dbName, openMode, NULL)
-{}
-
-//======================================================================
-SQLiteDB::SQLiteDB(const void* dbName)
-:m_DB(nullptr)
-{
-	if(sqlite3_open16(dbName, &m_DB)>0){
-		throw sqlite3_errmsg(m_DB);
-	}
-}
-//======================================================================
-inline SQLiteDB::~SQLiteDB(){
-	sqlite3_close(m_DB);
-}	
-//======================================================================
-inline int SQLiteDB::lastErrorCode()
-{
-	return sqlite3_errcode(m_DB);
-}
-//======================================================================
-inline const char* SQLiteDB::lastErrorMsg()
-{
-	return sqlite3_errmsg(m_DB);
-}
-
-//======================================================================
-
-inline sqlite3_int64 SQLiteDB::lastInsertID()
-{
-	return sqlite3_last_insert_rowid(m_DB);
-}
-
-//======================================================================
-
-inline bool SQLiteDB::dataChanged() const
-{
-	return (sqlite3_changes(m_DB) != 0);
-}
-
-//======================================================================
-
-
-template<typename UTF, typename T, typename P=unsigned int>
-bool SQLiteDB::getUnique(UTF query, T& resultValue, P qParams){
-	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
-	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
-
-	sqlite3_stmt* statement;
-	if(sqlite3Prepare(m_DB, query, &statement, qParams) == SQLITE_OK){
-		m_numColumns = sqlite3_column_count(statement);
-		if (m_numColumns){
-			if (SQLITE_ROW == sqlite3_step(statement)){
-				resultValue=ColumnData<T>::getColumnData(statement, 0);
-				sqlite3_finalize(statement);
-				return true;
-			}
-		}
-	}
-	sqlite3_finalize(statement);
-
-	return false;
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF, typename P=unsigned int>
-SqlRows SQLiteDB::getResultRowsInner(UTF query, P qParams) {
-	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
-	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
-
-	sqlite3_stmt* statement;
-	if(sqlite3Prepare(m_DB, query, &statement, qParams) == SQLITE_OK){
-		m_numColumns = sqlite3_column_count(statement);
-		if (m_numColumns){			
-			return statement;			
-			// no need to call sqlite3_finalize here as it will be called by 
-			//the destructor of SqlRow
-		}
-	}
-	sqlite3_finalize(statement);
-
-	return nullptr;
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF>
-SqlRows SQLiteDB::getResultRows(UTF query, QParams qParams){
-	return getResultRowsInner(query, qParams);
-}
-
-template<typename UTF>
-SqlRows SQLiteDB::getResultRows(UTF query, unsigned int prepFlags){
-	return getResultRowsInner(query, prepFlags);
-}
-
-template<typename UTF> 
-void SQLiteDB::applyToRows(UTF query, SqlRowFunc callback, QParams qParams){
-	applyToRowsInner(query, callback, qParams);
-}
-
-
-template<typename UTF> 
-void SQLiteDB::applyToRows(UTF query, SqlRowFunc callback, unsigned int prepFlags){
-	applyToRowsInner(query, callback, prepFlags);
-}
-
-template<typename UTF>
-bool SQLiteDB::executeQuery(UTF query, QParams qParams){
-	return executeQueryInner(query, qParams);
-}
-
-template<typename UTF>
-bool SQLiteDB::executeQuery(UTF query, unsigned int prepFlags){
-	return executeQueryInner(query, prepFlags);
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF, typename P=unsigned int>
-bool SQLiteDB::executeQueryInner(UTF query, P qParams) {
-	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
-	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
-
-	sqlite3_stmt* statement;
-	if(sqlite3Prepare(m_DB, query, &statement, qParams) == SQLITE_OK){
-		sqlite3_step(statement);		
-
-		return true;
-	}
-	sqlite3_finalize(statement);
-
-	return false;
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF, typename... Args>
-SqlRows SQLiteDB::executeSecureQuery(QParams qParams, UTF query, Args ...args){
-	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
-
-	sqlite3_stmt* statement;
-	if(sqlite3Prepare(m_DB, query, &statement, qParams) == SQLITE_OK){
-		if(SQLITE_OK==binding(statement, 0, std::forward<Args>(args)...)){
-			m_numColumns = sqlite3_column_count(statement);
-			if (m_numColumns){
-				return statement;
-			}
-			sqlite3_step(statement);
-		}
-	}
-	sqlite3_finalize(statement);
-
-	return nullptr;
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF, typename... Args>
-SqlRows SQLiteDB::executeSecureQuery(unsigned int prepFlags, UTF query, Args ...args){
-	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
-	if(prepFlags==0){
-		return 
-		executeSecureQuery<UTF>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8), query, std::forward<Args>(args)...);
-	}
-	return executeSecureQuery<UTF>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8, prepFlags), query, std::forward<Args>(args)...);
-}
-
-
-template<typename UTF, typename... Args>
-SqlRows SQLiteDB::executeSecureQueryNf(UTF query, Args ...args){
-	return executeSecureQuery<UTF, Args...>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8), query, std::forward<Args>(args)...);
-}
-//----------------------------------------------------------------------
-
-template<typename UTF, typename P=unsigned int>
-void SQLiteDB::applyToRowsInner(UTF query, SqlRowFunc callback, P qParams) {
-	SqlRows row=getResultRowsInner(query, qParams);
-	while(row.yield()){
-		callback(row);
-	}
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsInt(UTF query, int& resultValue, QParams qParams){
-	return getUnique<UTF, int>(query, resultValue, qParams);
-}
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags){
-	return getUnique<UTF, int>(query, resultValue, prepFlags);
-}
-//----------------------------------------------------------------------
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsDouble(UTF query, double& resultValue, QParams qParams){
-	return getUnique<UTF, double>(query, resultValue, qParams);
-}
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsDouble(UTF query, double& resultValue, unsigned int prepFlags){
-	return getUnique<UTF, double>(query, resultValue, prepFlags);
-}
-
-//----------------------------------------------------------------------
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsString(UTF query, std::string& resultValue, QParams qParams){
-	return getUnique<UTF, std::string>(query, resultValue, qParams);
-}
-
-template<typename UTF>
-bool SQLiteDB::uniqueAsString(UTF query, std::string& resultValue, unsigned int prepFlags){
-	return getUnique<UTF, std::string>(query, resultValue, prepFlags);
-}
-
-//######################################################################
-//######################################################################
-
-
-#endif
+/*********************************************************************
+* SqlRow class                               								*
+* SQLiteDB class                                                     *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_DB_H
+#define SQLITE_DB_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <tuple>
+#include <fstream>
+#include <functional>
+#include <sqlite3.h> 
+
+#include "sqlite_db_traits.h"
+#include "sqlite_function.h"
+#include "sqlite_container_table.h"
+#include "sqlite_statement_cache.h"
+#include "sqlite_script.h"
+#include "sqlite_statement_stats.h"
+#include "sqlite_slow_query_log.h"
+#include "sqlite_result_rows.h"
+#include "sqlite_blob_stream.h"
+#include "sqlite_row_stream.h"
+#include "sqlite_sql_literal.h"
+#include "sqlite_performance_profile.h"
+
+//######################################################################
+
+typedef void (*SqlRowFunc)(SqlRows&);
+
+/**
+ * Locking behaviour of the BEGIN statement of a transaction.
+ * 
+ * @see [BEGIN TRANSACTION](https://www.sqlite.org/lang_transaction.html)
+ */
+enum class TransactionMode
+{
+	Deferred,
+	Immediate,
+	Exclusive,
+};
+
+/**
+ * How SQLiteDB loads a database file in memory.
+ */
+enum class InMemory
+{
+	ReadWrite,  // a private copy, changes are kept until serializeTo
+	ReadOnly,   // queried straight from the mapped file, no copy
+};
+
+/**
+ * Outcome of SQLiteDB::executeMany.
+ */
+struct BatchResult
+{
+	size_t rows;       // rows written
+	int errorCode;     // SQLITE_OK or the error that stopped the batch
+	double seconds;    // wall time of the whole batch
+
+	double rowsPerSecond() const{
+		return seconds>0 ? rows/seconds : 0.0;
+	}
+};
+
+/**
+ * Progress of SQLiteDB::backupTo, reported after every step, the ones 
+ * that found the databases locked as well.
+ */
+struct BackupProgress
+{
+	int remaining;             // pages left to copy
+	int pageCount;             // pages in the source database
+	long long pagesCopied;     // pages copied so far, restarts included
+	int restarts;              // times the source changed and the copy started over
+	double seconds;            // time since the backup started
+	int busySteps;             // SQLITE_BUSY or SQLITE_LOCKED steps in a row
+
+	double pagesPerSecond() const{
+		return seconds>0 ? pagesCopied/seconds : 0.0;
+	}
+};
+
+/**
+ * Called by SQLiteDB::backupTo after every step, return false to cancel.
+ */
+typedef std::function<bool(const BackupProgress&)> BackupCallback;
+
+/**
+ * Wrapper for SQLite C++ Interface.
+ * 
+ * Simplifies quering a database using the SQLite C++ Interface. 
+ * 
+ */
+
+class SQLiteDB 
+{
+	public:
+		/**
+		 * Default number of idle prepared statements kept by the 
+		 * statement cache of each connection.
+		 */
+		static constexpr size_t STATEMENT_CACHE_SIZE=32;
+
+		/**
+		 * Default number of rows per transaction in SQLiteDB::executeMany.
+		 */
+		static constexpr size_t BATCH_CHUNK_SIZE=10000;
+
+		/**
+		 * Constructor, opens a connection to an SQLite database file 
+		 * using sqlite3_open_v2
+		 *
+	    * @param dbName Database file name.
+	    * @param openMode The flags parameter to sqlite3_open_v2 
+	    * @param zVfs The name of the sqlite3_vfs object that defines 
+	    *     the operating system interface that the new database 
+	    *     connection should use.
+	    * @throws const char* thrown if it is not possible to open 
+	    *     the connection to the database.  
+	    * 
+	    * @see [sqlite3_open_v2](https://www3.sqlite.org/c3ref/open.html)
+       */
+		SQLiteDB(const char* dbName, int openMode, const char* zVfs);
+
+       /**
+		 * Constructor, opens a connection to an SQLite database file 
+		 * using sqlite3_open_v2
+		 *
+	    * @param dbName Database file name.
+	    * @param openMode The flags parameter to sqlite3_open_v2 
+	    * @throws const char* thrown if it is not possible to open 
+	    *    the connection to the database.  
+	    * 
+	    * @see [sqlite3_open_v2](https://www3.sqlite.org/c3ref/open.html)
+       */
+		SQLiteDB(const char* dbName, int openMode=SQLITE_OPEN_READWRITE);
+		
+		 /**
+		 * Constructor, opens a connection to an SQLite database file 
+		 * using sqlite3_open16
+		 *
+	    * @param dbName Database file name.
+	    * @throws const char* thrown if it is not possible to open 
+	    *     the connection to the database.  
+	    * 
+	    * @see [sqlite3_open16](https://www3.sqlite.org/c3ref/open.html) 
+       */
+		SQLiteDB(const void* dbName);
+
+		/**
+		 * Constructor, opens a connection to an SQLite database file 
+		 * using sqlite3_open_v2 with options.flags and options.vfs, and 
+		 * applies options.profile before the connection is used.
+		 *
+		 * @throws const char* thrown if it is not possible to open 
+		 *     the connection or to apply the profile; the connection 
+		 *     is closed then.
+		 * 
+		 * @see OpenOptions, PerformanceProfile
+		 */
+		SQLiteDB(const char* dbName, const OpenOptions& options);
+
+		/**
+		 * Constructor, loads the database file filePath in memory with 
+		 * sqlite3_deserialize: the file is mapped with mmap and either 
+		 * copied (InMemory::ReadWrite) or, with InMemory::ReadOnly, 
+		 * used in place for as long as the connection lives. No page is 
+		 * read through the VFS afterwards.
+		 *
+		 * @note the file should not be written meanwhile. A WAL 
+		 *     database is refused while its -wal file is not empty: 
+		 *     checkpoint it with PRAGMA wal_checkpoint(TRUNCATE) or close 
+		 *     its last connection first. A WAL database is always copied,
+		 *     its header is switched to rollback journal mode.
+		 * @throws const char* thrown if the file cannot be loaded.
+		 * 
+		 * @see SQLiteDB::serializeTo
+		 * @see [sqlite3_deserialize](https://www.sqlite.org/c3ref/deserialize.html)
+		 */
+		SQLiteDB(const char* filePath, InMemory mode);
+
+		/**
+		 * Destructor, close the database connection.
+		 */
+		virtual ~SQLiteDB();
+
+		/**
+		 * Return the error code of the last error ocurred 
+		 * 
+		 * @see [errcode](http://www.sqlite.org/c3ref/errcode.html).
+		 */
+		int lastErrorCode();
+
+		/**
+		 * Return a description of the last error 
+		 * 
+		 * @see [errcode](http://www.sqlite.org/c3ref/errcode.html).
+		 */
+		const char* lastErrorMsg();
+		
+		/**
+		 * Returns the rowid of the most recent successful INSERT into a 
+		 * rowid table or virtual table on database connection D. Inserts 
+		 * into WITHOUT ROWID tables are not recorded. If no successful 
+		 * INSERTs into rowid tables have ever occurred on the database 
+		 * connection D, then sqlite3_last_insert_rowid(D) returns zero.
+		 * 
+		 * @see [Last Insert Rowid](https://sqlite.org/c3ref/last_insert_rowid.html)
+		 */
+		sqlite3_int64 lastInsertID();
+
+		/**
+		 * Returns true if any row was modified, inserted or deleted by the 
+		 * most recently completed INSERT, UPDATE or DELETE.
+		 * 
+		 * @see [Count The Number Of Rows Modified](https://sqlite.org/c3ref/changes.html)
+		 */
+		bool dataChanged() const;
+
+		/**
+		 * Execute a SQL query.
+		 *
+		 * @tparam UTF the type for the SQL query to execute it only accept 
+		 *       const char* for UTF8 and
+		 *       const void* for UTF16
+		 * @param query a SQL query
+		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
+		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
+		 * @return bool true if the query executes succefully.
+		 * 
+		 * @note according to the documentation, the only difference between 
+		 *      sqlite3_prepare_v2 and sqlite3_prepare_v3 is the prepFlags parameter.
+		 *      Also, currently there are just 3 valid flags (0x01, 0x02, 0x04).
+		 * 
+		 * @see [Prepare Flags](https://www3.sqlite.org/c3ref/c_prepare_normalize.html#sqlitepreparepersistent)
+		 */
+		template<typename UTF>
+		bool executeQuery(UTF query, unsigned int prepFlags=0);
+
+		/**
+		 * Execute a SQL query.
+		 *
+		 * @tparam UTF the type for the SQL query to execute it only accept 
+		 *       const char* for UTF8 and
+		 *       const void* for UTF16
+		 * @param query a SQL query
+		 * @param qParams wrapper structure for additional parameters needed
+		 *     by sqlite3_prepare_v2 and sqlite3_prepare16_v2
+		 * @return bool true if the query executes succefully.
+		 * 
+		 * @see QParams
+		 */
+		template<typename UTF>
+		bool executeQuery(UTF query, QParams qParams);
+		
+
+		//######################################################
+
+		/**
+		 * Execute a SQL query.
+		 * 
+		 * @param query a SQL query
+		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
+		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
+		 * @return a SqlRows object for the rows of the result of the query.
+		 * 
+		 * @see SqlRows
+		 */ 
+		template<typename UTF>
+		SqlRows getResultRows(UTF query, unsigned int prepFlags=0);
+
+		/**
+		 * Execute a SQL query.
+		 * 
+		 * @param query a SQL query
+		 * @param qParams wrapper for non trivial parameters of sqlite3_prepare_v2
+		 *     sqlite3_prepare_v3
+		 * @return a SqlRows object for the rows of the result of the query.
+		 * 
+		 * @see SqlRows
+		 */
+		template<typename UTF>
+		SqlRows getResultRows(UTF query, QParams qParams);
+
+		//######################################################
+		/**
+		 * Execute a SQL query and apply a callback function on 
+		 * each row of the result.
+		 * 
+		 * @param query a SQL statement to be executed.
+       * @param callback a function of type SqlRowFunc which will be 
+       *    applied to each row of the result.
+		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
+		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
+		 * 
+       * @see SqlRowFunc
+		 * 
+		 */
+		template<typename UTF> 
+		void applyToRows(UTF query, SqlRowFunc callback, unsigned int prepFlags=0);
+
+		/**
+		 * Overload of SQLiteDB::applyToRows using QParams
+		 * 
+		 */
+		template<typename UTF> 
+		void applyToRows(UTF query, SqlRowFunc callback, QParams qParams);
+
+		//######################################################
+
+		/**
+		 * Bind values to a prepared SQL statement (as in 
+		 * SQLiteDB::executeSecureQueryNf) and get its rows decoded as 
+		 * tuples, positionally.
+		 * 
+		 * @tparam Ts the type of each column in the result.
+		 * @param query a SQL query, possibly with parameters '?'
+		 * @param args one argument for each parameter '?'
+		 * @return TypedRows to be iterated with a range-for loop.
+		 * @throws const char* if the result does not have sizeof...(Ts) 
+		 *     columns.
+		 * 
+		 * Example:
+		 * for(auto [id, name, salary] : dbConnection.query<int, std::string_view, double>("select ID, Name, Salary from COMPANY where ID<?", 10)){
+		 *     ...
+		 * }
+		 */
+		template<typename... Ts, typename UTF, typename... Args>
+		TypedRows<Ts...> query(UTF query, Args&&... args);
+
+#ifdef SQLITE_DB_ROW_STREAM
+		/**
+		 * Same as SQLiteDB::query, but the rows come from a coroutine 
+		 * generator (C++20) that steps the statement lazily and composes 
+		 * with std::views. The query is prepared and bound before 
+		 * returning; no row is stepped until the stream is iterated.
+		 * 
+		 * Example:
+		 * for(auto [id, name] : dbConnection.stream<int, std::string>("select ID, Name from COMPANY where Age>?", 30) | std::views::take(10)){
+		 *     ...
+		 * }
+		 * 
+		 * @throws const char* if the result does not have sizeof...(Ts) 
+		 *     columns.
+		 * @see RowStream
+		 */
+		template<typename... Ts, typename UTF, typename... Args>
+		RowStream<Ts...> stream(UTF query, Args&&... args);
+#endif
+
+		//######################################################
+
+		/**
+		 * Bind values to prepared SQL statement and execute the prepared query.
+		 * 
+		 * @param query a SQL template query with parameters '?'
+		 * @param args variadic number of arguments, one for each unspecified 
+		 *      parameter '?' and in the same order as they will be applied.
+		 * @return SqlRows object holding the rows in the result.
+		 * 
+		 * @note some of these parameters to be binded are convenient wrapper 
+		 *    structures that encapsulate specific parameters for the appropiate
+		 *    binding routines. For example to bind a blob we can use the wrapper
+		 *    structure blob(const void* v, int n, fn cbk);
+		 * 
+		 * @see BindParams
+		 */
+		template<typename UTF, typename... Args>
+		SqlRows executeSecureQuery(unsigned int prepFlags, UTF query, Args&&... args);
+
+		/**
+		 * Overload for SQLiteDB::executeSecureQuery(unsigned int prepFlags, UTF query, Args&&... args);
+		 */
+		template<typename UTF, typename... Args>
+		SqlRows executeSecureQuery(QParams qParams, UTF query, Args&&... args);
+
+		/**
+		 * Wrapper for SQLiteDB::executeSecureQuery(0, query, args...);
+		 */
+		template<typename UTF, typename... Args>
+		SqlRows executeSecureQueryNf(UTF query, Args&&... args);
+
+#ifdef SQLITE_DB_SQL_LITERAL
+		/**
+		 * Overloads for a "..."_sql query (C++20): no strlen nor hashing
+		 * of the query on each call, and the number of args is checked
+		 * against the parameters of the query at compile time.
+		 * 
+		 * Example:
+		 * SqlRows rows=dbConnection.executeSecureQueryNf("select Name from COMPANY where ID=? and Age>?"_sql, 3, 25);
+		 * 
+		 * @see sql_literal
+		 */
+		template<sql_text S, typename... Args>
+		SqlRows executeSecureQuery(unsigned int prepFlags, sql_literal<S> query, Args&&... args);
+
+		template<sql_text S, typename... Args>
+		SqlRows executeSecureQueryNf(sql_literal<S> query, Args&&... args);
+#endif
+
+		//######################################################
+
+		/**
+		 * Execute a SQL query and get the value of the first column of 
+		 * the first row of the results.
+		 *
+		 * @param query a SQL query
+		 * @param[out] resultValue reference to a variable where the value 
+		 *     result of the query will be set
+		 * @param prepFlags if prepFlags=0 then sqlite3_prepare_v2 is used,
+		 *     if prepFlags>0, then this value is passed to sqlite3_prepare_v3
+		 * 
+		 * @return bool true if the query executes succefully and the result 
+		 *     has at least one row, false otherwise.
+		 */
+		template<typename UTF>
+		bool uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags=0);
+
+		/**
+		 * Overload for SQLiteDB::uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags=0)
+		 */
+		template<typename UTF>
+		bool uniqueAsInt(UTF query, int& resultValue, QParams qParams);
+
+		//######################################################
+		/**
+		 * Execute a SQL query and get the value of the first column of 
+		 * the first row of the results.
+		 *
+		 * @see SQLiteDB::uniqueAsInt
+		 */
+		template<typename UTF>
+		bool uniqueAsDouble(UTF query, double& resultValue, unsigned int prepFlags=0);
+
+		/**
+		 * Execute a SQL query and get the value of the first column of 
+		 * the first row of the results.
+		 *
+		 * @see SQLiteDB::uniqueAsInt
+		 */
+		template<typename UTF>
+		bool uniqueAsDouble(UTF query, double& resultValue, QParams qParams);
+
+		//######################################################
+
+		/**
+		 * Execute a SQL query and get the value of the first column of 
+		 * the first row of the results.
+		 *
+		 * @see SQLiteDB::uniqueAsInt
+		 */
+		template<typename UTF>
+		bool uniqueAsString(UTF query, std::string& resultValue, QParams qParams);
+	
+		/**
+		 * Execute a SQL query and get the value of the first column of 
+		 * the first row of the results.
+		 *
+		 * @see SQLiteDB::uniqueAsInt
+		 */
+		template<typename UTF>
+		bool uniqueAsString(UTF query, std::string& resultValue, unsigned int prepFlags=0);
+
+		//######################################################
+
+		/**
+		 * Execute the same SQL template query once for each tuple in rows.
+		 * 
+		 * The query is prepared once; for each tuple its values are bound
+		 * (as in SQLiteDB::executeSecureQuery), the statement is stepped,
+		 * reset and its bindings cleared. If no transaction is active, 
+		 * every chunkSize rows are wrapped in a transaction. The batch 
+		 * stops at the first error and the rows of the current chunk are 
+		 * rolled back.
+		 * 
+		 * @param query a SQL template query with parameters '?'
+		 * @param rows a range of std::tuple (or std::pair, std::array), one 
+		 *     element for each parameter '?'
+		 * @param chunkSize number of rows per transaction, 0 to never open 
+		 *     a transaction.
+		 * @return BatchResult with the number of rows written, the error 
+		 *     code and the time taken.
+		 * 
+		 * Example:
+		 * std::vector<std::tuple<int, std::string, double>> rows;
+		 * dbConnection.executeMany("insert into COMPANY(ID, Name, Salary) values (?,?,?)", rows);
+		 */
+		template<typename UTF, typename Range>
+		BatchResult executeMany(UTF query, const Range& rows, size_t chunkSize=BATCH_CHUNK_SIZE);
+
+		/**
+		 * Execute every statement of a SQL script (a migration, a 
+		 * maintenance script...), each one stepped to completion; rows 
+		 * returned by a statement are discarded.
+		 * 
+		 * The statements are prepared walking the tail pointer of 
+		 * sqlite3_prepare_v3, right before they run, and kept by the 
+		 * connection: running the same script again does not parse it.
+		 * 
+		 * @param script one or more SQL statements (UTF-8)
+		 * @param transaction run the script in a savepoint, released if 
+		 *     every statement succeeds and rolled back otherwise; it 
+		 *     nests in a transaction of the caller. The script should not 
+		 *     contain BEGIN, COMMIT or ROLLBACK then.
+		 * @param stopOnError stop at the first statement that fails, 
+		 *     always the case with transaction or if a statement cannot 
+		 *     be prepared (the rest of the script cannot be parsed).
+		 * @return ScriptResult with the outcome of each statement run.
+		 * 
+		 * Example:
+		 * ScriptResult result=dbConnection.executeScript("create table if not exists LOG(Msg TEXT);"
+		 *     "delete from LOG where rowid<(select max(rowid)-1000 from LOG);", true);
+		 * if(!result.ok()){
+		 *     std::cout<<result.statements.back().errorMessage<<"\n";
+		 * }
+		 */
+		ScriptResult executeScript(const char* script, bool transaction=false, bool stopOnError=true);
+
+		//######################################################
+
+		/**
+		 * Set the maximum number of idle prepared statements kept by 
+		 * the statement cache, the least recently used statements are 
+		 * finalized if needed.
+		 * 
+		 * @param capacity number of statements, 0 disables the cache.
+		 * 
+		 * @see StatementCache
+		 */
+		void setStatementCacheSize(size_t capacity);
+
+		/**
+		 * Finalize all the idle statements held by the statement cache, 
+		 * and the statements of the scripts kept by executeScript.
+		 */
+		void clearStatementCache();
+
+		/**
+		 * Hit, miss and eviction counters of the statement cache.
+		 */
+		StatementCache::Stats statementCacheStats() const;
+
+		//######################################################
+
+		/**
+		 * Start or stop collecting runtime statistics per statement 
+		 * (calls, time, rows and sqlite3_stmt_status counters), through 
+		 * sqlite3_trace_v2. While disabled no trace callback is 
+		 * registered; disabling also discards the statistics.
+		 * 
+		 * @see StatementProfiler
+		 */
+		void enableStatementStats(bool enable);
+
+		/**
+		 * Snapshot of the statistics per normalized SQL text, by total 
+		 * time descending. Empty if the statistics are not enabled.
+		 */
+		std::vector<StatementStats> statementStats() const;
+
+		/**
+		 * Clear the statistics collected so far.
+		 */
+		void resetStatementStats();
+
+		/**
+		 * Log the statements running for longer than options.threshold, 
+		 * with their query plan, to the rotating file options.path.
+		 * 
+		 * @return false if the log file cannot be opened.
+		 * @see SlowQueryLog
+		 */
+		bool enableSlowQueryLog(const SlowQueryLog::Options& options);
+
+		/**
+		 * Write the pending entries and stop logging slow queries.
+		 */
+		void disableSlowQueryLog();
+
+		/**
+		 * Write the slow queries recorded and not written yet, otherwise 
+		 * they are written the next time a statement is prepared.
+		 */
+		void flushSlowQueryLog();
+
+		//######################################################
+
+		/**
+		 * Apply the settings of profile to the connection, stopping at 
+		 * the first one that fails. The lookaside settings can only be 
+		 * changed while the connection has no statement prepared.
+		 * 
+		 * @return SQLITE_OK or the error code of the setting that failed.
+		 */
+		int applyProfile(const PerformanceProfile& profile);
+
+		/**
+		 * Read back the settings of a PerformanceProfile as they are in 
+		 * effect on the connection (all but lookaside, which cannot be 
+		 * read back).
+		 */
+		PerformanceProfile effectiveProfile();
+
+		/**
+		 * Compare the settings requested in profile with the ones in 
+		 * effect, e.g. page_size on an existing database, WAL on an 
+		 * in-memory database or mmap_size beyond SQLITE_MAX_MMAP_SIZE.
+		 * 
+		 * @return one "setting: requested x, effective y" description 
+		 *     per difference, empty if the profile is fully in effect.
+		 */
+		std::vector<std::string> verifyProfile(const PerformanceProfile& profile);
+
+		//######################################################
+
+		/**
+		 * Write the database schema ("main", "temp" or an attached one) 
+		 * to filePath with sqlite3_serialize, atomically: the file is 
+		 * replaced only once the whole image is on disk. An in-memory 
+		 * database is written without an intermediate copy.
+		 * 
+		 * @return SQLITE_OK, SQLITE_ERROR if there is no such schema, 
+		 *     SQLITE_NOMEM, SQLITE_CANTOPEN or SQLITE_IOERR.
+		 * @see [sqlite3_serialize](https://www.sqlite.org/c3ref/serialize.html)
+		 */
+		int serializeTo(const char* filePath, const char* schema="main");
+
+		//######################################################
+
+		/**
+		 * Online backup of the database to the file targetPath with 
+		 * sqlite3_backup_*: pagesPerStep pages are copied at a time and 
+		 * the source is unlocked for sleepBetweenSteps between steps, so 
+		 * writers on other connections are only held back for one step.
+		 * 
+		 * If another connection writes to the source meanwhile, SQLite 
+		 * starts the copy over on the next step (counted in 
+		 * BackupProgress::restarts); writes through this connection are 
+		 * applied to the copy instead. SQLITE_BUSY and SQLITE_LOCKED 
+		 * steps are reported to progress, which may cancel the backup, 
+		 * and retried after sleepBetweenSteps (at least 1 ms) for up to 
+		 * busyTimeout in a row.
+		 * 
+		 * To run it on a background thread, give the thread its own 
+		 * connection to the source:
+		 * std::thread backup([]{
+		 *     SQLiteDB source("live.db", SQLITE_OPEN_READONLY);
+		 *     source.backupTo("live.db.bak", 256, std::chrono::milliseconds(20), [](const BackupProgress& p){
+		 *         std::cout<<p.remaining<<" pages left, "<<p.pagesPerSecond()<<" pages/s\n";
+		 *         return true;
+		 *     });
+		 * });
+		 * 
+		 * @param targetPath file to write the backup to, replaced if it 
+		 *     exists
+		 * @param pagesPerStep pages per sqlite3_backup_step, 0 or less to 
+		 *     copy everything in a single step
+		 * @param sleepBetweenSteps pause between steps
+		 * @param progress called after every step, nullptr for none
+		 * @param schema the source database, "main" or an attached one
+		 * @param busyTimeout how long the databases may stay locked 
+		 *     before the backup gives up
+		 * @return SQLITE_OK, SQLITE_ABORT if progress cancelled the 
+		 *     backup, SQLITE_BUSY or SQLITE_LOCKED after busyTimeout, or 
+		 *     the error code.
+		 * @see [Online Backup API](https://www.sqlite.org/c3ref/backup_finish.html)
+		 */
+		int backupTo(const char* targetPath, int pagesPerStep=100, std::chrono::milliseconds sleepBetweenSteps=std::chrono::milliseconds(10), const BackupCallback& progress=nullptr, const char* schema="main", std::chrono::milliseconds busyTimeout=std::chrono::seconds(5));
+
+		/**
+		 * Same as SQLiteDB::backupTo(const char* targetPath, ...) into 
+		 * the "main" database of target, which must not be in use.
+		 */
+		int backupTo(SQLiteDB& target, int pagesPerStep=100, std::chrono::milliseconds sleepBetweenSteps=std::chrono::milliseconds(10), const BackupCallback& progress=nullptr, const char* schema="main", std::chrono::milliseconds busyTimeout=std::chrono::seconds(5));
+
+		//######################################################
+
+		/**
+		 * Register a C++ callable as the scalar SQL function name. The 
+		 * number and types of the arguments are deduced from the 
+		 * signature of function and converted from sqlite3_value* with 
+		 * ValueData; the result is set with ResultDataTrait. An 
+		 * exception thrown by function becomes the error of the query.
+		 * 
+		 * Example:
+		 * dbConnection.registerFunction("band", [](int age){ return age/10*10; }, true);
+		 * dbConnection.executeQuery("create index AgeBand on COMPANY(band(Age))");
+		 * 
+		 * @param name the name of the SQL function, overloaded by the 
+		 *     number of arguments
+		 * @param function function, function pointer or lambda (without 
+		 *     auto parameters), copied or moved into a heap object owned 
+		 *     by the connection
+		 * @param deterministic same result for the same arguments: 
+		 *     SQLITE_DETERMINISTIC, needed to use the function in an index
+		 * @param innocuous no side effects and nothing read but the 
+		 *     arguments: SQLITE_INNOCUOUS, needed to use the function in 
+		 *     the schema with trusted_schema=OFF
+		 * @return the result of sqlite3_create_function_v2
+		 */
+		template<typename F>
+		int registerFunction(const char* name, F&& function, bool deterministic=false, bool innocuous=false);
+
+		/**
+		 * Register an aggregate SQL function name: step(State&, args...) 
+		 * is called for every row of a group and finalize(State&) returns 
+		 * the result of the group. Each group gets its own State in the 
+		 * memory of sqlite3_aggregate_context.
+		 * 
+		 * Example:
+		 * struct Mean{ double sum; int n; };
+		 * dbConnection.registerAggregate<Mean>("mean", 
+		 *     [](Mean& m, double value){ m.sum+=value; m.n++; },
+		 *     [](Mean& m){ return m.n ? std::optional<double>(m.sum/m.n) : std::nullopt; });
+		 * 
+		 * @see SQLiteDB::registerFunction, AggregateFunction
+		 */
+		template<typename State, typename Step, typename Final>
+		int registerAggregate(const char* name, Step&& step, Final&& finalize, bool deterministic=false, bool innocuous=false);
+
+		/**
+		 * Expose a contiguous container (std::vector, std::array...) as 
+		 * the read-only table name of every schema of the connection, 
+		 * without CREATE VIRTUAL TABLE and without copying any row. 
+		 * Elements of a sortedKeyColumn must be sorted by it: =, IN and 
+		 * range constraints on it are resolved by binary search.
+		 * 
+		 * Example:
+		 * struct Employee{ int id; std::string name; double salary; };
+		 * std::vector<Employee> employees=...;  // sorted by id
+		 * dbConnection.registerContainer("employees", employees, 
+		 *     sortedKeyColumn("id", &Employee::id), 
+		 *     tableColumn("name", &Employee::name), 
+		 *     tableColumn("salary", &Employee::salary));
+		 * dbConnection.query<std::string, double>("select name, salary from employees where id between ? and ?", 10, 20);
+		 * 
+		 * @param container read in place by the queries: it must outlive 
+		 *     the registration and not change while a statement reading 
+		 *     it is running
+		 * @param columns tableColumn, sortedKeyColumn or elementColumn
+		 * @return the result of sqlite3_create_module_v2; registering 
+		 *     name again replaces the table
+		 * 
+		 * @see ContainerTable
+		 */
+		template<typename Container, typename... Columns>
+		int registerContainer(const char* name, const Container& container, Columns... columns);
+
+		/**
+		 * Withdraw the table name registered by registerContainer, after 
+		 * which its container can be destroyed. The idle statements of 
+		 * the statement cache are finalized, as some may read the table; 
+		 * no SqlRows reading it may be alive.
+		 * 
+		 * @return the result of sqlite3_create_module_v2
+		 */
+		int unregisterContainer(const char* name);
+
+		//######################################################
+
+		/**
+		 * Start a transaction. The BEGIN, COMMIT and ROLLBACK statements 
+		 * are prepared once per connection and reused.
+		 * 
+		 * @param mode DEFERRED, IMMEDIATE or EXCLUSIVE
+		 * @return SQLITE_OK or the error code.
+		 * 
+		 * @see Transaction for a scope guard
+		 */
+		int beginTransaction(TransactionMode mode=TransactionMode::Deferred);
+
+		/**
+		 * Commit the current transaction.
+		 * 
+		 * @return SQLITE_OK or the error code.
+		 */
+		int commitTransaction();
+
+		/**
+		 * Roll back the current transaction.
+		 * 
+		 * @return SQLITE_OK or the error code.
+		 */
+		int rollbackTransaction();
+
+		/**
+		 * Returns true if a transaction is active (the connection is not 
+		 * in autocommit mode).
+		 * 
+		 * @see [Autocommit Mode](https://www.sqlite.org/c3ref/get_autocommit.html)
+		 */
+		bool inTransaction() const;
+
+		//######################################################
+
+		/**
+		 * Open a BLOB for incremental I/O, wrapper for sqlite3_blob_open.
+		 * 
+		 * @param table name of the table (it must be a rowid table)
+		 * @param column name of the column
+		 * @param rowid rowid of the row
+		 * @param writable true to open the BLOB for read and write
+		 * @param dbName symbolic name of the database ("main", "temp" or 
+		 *     the name of an attached database)
+		 * @return BlobStream, check BlobStream::isOpen()
+		 * 
+		 * @see BlobStream
+		 */
+		BlobStream openBlob(const char* table, const char* column, sqlite3_int64 rowid, bool writable=false, const char* dbName="main");
+
+		/**
+		 * Store the content of a file into a BLOB column without loading 
+		 * the file in memory: the space is reserved binding a zeroblob64 
+		 * and the file is then written chunkSize bytes at a time, all in 
+		 * one savepoint.
+		 * 
+		 * @param table name of the table (it must be a rowid table)
+		 * @param column name of the column
+		 * @param rowid rowid of the row to update
+		 * @param filePath file to store
+		 * @param chunkSize bytes written at a time
+		 * @return SQLITE_OK, SQLITE_CANTOPEN if the file cannot be read, 
+		 *     SQLITE_NOTFOUND if there is no such row or the error code.
+		 */
+		int importBlob(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath, int chunkSize=BlobStream::CHUNK_SIZE);
+
+		/**
+		 * Write a BLOB column to a file, chunkSize bytes at a time.
+		 * 
+		 * @return SQLITE_OK, SQLITE_CANTOPEN if the file cannot be created,
+		 *     SQLITE_IOERR if writing fails or the error code.
+		 */
+		int exportBlob(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath, int chunkSize=BlobStream::CHUNK_SIZE);
+
+		/**
+		 * Store the content of a file into a BLOB column binding it 
+		 * straight from a read-only memory mapping of the file 
+		 * (SQLITE_STATIC), with no copy in user space.
+		 * 
+		 * @return SQLITE_OK, SQLITE_CANTOPEN if the file cannot be mapped,
+		 *     SQLITE_NOTFOUND if there is no such row or the error code.
+		 * 
+		 * @see MappedFile
+		 */
+		int importBlobMapped(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath);
+
+		/**
+		 * Write a BLOB column to a file: the file is created with the size 
+		 * of the BLOB, mapped in memory and filled with a single 
+		 * sqlite3_blob_read.
+		 * 
+		 * @return SQLITE_OK, SQLITE_CANTOPEN if the file cannot be created 
+		 *     and mapped, or the error code.
+		 */
+		int exportBlobMapped(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath);
+
+
+	protected:
+		sqlite3* m_DB;
+		/*The number of columns in the result set. As far as the 
+		 * query return at least a row, m_numColmns will be the 
+		 * number of columns in that row.
+		*/
+		int m_numColumns;
+		std::shared_ptr<StatementCache> m_stmtCache;
+		// created by the first executeScript
+		std::unique_ptr<ScriptCache> m_scripts;
+
+		enum TxStatement
+		{
+			TX_BEGIN_DEFERRED,
+			TX_BEGIN_IMMEDIATE,
+			TX_BEGIN_EXCLUSIVE,
+			TX_COMMIT,
+			TX_ROLLBACK,
+			TX_STATEMENTS
+		};
+		sqlite3_stmt* m_txStatements[TX_STATEMENTS];
+		int m_savepointDepth;
+		std::unique_ptr<StatementProfiler> m_profiler;
+		std::unique_ptr<SlowQueryLog> m_slowLog;
+		// file mapping an InMemory::ReadOnly database is deserialized from
+		std::unique_ptr<MappedFile> m_image;
+
+		int runTxStatement(TxStatement which);
+
+		static int traceCallback(unsigned int type, void* context, void* p, void* x);
+
+		void updateTrace();
+
+		/**
+		 * @return SQLITE_OK, SQLITE_BUSY if filePath is in WAL mode and 
+		 *     its -wal file is not empty, or the error of 
+		 *     sqlite3_deserialize.
+		 */
+		int deserializeFile(const char* filePath, InMemory mode);
+
+		int backupInto(sqlite3* target, int pagesPerStep, std::chrono::milliseconds sleepBetweenSteps, const BackupCallback& progress, const char* schema, std::chrono::milliseconds busyTimeout);
+
+		template<typename UTF, typename P>
+		int prepareStatement(UTF query, sqlite3_stmt** statement, P& qParams, StatementCache::Entry*& cacheEntry);
+
+		void releaseStatement(sqlite3_stmt* statement, StatementCache::Entry* cacheEntry);
+
+		int stepStatement(sqlite3_stmt*& statement, StatementCache::Entry* cacheEntry);
+
+		int runStatement(UTF8 query);
+
+		template<typename UTF, typename T, typename P=unsigned int>
+		bool getUnique(UTF query, T& resultValue, P qParams=0);
+
+		template<typename UTF, typename P=unsigned int>
+		SqlRows getResultRowsInner(UTF query, P qParams=0);
+
+		template<typename UTF, typename P=unsigned int> 
+		void applyToRowsInner(UTF query, SqlRowFunc callback, P qParams=0);
+
+		template<typename UTF, typename P>
+		bool executeQueryInner(UTF query, P qParams);
+
+	friend class Savepoint;
+	friend class SQLiteDBPool;
+};
+
+//======================================================================
+//======================================================================
+
+SQLiteDB::SQLiteDB(const char* dbName, int openMode, const char* zVfs)
+:m_DB(nullptr),
+m_txStatements(),
+m_savepointDepth(0)
+{
+	if(sqlite3_open_v2(dbName, &m_DB, openMode, zVfs)>0){
+		throw sqlite3_errmsg(m_DB);
+	}
+	m_stmtCache=std::make_shared<StatementCache>(m_DB, STATEMENT_CACHE_SIZE);
+}
+
+//======================================================================
+
+SQLiteDB::SQLiteDB(const char* dbName, int openMode)
+:SQLiteDB(dbName, openMode, NULL)
+{}
+
+//======================================================================
+SQLiteDB::SQLiteDB(const void* dbName)
+:m_DB(nullptr),
+m_txStatements(),
+m_savepointDepth(0)
+{
+	if(sqlite3_open16(dbName, &m_DB)>0){
+		throw sqlite3_errmsg(m_DB);
+	}
+	m_stmtCache=std::make_shared<StatementCache>(m_DB, STATEMENT_CACHE_SIZE);
+}
+//======================================================================
+
+inline SQLiteDB::SQLiteDB(const char* dbName, const OpenOptions& options)
+:SQLiteDB(dbName, options.flags, options.vfs)
+{
+	if(applyProfile(options.profile)!=SQLITE_OK){
+		// the object is constructed already, ~SQLiteDB closes the connection
+		throw "Performance profile could not be applied.";
+	}
+}
+
+//======================================================================
+
+inline SQLiteDB::SQLiteDB(const char* filePath, InMemory mode)
+:SQLiteDB(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE)
+{
+	int rc=deserializeFile(filePath, mode);
+	if(rc==SQLITE_BUSY){
+		throw "The -wal file of the database is not empty, checkpoint the database first.";
+	}
+	if(rc!=SQLITE_OK){
+		throw "The database file could not be loaded in memory.";
+	}
+}
+
+//======================================================================
+inline SQLiteDB::~SQLiteDB(){
+	flushSlowQueryLog();
+	sqlite3_trace_v2(m_DB, 0, nullptr, nullptr);
+	for(sqlite3_stmt* statement : m_txStatements){
+		sqlite3_finalize(statement);
+	}
+	m_scripts.reset();
+	m_stmtCache.reset();
+	sqlite3_close(m_DB);
+}	
+//======================================================================
+inline int SQLiteDB::lastErrorCode()
+{
+	return sqlite3_errcode(m_DB);
+}
+//======================================================================
+inline const char* SQLiteDB::lastErrorMsg()
+{
+	return sqlite3_errmsg(m_DB);
+}
+
+//======================================================================
+
+inline sqlite3_int64 SQLiteDB::lastInsertID()
+{
+	return sqlite3_last_insert_rowid(m_DB);
+}
+
+//======================================================================
+
+inline bool SQLiteDB::dataChanged() const
+{
+	return (sqlite3_changes(m_DB) != 0);
+}
+
+//======================================================================
+
+inline void SQLiteDB::setStatementCacheSize(size_t capacity)
+{
+	m_stmtCache->setCapacity(capacity);
+}
+
+//======================================================================
+
+inline void SQLiteDB::clearStatementCache()
+{
+	m_stmtCache->clear();
+	if(m_scripts){
+		m_scripts->clear();
+	}
+}
+
+//======================================================================
+
+inline StatementCache::Stats SQLiteDB::statementCacheStats() const
+{
+	return m_stmtCache->stats();
+}
+
+//======================================================================
+
+inline void SQLiteDB::enableStatementStats(bool enable)
+{
+	if(enable && !m_profiler){
+		m_profiler.reset(new StatementProfiler());
+	}
+	else if(!enable){
+		m_profiler.reset();
+	}
+	updateTrace();
+}
+
+//======================================================================
+
+inline std::vector<StatementStats> SQLiteDB::statementStats() const
+{
+	return m_profiler ? m_profiler->report() : std::vector<StatementStats>();
+}
+
+//======================================================================
+
+inline void SQLiteDB::resetStatementStats()
+{
+	if(m_profiler){
+		m_profiler->reset();
+	}
+}
+
+//======================================================================
+
+inline bool SQLiteDB::enableSlowQueryLog(const SlowQueryLog::Options& options)
+{
+	flushSlowQueryLog();
+	m_slowLog.reset(new SlowQueryLog(options));
+	if(!m_slowLog->isOpen()){
+		m_slowLog.reset();
+	}
+	updateTrace();
+	return m_slowLog!=nullptr;
+}
+
+//======================================================================
+
+inline void SQLiteDB::disableSlowQueryLog()
+{
+	flushSlowQueryLog();
+	m_slowLog.reset();
+	updateTrace();
+}
+
+//======================================================================
+
+inline void SQLiteDB::flushSlowQueryLog()
+{
+	if(m_slowLog){
+		m_slowLog->flush(m_DB);
+	}
+}
+
+//======================================================================
+
+inline int SQLiteDB::applyProfile(const PerformanceProfile& profile)
+{
+	int rc=SQLITE_OK;
+	if(profile.lookaside){
+		rc=sqlite3_db_config(m_DB, SQLITE_DBCONFIG_LOOKASIDE, nullptr, profile.lookaside->slotSize, profile.lookaside->slots);
+	}
+	if(rc==SQLITE_OK && profile.busyTimeout){
+		rc=sqlite3_busy_timeout(m_DB, *profile.busyTimeout);
+	}
+	std::string pragmas=profile.pragmas();
+	if(rc==SQLITE_OK && !pragmas.empty()){
+		rc=sqlite3_exec(m_DB, pragmas.c_str(), nullptr, nullptr, nullptr);
+	}
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::deserializeFile(const char* filePath, InMemory mode)
+{
+	std::unique_ptr<MappedFile> file(new MappedFile(filePath));
+	if(!file->isOpen()){
+		return SQLITE_CANTOPEN;
+	}
+	const unsigned char* data=static_cast<const unsigned char*>(file->data());
+	sqlite3_int64 size=static_cast<sqlite3_int64>(file->size());
+
+	// the in-memory VFS cannot open a database whose header says WAL 
+	// (file format versions, bytes 18 and 19, set to 2)
+	const bool wal=size>=20 && (data[18]==2 || data[19]==2);
+	if(wal){
+		// sqlite3_deserialize takes the image of the database file alone 
+		// and the in-memory VFS has no WAL: the commits still in the -wal 
+		// file would be lost without notice, so refuse to load them
+		std::ifstream walFile(std::string(filePath)+"-wal", std::ios::binary|std::ios::ate);
+		if(walFile && walFile.tellg()>0){
+			return SQLITE_BUSY;
+		}
+	}
+	if(mode==InMemory::ReadOnly && !wal){
+		int rc=sqlite3_deserialize(m_DB, "main", const_cast<unsigned char*>(data), size, size, SQLITE_DESERIALIZE_READONLY);
+		if(rc==SQLITE_OK){
+			m_image=std::move(file);
+		}
+		return rc;
+	}
+
+	unsigned char* image=static_cast<unsigned char*>(sqlite3_malloc64(size>0 ? size : 1));
+	if(!image){
+		return SQLITE_NOMEM;
+	}
+	std::memcpy(image, data, static_cast<size_t>(size));
+	if(wal){
+		image[18]=1;
+		image[19]=1;
+	}
+	unsigned int flags=SQLITE_DESERIALIZE_FREEONCLOSE|(mode==InMemory::ReadOnly ? SQLITE_DESERIALIZE_READONLY : SQLITE_DESERIALIZE_RESIZEABLE);
+	// image is freed by SQLite, even if sqlite3_deserialize fails
+	return sqlite3_deserialize(m_DB, "main", image, size, size, flags);
+}
+
+//======================================================================
+
+inline int SQLiteDB::serializeTo(const char* filePath, const char* schema)
+{
+	sqlite3_int64 size=0;
+	const unsigned char* data=sqlite3_serialize(m_DB, schema, &size, SQLITE_SERIALIZE_NOCOPY);
+	if(data){
+		return replaceFile(filePath, data, static_cast<size_t>(size));
+	}
+
+	// not held in contiguous memory, e.g. a database file
+	unsigned char* copy=sqlite3_serialize(m_DB, schema, &size, 0);
+	if(!copy){
+		if(size<0){
+			// no such schema
+			return SQLITE_ERROR;
+		}
+		return size==0 ? replaceFile(filePath, nullptr, 0) : SQLITE_NOMEM;
+	}
+	int rc=replaceFile(filePath, copy, static_cast<size_t>(size));
+	sqlite3_free(copy);
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::backupTo(const char* targetPath, int pagesPerStep, std::chrono::milliseconds sleepBetweenSteps, const BackupCallback& progress, const char* schema, std::chrono::milliseconds busyTimeout)
+{
+	sqlite3* target=nullptr;
+	int rc=sqlite3_open_v2(targetPath, &target, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, nullptr);
+	if(rc==SQLITE_OK){
+		rc=backupInto(target, pagesPerStep, sleepBetweenSteps, progress, schema, busyTimeout);
+	}
+	sqlite3_close(target);
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::backupTo(SQLiteDB& target, int pagesPerStep, std::chrono::milliseconds sleepBetweenSteps, const BackupCallback& progress, const char* schema, std::chrono::milliseconds busyTimeout)
+{
+	return backupInto(target.m_DB, pagesPerStep, sleepBetweenSteps, progress, schema, busyTimeout);
+}
+
+//======================================================================
+
+inline int SQLiteDB::backupInto(sqlite3* target, int pagesPerStep, std::chrono::milliseconds sleepBetweenSteps, const BackupCallback& progress, const char* schema, std::chrono::milliseconds busyTimeout)
+{
+	sqlite3_backup* backup=sqlite3_backup_init(target, "main", m_DB, schema);
+	if(!backup){
+		return sqlite3_errcode(target);
+	}
+
+	// changes when another connection writes to the source, which is 
+	// when sqlite3_backup_step starts over
+	std::string dataVersionQuery="PRAGMA "+quoteIdentifier(schema)+".data_version";
+	int dataVersion=0;
+	getUnique<UTF8, int>(dataVersionQuery.c_str(), dataVersion);
+
+	std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point busySince=start;
+	BackupProgress state{0, 0, 0, 0, 0.0, 0};
+	bool first=true;
+	int rc;
+	do{
+		rc=sqlite3_backup_step(backup, pagesPerStep>0 ? pagesPerStep : -1);
+		if(rc==SQLITE_BUSY || rc==SQLITE_LOCKED){
+			std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+			if(state.busySteps==0){
+				busySince=now;
+			}
+			state.busySteps++;
+			state.seconds=std::chrono::duration<double>(now-start).count();
+			if(progress && !progress(state)){
+				sqlite3_backup_finish(backup);
+				return SQLITE_ABORT;
+			}
+			if(now-busySince>=busyTimeout){
+				break;
+			}
+			// no busy loop with sleepBetweenSteps=0
+			sqlite3_sleep(std::max(1, static_cast<int>(sleepBetweenSteps.count())));
+			continue;
+		}
+		if(rc!=SQLITE_OK && rc!=SQLITE_DONE){
+			break;
+		}
+		state.busySteps=0;
+
+		int version=dataVersion;
+		getUnique<UTF8, int>(dataVersionQuery.c_str(), version);
+		int remaining=sqlite3_backup_remaining(backup);
+		state.pageCount=sqlite3_backup_pagecount(backup);
+		if(first || version!=dataVersion){
+			// the step copied from the first page
+			state.restarts+=first ? 0 : 1;
+			state.pagesCopied+=state.pageCount-remaining;
+			dataVersion=version;
+			first=false;
+		}
+		else{
+			state.pagesCopied+=state.remaining-remaining;
+		}
+		state.remaining=remaining;
+		state.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+		if(progress && !progress(state)){
+			sqlite3_backup_finish(backup);
+			return SQLITE_ABORT;
+		}
+		if(rc==SQLITE_OK){
+			sqlite3_sleep(static_cast<int>(sleepBetweenSteps.count()));
+		}
+	}while(rc!=SQLITE_DONE);
+
+	int finishRc=sqlite3_backup_finish(backup);
+	return rc==SQLITE_DONE ? finishRc : rc;
+}
+
+//======================================================================
+
+template<typename F>
+int SQLiteDB::registerFunction(const char* name, F&& function, bool deterministic, bool innocuous)
+{
+	typedef ScalarFunction<std::decay_t<F>> Function;
+	// deleted by SQLite, also if the registration fails
+	Function* scalar=new Function(std::forward<F>(function));
+	return sqlite3_create_function_v2(m_DB, name, Function::ARGUMENTS, sqlFunctionFlags(deterministic, innocuous), scalar, &Function::call, nullptr, nullptr, &Function::destroy);
+}
+
+//======================================================================
+
+template<typename State, typename Step, typename Final>
+int SQLiteDB::registerAggregate(const char* name, Step&& step, Final&& finalize, bool deterministic, bool innocuous)
+{
+	typedef AggregateFunction<State, std::decay_t<Step>, std::decay_t<Final>> Function;
+	Function* aggregate=new Function(std::forward<Step>(step), std::forward<Final>(finalize));
+	return sqlite3_create_function_v2(m_DB, name, Function::ARGUMENTS, sqlFunctionFlags(deterministic, innocuous), aggregate, nullptr, &Function::step, &Function::finalize, &Function::destroy);
+}
+
+//======================================================================
+
+template<typename Container, typename... Columns>
+int SQLiteDB::registerContainer(const char* name, const Container& container, Columns... columns)
+{
+	static_assert(sizeof...(Columns)>0, "a table needs at least one column");
+	typedef ContainerTable<Container, Columns...> Table;
+	// deleted by SQLite with the module, also if the registration fails
+	typename Table::Source* source=new typename Table::Source{&container, std::make_tuple(columns...)};
+	return sqlite3_create_module_v2(m_DB, name, Table::module(), source, &Table::destroySource);
+}
+
+//======================================================================
+
+inline int SQLiteDB::unregisterContainer(const char* name)
+{
+	clearStatementCache();
+	return sqlite3_create_module_v2(m_DB, name, nullptr, nullptr, nullptr);
+}
+
+//======================================================================
+
+inline PerformanceProfile SQLiteDB::effectiveProfile()
+{
+	PerformanceProfile effective;
+	std::string mode;
+	JournalMode journalMode;
+	if(getUnique<UTF8, std::string>("PRAGMA journal_mode", mode) && PerformanceProfile::journalModeFromName(mode.c_str(), journalMode)){
+		effective.journalMode=journalMode;
+	}
+	int value;
+	if(getUnique<UTF8, int>("PRAGMA synchronous", value)){
+		effective.synchronous=static_cast<Synchronous>(value);
+	}
+	if(getUnique<UTF8, int>("PRAGMA cache_size", value)){
+		effective.cacheSize=value;
+	}
+	sqlite3_int64 mmapSize;
+	if(getUnique<UTF8, sqlite3_int64>("PRAGMA mmap_size", mmapSize)){
+		effective.mmapSize=mmapSize;
+	}
+	if(getUnique<UTF8, int>("PRAGMA temp_store", value)){
+		effective.tempStore=static_cast<TempStore>(value);
+	}
+	if(getUnique<UTF8, int>("PRAGMA busy_timeout", value)){
+		effective.busyTimeout=value;
+	}
+	if(getUnique<UTF8, int>("PRAGMA page_size", value)){
+		effective.pageSize=value;
+	}
+	return effective;
+}
+
+//======================================================================
+
+inline std::vector<std::string> SQLiteDB::verifyProfile(const PerformanceProfile& profile)
+{
+	PerformanceProfile effective=effectiveProfile();
+	std::vector<std::string> differences;
+	auto check=[&differences](const char* setting, const auto& requested, const auto& current, auto toString){
+		if(requested && (!current || *requested!=*current)){
+			differences.push_back(std::string(setting)+": requested "+toString(*requested)+", effective "+(current ? toString(*current) : std::string("unknown")));
+		}
+	};
+	auto number=[](auto value){
+		return std::to_string(static_cast<sqlite3_int64>(value));
+	};
+	check("journal_mode", profile.journalMode, effective.journalMode, [](JournalMode mode){
+		return std::string(PerformanceProfile::journalModeName(mode));
+	});
+	check("synchronous", profile.synchronous, effective.synchronous, number);
+	check("cache_size", profile.cacheSize, effective.cacheSize, number);
+	check("mmap_size", profile.mmapSize, effective.mmapSize, number);
+	check("temp_store", profile.tempStore, effective.tempStore, number);
+	check("busy_timeout", profile.busyTimeout, effective.busyTimeout, number);
+	check("page_size", profile.pageSize, effective.pageSize, number);
+	return differences;
+}
+
+//======================================================================
+
+inline void SQLiteDB::updateTrace()
+{
+	unsigned int mask=0;
+	if(m_profiler){
+		mask|=SQLITE_TRACE_STMT|SQLITE_TRACE_ROW|SQLITE_TRACE_PROFILE;
+	}
+	if(m_slowLog){
+		mask|=SQLITE_TRACE_PROFILE;
+	}
+	sqlite3_trace_v2(m_DB, mask, mask ? &SQLiteDB::traceCallback : nullptr, this);
+}
+
+//======================================================================
+
+inline int SQLiteDB::traceCallback(unsigned int type, void* context, void* p, void* x)
+{
+	SQLiteDB* db=static_cast<SQLiteDB*>(context);
+	sqlite3_stmt* statement=static_cast<sqlite3_stmt*>(p);
+	if(db->m_slowLog && db->m_slowLog->isFlushing()){
+		// query plans of the slow query log
+		return 0;
+	}
+	// before the profiler, which resets the counters
+	if(db->m_slowLog && type==SQLITE_TRACE_PROFILE){
+		db->m_slowLog->onProfile(statement, *static_cast<sqlite3_uint64*>(x));
+	}
+	if(db->m_profiler){
+		if(type==SQLITE_TRACE_ROW){
+			db->m_profiler->onRow(statement);
+		}
+		else if(type==SQLITE_TRACE_STMT){
+			db->m_profiler->onStart(statement);
+		}
+		else if(type==SQLITE_TRACE_PROFILE){
+			db->m_profiler->onProfile(statement, *static_cast<sqlite3_uint64*>(x));
+		}
+	}
+	return 0;
+}
+
+//======================================================================
+
+template<typename UTF, typename P>
+inline int SQLiteDB::prepareStatement(UTF query, sqlite3_stmt** statement, P& qParams, StatementCache::Entry*& cacheEntry){
+	if(m_slowLog && m_slowLog->hasPending()){
+		m_slowLog->flush(m_DB);
+	}
+	*statement=nullptr;
+	return m_stmtCache->acquire(query, statement, qParams, cacheEntry);
+}
+
+//======================================================================
+
+inline void SQLiteDB::releaseStatement(sqlite3_stmt* statement, StatementCache::Entry* cacheEntry){
+	m_stmtCache->release(statement, cacheEntry);
+}
+
+//======================================================================
+
+inline int SQLiteDB::stepStatement(sqlite3_stmt*& statement, StatementCache::Entry* cacheEntry){
+	int rc=sqlite3_step(statement);
+	if(rc==SQLITE_SCHEMA && cacheEntry && m_stmtCache->reprepare(cacheEntry)==SQLITE_OK){
+		statement=cacheEntry->statement;
+		rc=sqlite3_step(statement);
+	}
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::runTxStatement(TxStatement which){
+	static const char* const sql[TX_STATEMENTS]={
+		"BEGIN DEFERRED",
+		"BEGIN IMMEDIATE",
+		"BEGIN EXCLUSIVE",
+		"COMMIT",
+		"ROLLBACK"
+	};
+
+	sqlite3_stmt*& statement=m_txStatements[which];
+	if(!statement){
+		int rc=sqlite3_prepare_v3(m_DB, sql[which], -1, SQLITE_PREPARE_PERSISTENT, &statement, nullptr);
+		if(rc!=SQLITE_OK){
+			return rc;
+		}
+	}
+	int rc=sqlite3_step(statement);
+	sqlite3_reset(statement);
+
+	return rc==SQLITE_DONE ? SQLITE_OK : rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::beginTransaction(TransactionMode mode)
+{
+	switch(mode){
+		case TransactionMode::Immediate:
+			return runTxStatement(TX_BEGIN_IMMEDIATE);
+		case TransactionMode::Exclusive:
+			return runTxStatement(TX_BEGIN_EXCLUSIVE);
+		default:
+			return runTxStatement(TX_BEGIN_DEFERRED);
+	}
+}
+
+//======================================================================
+
+inline int SQLiteDB::commitTransaction()
+{
+	return runTxStatement(TX_COMMIT);
+}
+
+//======================================================================
+
+inline int SQLiteDB::rollbackTransaction()
+{
+	return runTxStatement(TX_ROLLBACK);
+}
+
+//======================================================================
+
+inline bool SQLiteDB::inTransaction() const
+{
+	return sqlite3_get_autocommit(m_DB)==0;
+}
+
+//======================================================================
+
+inline BlobStream SQLiteDB::openBlob(const char* table, const char* column, sqlite3_int64 rowid, bool writable, const char* dbName)
+{
+	sqlite3_blob* blob=nullptr;
+	int rc=sqlite3_blob_open(m_DB, dbName, table, column, rowid, writable ? 1 : 0, &blob);
+	if(rc!=SQLITE_OK){
+		sqlite3_blob_close(blob);
+		blob=nullptr;
+	}
+	return BlobStream(blob, rc);
+}
+
+//======================================================================
+
+inline int SQLiteDB::importBlob(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath, int chunkSize)
+{
+	std::ifstream infile(filePath, std::ios::in|std::ios::binary|std::ios::ate);
+	if(!infile.is_open()){
+		return SQLITE_CANTOPEN;
+	}
+	sqlite3_uint64 size=static_cast<sqlite3_uint64>(infile.tellg());
+	infile.seekg(0, std::ios::beg);
+
+	int rc=runStatement("SAVEPOINT sqlite_db_import_blob");
+	if(rc!=SQLITE_OK){
+		return rc;
+	}
+
+	std::string query("update "+quoteIdentifier(table)+" set "+quoteIdentifier(column)+"=? where rowid=?");
+	executeSecureQueryNf(query.c_str(), zeroblob64(size), rowid);
+	rc=lastErrorCode();
+	if(rc==SQLITE_OK && !dataChanged()){
+		rc=SQLITE_NOTFOUND;
+	}
+	if(rc==SQLITE_OK){
+		BlobStream blob=openBlob(table, column, rowid, true);
+		rc=blob.isOpen() ? blob.copyFrom(infile, chunkSize) : blob.errorCode();
+	}
+
+	if(rc!=SQLITE_OK){
+		runStatement("ROLLBACK TO sqlite_db_import_blob");
+	}
+	runStatement("RELEASE sqlite_db_import_blob");
+
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::exportBlob(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath, int chunkSize)
+{
+	BlobStream blob=openBlob(table, column, rowid);
+	if(!blob.isOpen()){
+		return blob.errorCode();
+	}
+	std::ofstream outfile(filePath, std::ios::out|std::ios::binary|std::ios::trunc);
+	if(!outfile.is_open()){
+		return SQLITE_CANTOPEN;
+	}
+	return blob.copyTo(outfile, chunkSize);
+}
+
+//======================================================================
+
+inline int SQLiteDB::importBlobMapped(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath)
+{
+	MappedFile file(filePath);
+	if(!file.isOpen()){
+		return SQLITE_CANTOPEN;
+	}
+
+	std::string query("update "+quoteIdentifier(table)+" set "+quoteIdentifier(column)+"=? where rowid=?");
+	executeSecureQueryNf(query.c_str(), file.asBlob(), rowid);
+	int rc=lastErrorCode();
+	if(rc==SQLITE_OK && !dataChanged()){
+		rc=SQLITE_NOTFOUND;
+	}
+	return rc;
+}
+
+//======================================================================
+
+inline int SQLiteDB::exportBlobMapped(const char* table, const char* column, sqlite3_int64 rowid, const char* filePath)
+{
+	BlobStream blob=openBlob(table, column, rowid);
+	if(!blob.isOpen()){
+		return blob.errorCode();
+	}
+	int size=blob.size();
+	MappedFile file(filePath, static_cast<size_t>(size));
+	if(!file.isOpen()){
+		return SQLITE_CANTOPEN;
+	}
+	if(size==0){
+		return SQLITE_OK;
+	}
+	return blob.read(file.data(), size, 0);
+}
+
+//======================================================================
+
+/*
+ * Prepare (from the cache) and step a statement without results,
+ * return SQLITE_OK if it runs to completion or the error code.
+ */
+inline int SQLiteDB::runStatement(UTF8 query){
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	unsigned int prepFlags=0;
+	int rc=prepareStatement(query, &statement, prepFlags, cacheEntry);
+	if(rc==SQLITE_OK){
+		rc=stepStatement(statement, cacheEntry);
+		if(rc==SQLITE_DONE || rc==SQLITE_ROW){
+			rc=SQLITE_OK;
+		}
+	}
+	releaseStatement(statement, cacheEntry);
+	return rc;
+}
+
+//======================================================================
+
+
+template<typename UTF, typename T, typename P>
+bool SQLiteDB::getUnique(UTF query, T& resultValue, P qParams){
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
+
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	if(prepareStatement(query, &statement, qParams, cacheEntry) == SQLITE_OK){
+		m_numColumns = sqlite3_column_count(statement);
+		if (m_numColumns){
+			if (SQLITE_ROW == stepStatement(statement, cacheEntry)){
+				resultValue=ColumnData<T>::getColumnData(statement, 0);
+				releaseStatement(statement, cacheEntry);
+				return true;
+			}
+		}
+	}
+	releaseStatement(statement, cacheEntry);
+
+	return false;
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename P>
+SqlRows SQLiteDB::getResultRowsInner(UTF query, P qParams) {
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
+
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	if(prepareStatement(query, &statement, qParams, cacheEntry) == SQLITE_OK){
+		m_numColumns = sqlite3_column_count(statement);
+		if (m_numColumns){			
+			return SqlRows(statement, m_stmtCache, cacheEntry);
+			// no need to release the statement here as it will be done by 
+			//the destructor of SqlRow
+		}
+	}
+	releaseStatement(statement, cacheEntry);
+
+	return nullptr;
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF>
+SqlRows SQLiteDB::getResultRows(UTF query, QParams qParams){
+	return getResultRowsInner(query, qParams);
+}
+
+template<typename UTF>
+SqlRows SQLiteDB::getResultRows(UTF query, unsigned int prepFlags){
+	return getResultRowsInner(query, prepFlags);
+}
+
+template<typename UTF> 
+void SQLiteDB::applyToRows(UTF query, SqlRowFunc callback, QParams qParams){
+	applyToRowsInner(query, callback, qParams);
+}
+
+
+template<typename UTF> 
+void SQLiteDB::applyToRows(UTF query, SqlRowFunc callback, unsigned int prepFlags){
+	applyToRowsInner(query, callback, prepFlags);
+}
+
+template<typename UTF>
+bool SQLiteDB::executeQuery(UTF query, QParams qParams){
+	return executeQueryInner(query, qParams);
+}
+
+template<typename UTF>
+bool SQLiteDB::executeQuery(UTF query, unsigned int prepFlags){
+	return executeQueryInner(query, prepFlags);
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename P>
+bool SQLiteDB::executeQueryInner(UTF query, P qParams) {
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
+
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	if(prepareStatement(query, &statement, qParams, cacheEntry) == SQLITE_OK){
+		stepStatement(statement, cacheEntry);
+		releaseStatement(statement, cacheEntry);
+
+		return true;
+	}
+	releaseStatement(statement, cacheEntry);
+
+	return false;
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename... Args>
+SqlRows SQLiteDB::executeSecureQuery(QParams qParams, UTF query, Args&&... args){
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	if(prepareStatement(query, &statement, qParams, cacheEntry) == SQLITE_OK){
+		if(SQLITE_OK==binding(statement, 0, std::forward<Args>(args)...)){
+			m_numColumns = sqlite3_column_count(statement);
+			if (m_numColumns){
+				return SqlRows(statement, m_stmtCache, cacheEntry);
+			}
+			stepStatement(statement, cacheEntry);
+		}
+	}
+	releaseStatement(statement, cacheEntry);
+
+	return nullptr;
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename... Args>
+SqlRows SQLiteDB::executeSecureQuery(unsigned int prepFlags, UTF query, Args&&... args){
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+	if(prepFlags==0){
+		return 
+		executeSecureQuery<UTF>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8), query, std::forward<Args>(args)...);
+	}
+	return executeSecureQuery<UTF>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8, prepFlags), query, std::forward<Args>(args)...);
+}
+
+
+template<typename UTF, typename... Args>
+SqlRows SQLiteDB::executeSecureQueryNf(UTF query, Args&&... args){
+	return executeSecureQuery<UTF>(QParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8), query, std::forward<Args>(args)...);
+}
+#ifdef SQLITE_DB_SQL_LITERAL
+//----------------------------------------------------------------------
+
+template<sql_text S, typename... Args>
+SqlRows SQLiteDB::executeSecureQuery(unsigned int prepFlags, sql_literal<S> query, Args&&... args){
+	static_assert(sizeof...(Args)==sql_literal<S>::parameters, "the number of arguments should match the number of parameters of the query");
+	QParams qParams(query.nByte(), true, prepFlags);
+	qParams.m_sqlHash=query.hash;
+	return executeSecureQuery(qParams, query.c_str(), std::forward<Args>(args)...);
+}
+
+template<sql_text S, typename... Args>
+SqlRows SQLiteDB::executeSecureQueryNf(sql_literal<S> query, Args&&... args){
+	return executeSecureQuery(0u, query, std::forward<Args>(args)...);
+}
+#endif
+
+//----------------------------------------------------------------------
+
+template<typename... Ts, typename UTF, typename... Args>
+TypedRows<Ts...> SQLiteDB::query(UTF query, Args&&... args){
+	return TypedRows<Ts...>(executeSecureQueryNf(query, std::forward<Args>(args)...));
+}
+
+#ifdef SQLITE_DB_ROW_STREAM
+//----------------------------------------------------------------------
+
+template<typename... Ts, typename UTF, typename... Args>
+RowStream<Ts...> SQLiteDB::stream(UTF query, Args&&... args){
+	return RowStream<Ts...>::generate(TypedRows<Ts...>(executeSecureQueryNf(query, std::forward<Args>(args)...)));
+}
+#endif
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename Range>
+BatchResult SQLiteDB::executeMany(UTF query, const Range& rows, size_t chunkSize){
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+
+	std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+	BatchResult result{0, SQLITE_OK, 0.0};
+
+	sqlite3_stmt* statement;
+	StatementCache::Entry* cacheEntry;
+	QParams qParams(DB_CONNECT<UTF>::strLength(query), DB_CONNECT<UTF>::is_utf8);
+	result.errorCode=prepareStatement(query, &statement, qParams, cacheEntry);
+	if(result.errorCode!=SQLITE_OK){
+		releaseStatement(statement, cacheEntry);
+		return result;
+	}
+
+	// do not interfere with a transaction opened by the caller
+	const bool ownTransaction=chunkSize>0 && !inTransaction();
+	size_t inChunk=0;
+
+	for(const auto& row : rows){
+		if(ownTransaction && inChunk==0){
+			result.errorCode=beginTransaction();
+			if(result.errorCode!=SQLITE_OK){
+				break;
+			}
+		}
+
+		int rc=std::apply([statement](const auto&... args){
+			return binding(statement, 0, args...);
+		}, row);
+		if(rc==SQLITE_OK){
+			rc=stepStatement(statement, cacheEntry);
+			if(rc==SQLITE_DONE || rc==SQLITE_ROW){
+				rc=SQLITE_OK;
+			}
+		}
+		sqlite3_reset(statement);
+		sqlite3_clear_bindings(statement);
+
+		if(rc!=SQLITE_OK){
+			result.errorCode=rc;
+			break;
+		}
+
+		inChunk++;
+		if(!ownTransaction){
+			result.rows++;
+		}
+		else if(inChunk==chunkSize){
+			result.errorCode=commitTransaction();
+			if(result.errorCode!=SQLITE_OK){
+				break;
+			}
+			result.rows+=inChunk;
+			inChunk=0;
+		}
+	}
+
+	if(ownTransaction && inTransaction()){
+		if(result.errorCode==SQLITE_OK){
+			result.errorCode=commitTransaction();
+			if(result.errorCode==SQLITE_OK){
+				result.rows+=inChunk;
+			}
+		}
+		if(result.errorCode!=SQLITE_OK){
+			rollbackTransaction();
+		}
+	}
+	releaseStatement(statement, cacheEntry);
+
+	result.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+	return result;
+}
+
+//----------------------------------------------------------------------
+
+inline ScriptResult SQLiteDB::executeScript(const char* script, bool transaction, bool stopOnError){
+	std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+	ScriptResult result{{}, SQLITE_OK, 0, false, 0.0};
+
+	if(m_slowLog && m_slowLog->hasPending()){
+		m_slowLog->flush(m_DB);
+	}
+	if(!m_scripts){
+		m_scripts=std::make_unique<ScriptCache>(m_DB);
+	}
+	if(transaction){
+		result.errorCode=runStatement("SAVEPOINT sqlite_db_script");
+		if(result.errorCode!=SQLITE_OK){
+			return result;
+		}
+	}
+
+	ScriptCache::Entry entry=m_scripts->acquire(script);
+	for(size_t i=0; ; i++){
+		sqlite3_stmt* statement;
+		size_t offset;
+		int rc=m_scripts->statement(*entry, i, statement, offset);
+		if(rc==SQLITE_OK && !statement){
+			break;
+		}
+
+		StatementResult outcome{offset, rc, 0, std::string()};
+		if(rc==SQLITE_OK){
+			sqlite3_int64 changes=sqlite3_total_changes64(m_DB);
+			do{
+				rc=sqlite3_step(statement);
+			}while(rc==SQLITE_ROW);
+			outcome.changes=sqlite3_total_changes64(m_DB)-changes;
+			outcome.errorCode=(rc==SQLITE_DONE) ? SQLITE_OK : rc;
+		}
+		if(outcome.errorCode!=SQLITE_OK){
+			// before the reset, which may change the message
+			outcome.errorMessage=sqlite3_errmsg(m_DB);
+		}
+		if(statement){
+			sqlite3_reset(statement);
+		}
+
+		result.changes+=outcome.changes;
+		result.statements.push_back(std::move(outcome));
+		const int errorCode=result.statements.back().errorCode;
+		if(errorCode!=SQLITE_OK){
+			if(result.errorCode==SQLITE_OK){
+				result.errorCode=errorCode;
+			}
+			if(stopOnError || transaction || !statement){
+				break;
+			}
+		}
+	}
+	m_scripts->release(entry);
+
+	if(transaction){
+		if(result.errorCode==SQLITE_OK){
+			result.errorCode=runStatement("RELEASE sqlite_db_script");
+		}
+		if(result.errorCode!=SQLITE_OK){
+			// fails if SQLite rolled back the whole transaction already
+			runStatement("ROLLBACK TO sqlite_db_script");
+			runStatement("RELEASE sqlite_db_script");
+			result.rolledBack=true;
+		}
+	}
+
+	result.seconds=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+	return result;
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename P>
+void SQLiteDB::applyToRowsInner(UTF query, SqlRowFunc callback, P qParams) {
+	SqlRows row=getResultRowsInner(query, qParams);
+	while(row.yield()){
+		callback(row);
+	}
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsInt(UTF query, int& resultValue, QParams qParams){
+	return getUnique<UTF, int>(query, resultValue, qParams);
+}
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsInt(UTF query, int& resultValue, unsigned int prepFlags){
+	return getUnique<UTF, int>(query, resultValue, prepFlags);
+}
+//----------------------------------------------------------------------
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsDouble(UTF query, double& resultValue, QParams qParams){
+	return getUnique<UTF, double>(query, resultValue, qParams);
+}
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsDouble(UTF query, double& resultValue, unsigned int prepFlags){
+	return getUnique<UTF, double>(query, resultValue, prepFlags);
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsString(UTF query, std::string& resultValue, QParams qParams){
+	return getUnique<UTF, std::string>(query, resultValue, qParams);
+}
+
+template<typename UTF>
+bool SQLiteDB::uniqueAsString(UTF query, std::string& resultValue, unsigned int prepFlags){
+	return getUnique<UTF, std::string>(query, resultValue, prepFlags);
+}
+
+//######################################################################
+//######################################################################
+
+
+#endif
@@ -0,0 +1,639 @@
+/*********************************************************************
+* SQLiteDBPool class                                                 *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_DB_POOL_H
+#define SQLITE_DB_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <sqlite3.h>
+
+#include "sqlite_db.h"
+
+//######################################################################
+
+/**
+ * Pool of connections to one database file for multi-threaded readers.
+ *
+ * The pool opens one read-write connection, switches the database to WAL
+ * journal mode (so readers do not block the writer nor each other) and
+ * then opens numReaders connections with
+ * SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX.
+ *
+ * Connections are handed out through RAII leases: a read lease takes a
+ * reader from a lock-free free list, the write lease locks the writer.
+ * When every reader is leased, acquireReader sleeps on a condition
+ * variable until a lease is released.
+ * Every connection keeps its own statement cache, which stays warm
+ * from one lease to the next.
+ *
+ * Example:
+ * SQLiteDBPool pool("database_test.db", 8);
+ *
+ * // in any thread
+ * SQLiteDBPool::ReadLease reader=pool.acquireReader();
+ * int n;
+ * reader->uniqueAsInt("select count(*) from COMPANY", n);
+ *
+ * @note any SqlRows obtained through a lease must be destroyed before
+ *     the lease.
+ */
+
+class SQLiteDBPool
+{
+	public:
+		/**
+		 * How SQLiteDBPool::parallelScan splits the key range.
+		 */
+		enum class Partitioning
+		{
+			Range,      // equal width ranges between min and max of an
+			            // integer key, Quantiles for other keys
+			Quantiles,  // boundaries from a sorted random sample of the
+			            // keys, for skewed distributions
+		};
+
+		/**
+		 * Lease of a read-only connection, the connection goes back to
+		 * the pool when the lease is destroyed.
+		 */
+		class ReadLease
+		{
+			public:
+				ReadLease(ReadLease&& other);
+				~ReadLease();
+
+				ReadLease(const ReadLease&)=delete;
+				ReadLease& operator=(const ReadLease&)=delete;
+
+				SQLiteDB& operator*() const;
+				SQLiteDB* operator->() const;
+
+				/**
+				 * false if the lease holds no connection
+				 * (see SQLiteDBPool::tryAcquireReader).
+				 */
+				explicit operator bool() const;
+
+			private:
+				SQLiteDBPool* m_pool;
+				int m_index;
+
+				ReadLease(SQLiteDBPool* pool, int index);
+
+			friend SQLiteDBPool;
+		};
+
+		/**
+		 * Exclusive lease of the read-write connection, to be released
+		 * by the thread that acquired it.
+		 */
+		class WriteLease
+		{
+			public:
+				WriteLease(WriteLease&& other)=default;
+				~WriteLease();
+
+				SQLiteDB& operator*() const;
+				SQLiteDB* operator->() const;
+
+			private:
+				SQLiteDBPool* m_pool;
+				std::unique_lock<std::mutex> m_lock;
+
+				WriteLease(SQLiteDBPool* pool, std::unique_lock<std::mutex>&& lock);
+
+			friend SQLiteDBPool;
+		};
+
+		/**
+		 * Open the writer and numReaders read-only connections.
+		 *
+		 * @param dbName Database file name.
+		 * @param numReaders number of read-only connections, by default
+		 *     the number of hardware threads.
+		 * @throws const char* if any connection cannot be opened or the
+		 *     database cannot be switched to WAL mode.
+		 */
+		explicit SQLiteDBPool(const char* dbName, unsigned int numReaders=std::thread::hardware_concurrency());
+
+		virtual ~SQLiteDBPool()=default;
+
+		SQLiteDBPool(const SQLiteDBPool&)=delete;
+		SQLiteDBPool& operator=(const SQLiteDBPool&)=delete;
+
+		/**
+		 * Take a reader from the pool, waiting for one to be available.
+		 */
+		ReadLease acquireReader();
+
+		/**
+		 * Take a reader from the pool, waiting at most timeout for one 
+		 * to be available; the lease returned is empty on timeout.
+		 */
+		ReadLease acquireReader(std::chrono::milliseconds timeout);
+
+		/**
+		 * Take a reader from the pool if there is one available,
+		 * otherwise the lease returned is empty.
+		 */
+		ReadLease tryAcquireReader();
+
+		/**
+		 * Lock the read-write connection.
+		 */
+		WriteLease acquireWriter();
+
+		/**
+		 * Number of read-only connections.
+		 */
+		size_t readerCount() const;
+
+		/**
+		 * Scan the rows of table matching predicate in parallel, split in
+		 * nPartitions ranges of keyColumn, each one read in its own
+		 * thread by its own reader.
+		 *
+		 * All the partitions read the same snapshot. With SQLite built
+		 * with SQLITE_ENABLE_SNAPSHOT (define it here as well), the first
+		 * reader takes it with sqlite3_snapshot_get and the others open
+		 * it with sqlite3_snapshot_open. Otherwise their read transactions
+		 * are opened while the writer of the pool is locked, which only
+		 * holds back the writes made through the pool, not the ones of
+		 * other connections or processes.
+		 *
+		 * @note without SQLITE_ENABLE_SNAPSHOT, a thread holding the
+		 *     WriteLease cannot scan: the scan returns SQLITE_BUSY instead
+		 *     of locking the writer a second time.
+		 *
+		 * Example:
+		 * std::atomic<long long> total(0);
+		 * pool.parallelScan("COMPANY", "ID", "Age>30", 8, [&total](SqlRows& row){
+		 *     total+=row.as_int("Salary");
+		 * });
+		 *
+		 * @param table the table to scan
+		 * @param keyColumn column the partitions are ranges of, ideally
+		 *     the rowid or an indexed column
+		 * @param predicate SQL expression filtering the rows, nullptr
+		 *     for all the rows
+		 * @param nPartitions number of partitions, at most readerCount() 
+		 *     and at most the readers free when the scan starts (if none 
+		 *     is, the scan waits for one)
+		 * @param callback called as callback(SqlRows&) for every row
+		 *     (select *), concurrently from the worker threads
+		 * @param partitioning how the boundaries are chosen
+		 * @return SQLITE_OK, SQLITE_BUSY (see the note above) or the
+		 *     first error code. An exception thrown
+		 *     by callback, or std::system_error if a thread cannot be 
+		 *     started, is rethrown once all the threads are done.
+		 */
+		template<typename F>
+		int parallelScan(const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, F callback, Partitioning partitioning=Partitioning::Range);
+
+		/**
+		 * Same as SQLiteDBPool::parallelScan, but the rows are decoded as
+		 * in SQLiteDB::query and merged in keyColumn order into result.
+		 *
+		 * @param columns the select list, decoded as Ts...
+		 * @tparam Ts the column types, they must own their value
+		 *     (std::string rather than std::string_view).
+		 * @return SQLITE_OK or the first error code.
+		 */
+		template<typename... Ts>
+		int parallelScanOrdered(const char* columns, const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, std::vector<std::tuple<typename ColumnData<Ts>::returnType...>>& result, Partitioning partitioning=Partitioning::Range);
+
+	private:
+		std::unique_ptr<SQLiteDB> m_writer;
+		std::mutex m_writerMutex;
+		// thread holding the WriteLease, to refuse a scan from it
+		std::atomic<std::thread::id> m_writerOwner;
+		std::vector<std::unique_ptr<SQLiteDB>> m_readers;
+
+		// Treiber stack of free readers: the low 32 bits of m_head are
+		// index+1 of the top (0 when empty), the high 32 bits a counter
+		// that changes on every update to avoid ABA.
+		std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+		std::atomic<uint64_t> m_head;
+
+		// acquireReader sleeps here when the free list is empty, push
+		// only takes the mutex if m_waiting is not 0
+		std::mutex m_freeMutex;
+		std::condition_variable m_released;
+		std::atomic<int> m_waiting;
+
+		int pop();
+		void push(int index);
+
+		static std::vector<sqlite3_value*> partitionBoundaries(SQLiteDB& db, const std::string& table, const std::string& key, const std::string& where, unsigned int nPartitions, Partitioning partitioning);
+
+		template<typename F>
+		int scanPartitions(const std::string& columns, const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, bool ordered, Partitioning partitioning, F consume);
+};
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::SQLiteDBPool(const char* dbName, unsigned int numReaders)
+:m_writer(new SQLiteDB(dbName, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_NOMUTEX)),
+m_writerOwner(std::thread::id()),
+m_next(new std::atomic<uint32_t>[numReaders>0 ? numReaders : 1]),
+m_head(0),
+m_waiting(0)
+{
+	std::string journalMode;
+	if(!m_writer->uniqueAsString("PRAGMA journal_mode=WAL", journalMode) || (journalMode!="wal" && journalMode!="memory")){
+		throw "Database could not be switched to WAL journal mode.";
+	}
+
+	if(numReaders==0){
+		numReaders=1;
+	}
+	m_readers.reserve(numReaders);
+	for(unsigned int i=0; i<numReaders; i++){
+		m_readers.emplace_back(new SQLiteDB(dbName, SQLITE_OPEN_READONLY|SQLITE_OPEN_NOMUTEX));
+		push(static_cast<int>(i));
+	}
+}
+
+//----------------------------------------------------------------------
+
+// m_head and m_waiting are accessed with sequential consistency: either
+// a waiter sees the reader pushed, or the pusher sees the waiter.
+inline int SQLiteDBPool::pop(){
+	uint64_t head=m_head.load();
+	while(true){
+		uint32_t top=static_cast<uint32_t>(head);
+		if(top==0){
+			return -1;
+		}
+		uint64_t next=m_next[top-1].load(std::memory_order_relaxed);
+		uint64_t newHead=(((head>>32)+1)<<32) | next;
+		if(m_head.compare_exchange_weak(head, newHead)){
+			return static_cast<int>(top-1);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void SQLiteDBPool::push(int index){
+	uint64_t head=m_head.load(std::memory_order_relaxed);
+	uint64_t newHead;
+	do{
+		m_next[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+		newHead=(((head>>32)+1)<<32) | static_cast<uint64_t>(index+1);
+	}while(!m_head.compare_exchange_weak(head, newHead));
+
+	if(m_waiting.load()>0){
+		// all of them: a waiter timing out may not take the reader
+		std::lock_guard<std::mutex> lock(m_freeMutex);
+		m_released.notify_all();
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease SQLiteDBPool::acquireReader(){
+	int index=pop();
+	if(index<0){
+		std::unique_lock<std::mutex> lock(m_freeMutex);
+		m_waiting++;
+		m_released.wait(lock, [this, &index]{
+			return (index=pop())>=0;
+		});
+		m_waiting--;
+	}
+	return ReadLease(this, index);
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease SQLiteDBPool::acquireReader(std::chrono::milliseconds timeout){
+	int index=pop();
+	if(index<0){
+		std::unique_lock<std::mutex> lock(m_freeMutex);
+		m_waiting++;
+		m_released.wait_for(lock, timeout, [this, &index]{
+			return (index=pop())>=0;
+		});
+		m_waiting--;
+	}
+	return ReadLease(this, index);
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease SQLiteDBPool::tryAcquireReader(){
+	return ReadLease(this, pop());
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::WriteLease SQLiteDBPool::acquireWriter(){
+	std::unique_lock<std::mutex> lock(m_writerMutex);
+	m_writerOwner.store(std::this_thread::get_id());
+	return WriteLease(this, std::move(lock));
+}
+
+//----------------------------------------------------------------------
+
+inline size_t SQLiteDBPool::readerCount() const{
+	return m_readers.size();
+}
+
+//----------------------------------------------------------------------
+
+inline std::vector<sqlite3_value*> SQLiteDBPool::partitionBoundaries(SQLiteDB& db, const std::string& table, const std::string& key, const std::string& where, unsigned int nPartitions, Partitioning partitioning){
+	std::vector<sqlite3_value*> boundaries;
+	if(nPartitions<2){
+		return boundaries;
+	}
+
+	if(partitioning==Partitioning::Range){
+		SqlRows rows=db.getResultRows(("select min("+key+"), max("+key+") from "+table+where).c_str());
+		if(rows.yield() && rows.as_type(ColumnRef(0))==SQLITE_INTEGER && rows.as_type(ColumnRef(1))==SQLITE_INTEGER){
+			sqlite3_int64 low=rows.as_int64(ColumnRef(0));
+			uint64_t span=static_cast<uint64_t>(rows.as_int64(ColumnRef(1)))-static_cast<uint64_t>(low);
+			for(unsigned int i=1; i<nPartitions; i++){
+				// low+span*i/nPartitions without overflowing
+				uint64_t offset=span/nPartitions*i+span%nPartitions*i/nPartitions;
+				SqlRows value=db.executeSecureQueryNf("select ?", static_cast<sqlite3_int64>(static_cast<uint64_t>(low)+offset));
+				if(value.yield()){
+					boundaries.push_back(sqlite3_value_dup(value.as_value(ColumnRef(0))));
+				}
+			}
+			return boundaries;
+		}
+	}
+
+	// about 64 samples per partition, in a single pass over the keys
+	int count=0;
+	db.uniqueAsInt(("select count(*) from "+table+where).c_str(), count);
+	sqlite3_int64 stride=std::max<sqlite3_int64>(1, count/(nPartitions*64));
+	std::string sample="select "+key+" from "+table+where+(where.empty() ? " where " : " and ")+"abs(random()%?)=0 order by "+key;
+	std::vector<sqlite3_value*> keys;
+	SqlRows rows=db.executeSecureQueryNf(sample.c_str(), stride);
+	while(rows.yield()){
+		keys.push_back(sqlite3_value_dup(rows.as_value(ColumnRef(0))));
+	}
+	for(unsigned int i=1; i<nPartitions && !keys.empty(); i++){
+		boundaries.push_back(sqlite3_value_dup(keys[keys.size()*i/nPartitions]));
+	}
+	for(sqlite3_value* value : keys){
+		sqlite3_value_free(value);
+	}
+	return boundaries;
+}
+
+//----------------------------------------------------------------------
+
+template<typename F>
+int SQLiteDBPool::scanPartitions(const std::string& columns, const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, bool ordered, Partitioning partitioning, F consume){
+#ifndef SQLITE_ENABLE_SNAPSHOT
+	if(m_writerOwner.load()==std::this_thread::get_id()){
+		// the writer is locked below, std::mutex is not recursive
+		return SQLITE_BUSY;
+	}
+#endif
+	nPartitions=std::max(1u, std::min(nPartitions, static_cast<unsigned int>(m_readers.size())));
+	const std::string quotedTable=quoteIdentifier(table);
+	const std::string key=quoteIdentifier(keyColumn);
+	const std::string where=(predicate && *predicate) ? std::string(" where (")+predicate+")" : std::string();
+
+	// only the readers free right now, waiting while there is none: a
+	// scan never waits holding readers, so two scans, or a caller holding
+	// a ReadLease, cannot wait for each other
+	std::vector<ReadLease> leases;
+	leases.reserve(nPartitions);
+	while(leases.size()<nPartitions){
+		ReadLease lease=tryAcquireReader();
+		if(!lease){
+			break;
+		}
+		leases.push_back(std::move(lease));
+	}
+	if(leases.empty()){
+		leases.push_back(acquireReader());
+	}
+	nPartitions=static_cast<unsigned int>(leases.size());
+
+	// in WAL mode a read transaction takes its snapshot on the first
+	// read
+	int rc=SQLITE_OK;
+#ifdef SQLITE_ENABLE_SNAPSHOT
+	// the first reader reads and takes its snapshot, the others open it
+	// before reading
+	sqlite3_snapshot* snapshot=nullptr;
+	for(size_t i=0; rc==SQLITE_OK && i<leases.size(); i++){
+		if((rc=leases[i]->beginTransaction())!=SQLITE_OK){
+			break;
+		}
+		if(i>0 && (rc=sqlite3_snapshot_open(leases[i]->m_DB, "main", snapshot))!=SQLITE_OK){
+			break;
+		}
+		int ignored;
+		leases[i]->uniqueAsInt("select count(*) from sqlite_master", ignored);
+		if(i==0){
+			rc=sqlite3_snapshot_get(leases[i]->m_DB, "main", &snapshot);
+		}
+	}
+	if(snapshot){
+		sqlite3_snapshot_free(snapshot);
+	}
+#else
+	{
+		// with the writer locked, all the readers get the same snapshot
+		WriteLease writer=acquireWriter();
+		for(ReadLease& lease : leases){
+			if(rc==SQLITE_OK && (rc=lease->beginTransaction())==SQLITE_OK){
+				int ignored;
+				lease->uniqueAsInt("select count(*) from sqlite_master", ignored);
+			}
+		}
+	}
+#endif
+
+	std::vector<sqlite3_value*> boundaries;
+	if(rc==SQLITE_OK){
+		boundaries=partitionBoundaries(*leases[0], quotedTable, key, where, nPartitions, partitioning);
+		nPartitions=static_cast<unsigned int>(boundaries.size())+1;
+	}
+
+	std::vector<int> results(nPartitions, SQLITE_OK);
+	std::vector<std::exception_ptr> exceptions(nPartitions);
+	std::vector<std::thread> workers;
+	// a thread that cannot be started: the ones running are joined first
+	std::exception_ptr spawnError;
+	try{
+		for(unsigned int i=0; rc==SQLITE_OK && i<nPartitions; i++){
+			workers.emplace_back([&, i](){
+				SQLiteDB& db=*leases[i];
+				std::string sql="select "+columns+" from "+quotedTable+(where.empty() ? " where 1" : where);
+				if(i>0){
+					sql+=" and "+key+">=?";
+				}
+				if(i+1<nPartitions){
+					sql+=(i==0) ? " and ("+key+"<? or "+key+" is null)" : " and "+key+"<?";
+				}
+				if(ordered){
+					sql+=" order by "+key;
+				}
+				try{
+					SqlRows rows=(i==0) ? (nPartitions==1 ? db.executeSecureQueryNf(sql.c_str()) : db.executeSecureQueryNf(sql.c_str(), boundaries[0]))
+						: (i+1<nPartitions ? db.executeSecureQueryNf(sql.c_str(), boundaries[i-1], boundaries[i]) : db.executeSecureQueryNf(sql.c_str(), boundaries[i-1]));
+					consume(rows, i);
+					int code=db.lastErrorCode();
+					results[i]=(code==SQLITE_DONE || code==SQLITE_ROW) ? SQLITE_OK : code;
+				}
+				catch(...){
+					exceptions[i]=std::current_exception();
+				}
+			});
+		}
+	}
+	catch(...){
+		spawnError=std::current_exception();
+	}
+	for(std::thread& worker : workers){
+		worker.join();
+	}
+
+	for(ReadLease& lease : leases){
+		if(lease->inTransaction()){
+			lease->commitTransaction();
+		}
+	}
+	for(sqlite3_value* value : boundaries){
+		sqlite3_value_free(value);
+	}
+	if(spawnError){
+		std::rethrow_exception(spawnError);
+	}
+	for(std::exception_ptr& exception : exceptions){
+		if(exception){
+			std::rethrow_exception(exception);
+		}
+	}
+	for(int code : results){
+		if(rc==SQLITE_OK){
+			rc=code;
+		}
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+template<typename F>
+int SQLiteDBPool::parallelScan(const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, F callback, Partitioning partitioning){
+	return scanPartitions("*", table, keyColumn, predicate, nPartitions, false, partitioning, [&callback](SqlRows& rows, unsigned int){
+		while(rows.yield()){
+			callback(rows);
+		}
+	});
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+int SQLiteDBPool::parallelScanOrdered(const char* columns, const char* table, const char* keyColumn, const char* predicate, unsigned int nPartitions, std::vector<std::tuple<typename ColumnData<Ts>::returnType...>>& result, Partitioning partitioning){
+	// the partitions are disjoint ranges of the key, in order: each one
+	// sorted by the key, their concatenation is sorted as well
+	std::vector<std::vector<std::tuple<typename ColumnData<Ts>::returnType...>>> parts(std::max(1u, nPartitions));
+	int rc=scanPartitions(columns, table, keyColumn, predicate, nPartitions, true, partitioning, [&parts](SqlRows& rows, unsigned int i){
+		while(rows.yield()){
+			parts[i].push_back(rows.get<Ts...>());
+		}
+	});
+	result.clear();
+	for(auto& part : parts){
+		result.insert(result.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+	}
+	return rc;
+}
+
+//######################################################################
+
+inline SQLiteDBPool::ReadLease::ReadLease(SQLiteDBPool* pool, int index)
+:m_pool(pool),
+m_index(index)
+{}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease::ReadLease(ReadLease&& other)
+:m_pool(other.m_pool),
+m_index(other.m_index)
+{
+	other.m_index=-1;
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease::~ReadLease(){
+	if(m_index>=0){
+		m_pool->push(m_index);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDB& SQLiteDBPool::ReadLease::operator*() const{
+	return *m_pool->m_readers[m_index];
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDB* SQLiteDBPool::ReadLease::operator->() const{
+	return m_pool->m_readers[m_index].get();
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::ReadLease::operator bool() const{
+	return m_index>=0;
+}
+
+//######################################################################
+
+inline SQLiteDBPool::WriteLease::WriteLease(SQLiteDBPool* pool, std::unique_lock<std::mutex>&& lock)
+:m_pool(pool),
+m_lock(std::move(lock))
+{}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDBPool::WriteLease::~WriteLease(){
+	// before m_lock unlocks the writer
+	if(m_lock.owns_lock()){
+		m_pool->m_writerOwner.store(std::thread::id());
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDB& SQLiteDBPool::WriteLease::operator*() const{
+	return *m_pool->m_writer;
+}
+
+//----------------------------------------------------------------------
+
+inline SQLiteDB* SQLiteDBPool::WriteLease::operator->() const{
+	return m_pool->m_writer.get();
+}
+
+#endif
@@ -11,7 +11,11 @@
 #define SQLITE_DB_TRAITS_H
 
 #include <cstring>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <sqlite3.h> 
 
 #include <iostream>
@@ -136,6 +140,13 @@ struct sqlite_ptr : public BindParams<void*, const char*>
 };
 
 
+/*
+ * ColumnData<T>::getColumnData and BindDataTrait<T>::bindData are inline
+ * static functions: the specialization is chosen at compile time and the
+ * call to the sqlite3_column_* / sqlite3_bind_* function can be inlined 
+ * in the caller.
+ */
+
 template<typename T>
 struct ColumnData
 {};
@@ -145,8 +156,9 @@ template<>
 struct ColumnData<int>
 {
 	typedef int returnType;
-	typedef int(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_int(sqlitest, i);
+	}
 };
 
 
@@ -154,8 +166,9 @@ template<>
 struct ColumnData<double>
 {
 	typedef double returnType;
-	typedef double(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_double(sqlitest, i);
+	}
 };
 
 
@@ -163,10 +176,41 @@ template<>
 struct ColumnData<std::string>
 {
 	typedef std::string returnType;
-	typedef std::string(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
-	static std::string columnToString(sqlite3_stmt* sqlitest, int){
-		return reinterpret_cast<char const*>(sqlite3_column_text(sqlitest, 0));
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		const char* str=reinterpret_cast<char const*>(sqlite3_column_text(sqlitest, i));
+		if(!str){
+			return std::string();
+		}
+		return std::string(str, sqlite3_column_bytes(sqlitest, i));
+	}
+};
+
+
+template<>
+struct ColumnData<std::string_view>
+{
+	typedef std::string_view returnType;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		// sqlite3_column_text before sqlite3_column_bytes, see sqlite3_column_blob
+		const char* str=reinterpret_cast<char const*>(sqlite3_column_text(sqlitest, i));
+		if(!str){
+			return std::string_view();
+		}
+		return std::string_view(str, sqlite3_column_bytes(sqlitest, i));
+	}
+};
+
+
+template<>
+struct ColumnData<std::u16string_view>
+{
+	typedef std::u16string_view returnType;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		const char16_t* str=static_cast<const char16_t*>(sqlite3_column_text16(sqlitest, i));
+		if(!str){
+			return std::u16string_view();
+		}
+		return std::u16string_view(str, sqlite3_column_bytes16(sqlitest, i)/sizeof(char16_t));
 	}
 };
 
@@ -175,8 +219,9 @@ template<>
 struct ColumnData<sqlite3_int64>
 {
 	typedef sqlite3_int64 returnType;
-	typedef sqlite3_int64(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_int64(sqlitest, i);
+	}
 };
 
 
@@ -184,8 +229,9 @@ template<>
 struct ColumnData<sqlite3_value*>
 {
 	typedef sqlite3_value* returnType;
-	typedef sqlite3_value*(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_value(sqlitest, i);
+	}
 };
 
 
@@ -193,8 +239,9 @@ template<>
 struct ColumnData<blob>
 {
 	typedef const void* returnType;
-	typedef const void*(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_blob(sqlitest, i);
+	}
 };
 
 
@@ -202,8 +249,9 @@ template<>
 struct ColumnData<const void*>
 {
 	typedef const void* returnType;
-	typedef const void*(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_blob(sqlitest, i);
+	}
 };
 
 
@@ -211,8 +259,9 @@ template<>
 struct ColumnData<text>
 {
 	typedef const unsigned char* returnType;
-	typedef const unsigned char*(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_text(sqlitest, i);
+	}
 };
 
 
@@ -220,8 +269,9 @@ template<>
 struct ColumnData<text16>
 {
 	typedef const void* returnType;
-	typedef const void*(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_text16(sqlitest, i);
+	}
 };
 
 
@@ -229,8 +279,9 @@ template<>
 struct ColumnData<bytes>
 {
 	typedef int returnType;
-	typedef int(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_bytes(sqlitest, i);
+	}
 };
 
 
@@ -238,8 +289,9 @@ template<>
 struct ColumnData<bytes16>
 {
 	typedef int returnType;
-	typedef int(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_bytes16(sqlitest, i);
+	}
 };
 
 
@@ -247,8 +299,9 @@ template<>
 struct ColumnData<sqlite_type>
 {
 	typedef int returnType;
-	typedef int(*ColFunc)(sqlite3_stmt*, int);
-	static ColFunc getColumnData;
+	static returnType getColumnData(sqlite3_stmt* sqlitest, int i){
+		return sqlite3_column_type(sqlitest, i);
+	}
 };
 
 //======================================================================
@@ -261,28 +314,27 @@ struct BindDataTrait
 template<>
 struct BindDataTrait<int>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, int);
-	static BindFunc bindData;
+	static int bindData(sqlite3_stmt* statement, int t, int value){
+		return sqlite3_bind_int(statement, t, value);
+	}
 };
 
 
 template<>
 struct BindDataTrait<double>
 {
-	typedef double(*ColFunc)(sqlite3_stmt*, int);
-	typedef int(*BindFunc)(sqlite3_stmt*, int, double);
-	static ColFunc getColumnData;
-	static BindFunc bindData;
+	static int bindData(sqlite3_stmt* statement, int t, double value){
+		return sqlite3_bind_double(statement, t, value);
+	}
 };
 
 
 template<>
 struct BindDataTrait<std::string>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, const std::string&);
-	static BindFunc bindData;
-	static int bindStringData(sqlite3_stmt* statement, int t, const std::string& str){
-		return sqlite3_bind_text(statement, t, str.c_str(), -1, NULL);;
+	static int bindData(sqlite3_stmt* statement, int t, const std::string& str){
+		// the string bound may not outlive binding()
+		return sqlite3_bind_text(statement, t, str.c_str(), static_cast<int>(str.size()), SQLITE_TRANSIENT);
 	}
 };
 
@@ -290,10 +342,8 @@ struct BindDataTrait<std::string>
 template<>
 struct BindDataTrait<const char*>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, const char*);
-	static BindFunc bindData;
-	static int bindCstringData(sqlite3_stmt* statement, int t, const char* cstr){
-		return sqlite3_bind_text(statement, t, cstr, -1, NULL);;
+	static int bindData(sqlite3_stmt* statement, int t, const char* cstr){
+		return sqlite3_bind_text(statement, t, cstr, -1, NULL);
 	}
 };
 
@@ -301,25 +351,25 @@ struct BindDataTrait<const char*>
 template<>
 struct BindDataTrait<sqlite3_int64>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, sqlite3_int64);
-	static BindFunc bindData;
+	static int bindData(sqlite3_stmt* statement, int t, sqlite3_int64 value){
+		return sqlite3_bind_int64(statement, t, value);
+	}
 };
 
 
 template<>
 struct BindDataTrait<sqlite3_value*>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, const sqlite3_value*);
-	static BindFunc bindData;
+	static int bindData(sqlite3_stmt* statement, int t, const sqlite3_value* value){
+		return sqlite3_bind_value(statement, t, value);
+	}
 };
 
 
 template<>
 struct BindDataTrait<blob>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, blob);
-	static BindFunc bindData;
-	static int bindBlobData(sqlite3_stmt* sqlitest, int t, blob blobData){		
+	static int bindData(sqlite3_stmt* sqlitest, int t, const blob& blobData){
 		return sqlite3_bind_blob(sqlitest, t, blobData.m_v, blobData.m_n, blobData.m_cbk);
 	}
 };
@@ -328,9 +378,7 @@ struct BindDataTrait<blob>
 template<>
 struct BindDataTrait<blob64>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, blob64);
-	static BindFunc bindData;
-	static int bindBlob64Data(sqlite3_stmt* stmt, int t, blob64 blob64Data){
+	static int bindData(sqlite3_stmt* stmt, int t, const blob64& blob64Data){
 		return sqlite3_bind_blob64(stmt, t, blob64Data.m_v, blob64Data.m_n, blob64Data.m_cbk);
 	}
 };
@@ -339,9 +387,7 @@ struct BindDataTrait<blob64>
 template<>
 struct BindDataTrait<text>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, text);
-	static BindFunc bindData;
-	static int bindTextData(sqlite3_stmt* stmt, int t, text textData){
+	static int bindData(sqlite3_stmt* stmt, int t, const text& textData){
 		return sqlite3_bind_text(stmt, t, textData.m_v, textData.m_n, textData.m_cbk);
 	}
 };
@@ -350,9 +396,7 @@ struct BindDataTrait<text>
 template<>
 struct BindDataTrait<text16>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, text16);
-	static BindFunc bindData;
-	static int bindText16Data(sqlite3_stmt* stmt, int t, text16 textData){
+	static int bindData(sqlite3_stmt* stmt, int t, const text16& textData){
 		return sqlite3_bind_text16(stmt, t, textData.m_v, textData.m_n, textData.m_cbk);
 	}
 };
@@ -361,9 +405,7 @@ struct BindDataTrait<text16>
 template<>
 struct BindDataTrait<text64>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, text64);
-	static BindFunc bindData;
-	static int bindText64Data(sqlite3_stmt* stmt, int t, text64 text64Data){
+	static int bindData(sqlite3_stmt* stmt, int t, const text64& text64Data){
 		return sqlite3_bind_text64(stmt, t, text64Data.m_v, text64Data.m_n, text64Data.m_cbk, text64Data.m_encoding);
 	}
 };
@@ -372,9 +414,7 @@ struct BindDataTrait<text64>
 template<>
 struct BindDataTrait<zeroblob>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, zeroblob);
-	static BindFunc bindData;
-	static int bindZeroBlobData(sqlite3_stmt* stmt, int t, zeroblob zeroBlobData){
+	static int bindData(sqlite3_stmt* stmt, int t, const zeroblob& zeroBlobData){
 		return sqlite3_bind_zeroblob(stmt, t, zeroBlobData.m_n);
 	}
 };
@@ -383,9 +423,7 @@ struct BindDataTrait<zeroblob>
 template<>
 struct BindDataTrait<zeroblob64>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, zeroblob64);
-	static BindFunc bindData;
-	static int bindZeroBlob64Data(sqlite3_stmt* stmt, int t, zeroblob64 zeroBlob64Data){
+	static int bindData(sqlite3_stmt* stmt, int t, const zeroblob64& zeroBlob64Data){
 		return sqlite3_bind_zeroblob64(stmt, t, zeroBlob64Data.m_n);
 	}
 };
@@ -394,9 +432,7 @@ struct BindDataTrait<zeroblob64>
 template<>
 struct BindDataTrait<sqlite_ptr>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, sqlite_ptr);
-	static BindFunc bindData;
-	static int bindPtrData(sqlite3_stmt* stmt, int t, sqlite_ptr ptrData){
+	static int bindData(sqlite3_stmt* stmt, int t, const sqlite_ptr& ptrData){
 		return sqlite3_bind_pointer(stmt, t, ptrData.m_v, ptrData.m_n, ptrData.m_cbk);
 	}
 };
@@ -405,26 +441,288 @@ struct BindDataTrait<sqlite_ptr>
 template<>
 struct BindDataTrait<null_data>
 {
-	typedef int(*BindFunc)(sqlite3_stmt*, int, null_data);
-	static BindFunc bindData;
-	static int bindNullData(sqlite3_stmt* stmt, int t, null_data){
+	static int bindData(sqlite3_stmt* stmt, int t, null_data){
 		return sqlite3_bind_null(stmt, t);
 	}
 };
 
-//########################################################################
+/*
+ * The BindDataTrait of an argument of binding(): references and 
+ * cv-qualifiers are dropped, arrays (string literals) decay to pointers
+ * and char* is bound as const char*.
+ */
+template<typename T>
+using BindType=std::conditional_t<std::is_same_v<std::decay_t<T>, char*>, const char*, std::decay_t<T>>;
+
+//======================================================================
+
+/*
+ * ValueData<T>::getValueData and ResultDataTrait<T>::resultData are the
+ * ColumnData and BindDataTrait of SQL functions: arguments are read from
+ * a sqlite3_value* and the result is set on the sqlite3_context*. A 
+ * std::optional<T> argument is empty for NULL, and an empty optional 
+ * result is NULL.
+ */
 
 template<typename T>
-int binding(sqlite3_stmt* statement, int r, T t){
-	return BindDataTrait<T>::bindData(statement, r+1, std::forward<T>(t));
-}
+struct ValueData
+{};
+
+
+template<>
+struct ValueData<int>
+{
+	static int getValueData(sqlite3_value* value){
+		return sqlite3_value_int(value);
+	}
+};
+
+
+template<>
+struct ValueData<bool>
+{
+	static bool getValueData(sqlite3_value* value){
+		return sqlite3_value_int(value)!=0;
+	}
+};
+
+
+template<>
+struct ValueData<double>
+{
+	static double getValueData(sqlite3_value* value){
+		return sqlite3_value_double(value);
+	}
+};
+
+
+template<>
+struct ValueData<sqlite3_int64>
+{
+	static sqlite3_int64 getValueData(sqlite3_value* value){
+		return sqlite3_value_int64(value);
+	}
+};
+
+
+template<>
+struct ValueData<std::string_view>
+{
+	static std::string_view getValueData(sqlite3_value* value){
+		// sqlite3_value_text before sqlite3_value_bytes, see sqlite3_column_blob
+		const char* str=reinterpret_cast<const char*>(sqlite3_value_text(value));
+		if(!str){
+			return std::string_view();
+		}
+		return std::string_view(str, sqlite3_value_bytes(value));
+	}
+};
+
+
+template<>
+struct ValueData<std::string>
+{
+	static std::string getValueData(sqlite3_value* value){
+		return std::string(ValueData<std::string_view>::getValueData(value));
+	}
+};
+
+
+template<>
+struct ValueData<std::u16string_view>
+{
+	static std::u16string_view getValueData(sqlite3_value* value){
+		const char16_t* str=static_cast<const char16_t*>(sqlite3_value_text16(value));
+		if(!str){
+			return std::u16string_view();
+		}
+		return std::u16string_view(str, sqlite3_value_bytes16(value)/sizeof(char16_t));
+	}
+};
+
+
+template<>
+struct ValueData<const void*>
+{
+	static const void* getValueData(sqlite3_value* value){
+		return sqlite3_value_blob(value);
+	}
+};
+
+
+template<>
+struct ValueData<sqlite3_value*>
+{
+	static sqlite3_value* getValueData(sqlite3_value* value){
+		return value;
+	}
+};
+
+
+template<typename T>
+struct ValueData<std::optional<T>>
+{
+	static std::optional<T> getValueData(sqlite3_value* value){
+		if(sqlite3_value_type(value)==SQLITE_NULL){
+			return std::nullopt;
+		}
+		return ValueData<T>::getValueData(value);
+	}
+};
+
+//----------------------------------------------------------------------
+
+template<typename T>
+struct ResultDataTrait
+{};
+
+
+template<>
+struct ResultDataTrait<int>
+{
+	static void resultData(sqlite3_context* context, int value){
+		sqlite3_result_int(context, value);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<bool>
+{
+	static void resultData(sqlite3_context* context, bool value){
+		sqlite3_result_int(context, value ? 1 : 0);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<double>
+{
+	static void resultData(sqlite3_context* context, double value){
+		sqlite3_result_double(context, value);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<sqlite3_int64>
+{
+	static void resultData(sqlite3_context* context, sqlite3_int64 value){
+		sqlite3_result_int64(context, value);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<std::string_view>
+{
+	static void resultData(sqlite3_context* context, std::string_view str){
+		sqlite3_result_text64(context, str.data(), str.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<std::string>
+{
+	static void resultData(sqlite3_context* context, const std::string& str){
+		sqlite3_result_text64(context, str.data(), str.size(), SQLITE_TRANSIENT, SQLITE_UTF8);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<const char*>
+{
+	static void resultData(sqlite3_context* context, const char* cstr){
+		sqlite3_result_text(context, cstr, -1, SQLITE_TRANSIENT);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<std::u16string_view>
+{
+	static void resultData(sqlite3_context* context, std::u16string_view str){
+		sqlite3_result_text64(context, reinterpret_cast<const char*>(str.data()), str.size()*sizeof(char16_t), SQLITE_TRANSIENT, SQLITE_UTF16);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<sqlite3_value*>
+{
+	static void resultData(sqlite3_context* context, sqlite3_value* value){
+		sqlite3_result_value(context, value);
+	}
+};
 
-template<typename T, typename... Args>
-int binding(sqlite3_stmt* statement, int r, T t, Args ...args){
-	if(SQLITE_OK!=BindDataTrait<T>::bindData(statement, r+1, std::forward<T>(t))){
-		return SQLITE_ERROR;
+
+template<>
+struct ResultDataTrait<blob>
+{
+	static void resultData(sqlite3_context* context, const blob& blobData){
+		sqlite3_result_blob(context, blobData.m_v, blobData.m_n, blobData.m_cbk);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<text>
+{
+	static void resultData(sqlite3_context* context, const text& textData){
+		sqlite3_result_text(context, textData.m_v, textData.m_n, textData.m_cbk);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<zeroblob>
+{
+	static void resultData(sqlite3_context* context, const zeroblob& zeroBlobData){
+		sqlite3_result_zeroblob(context, zeroBlobData.m_n);
+	}
+};
+
+
+template<>
+struct ResultDataTrait<null_data>
+{
+	static void resultData(sqlite3_context* context, null_data){
+		sqlite3_result_null(context);
 	}
-	return binding(statement, r+1, std::forward<Args>(args)...);
+};
+
+
+template<typename T>
+struct ResultDataTrait<std::optional<T>>
+{
+	static void resultData(sqlite3_context* context, const std::optional<T>& value){
+		if(value){
+			ResultDataTrait<T>::resultData(context, *value);
+		}
+		else{
+			sqlite3_result_null(context);
+		}
+	}
+};
+
+//########################################################################
+
+/*
+ * Bind args to the parameters r+1, r+2... of statement, stopping at the 
+ * first one that fails. Return SQLITE_OK or the error code of that 
+ * parameter.
+ */
+inline int binding(sqlite3_stmt*, int){
+	return SQLITE_OK;
+}
+
+template<typename... Args>
+inline int binding(sqlite3_stmt* statement, int r, Args&&... args){
+	int rc=SQLITE_OK;
+	static_cast<void>((((rc=BindDataTrait<BindType<Args>>::bindData(statement, ++r, std::forward<Args>(args)))==SQLITE_OK) && ...));
+	return rc;
 }
 
 //######################################################################
@@ -445,8 +743,9 @@ struct DB_CONNECT<UTF8>
 	enum {is_valid=true, 
 		 is_utf8=true};
 	typedef const char* zSqlPtr;	
-	typedef UTF8(*SqliteColumnName)(sqlite3_stmt*, int N);
-	static SqliteColumnName sqliteColumnName;
+	static UTF8 sqliteColumnName(sqlite3_stmt* statement, int N){
+		return sqlite3_column_name(statement, N);
+	}
 	static int strLength(UTF8 str){
 		int n=std::strlen(str);
 		if(n==0){
@@ -463,9 +762,10 @@ struct DB_CONNECT<UTF16>
 	enum {is_valid=true,
 		is_utf8=false};
 	typedef const void* zSqlPtr;
-	typedef UTF16(*SqliteColumnName)(sqlite3_stmt*, int N);
-	static SqliteColumnName sqliteColumnName;
-	static int strLength(UTF8 str){
+	static UTF16 sqliteColumnName(sqlite3_stmt* statement, int N){
+		return sqlite3_column_name16(statement, N);
+	}
+	static int strLength(UTF16){
 		return -1;
 	}
 };
@@ -516,30 +816,30 @@ struct SQLITE3_PREPARE<SQLite_v::v2, B>
 template<>
 struct SQLITE3_PREPARE<SQLite_v::v2, UTF8>
 {
-	typedef int(*PrepareStatementV)( 
+	static int prepareStatement( 
 		sqlite3* db,            //* Database handle 
 		typename DB_CONNECT<UTF8>::zSqlPtr zSql,       //* SQL statement, UTF-8 encoded 
 		int nByte,              //* Maximum length of zSql in bytes. 
 		sqlite3_stmt **ppStmt,  //* OUT: Statement handle 
 		typename DB_CONNECT<UTF8>::zSqlPtr* pzTail     //* OUT: Pointer to unused portion of zSql 
-	);
-
-	static PrepareStatementV prepareStatement;
+	){
+		return sqlite3_prepare_v2(db, zSql, nByte, ppStmt, pzTail);
+	}
 };
 
 
 template<>
 struct SQLITE3_PREPARE<SQLite_v::v2, UTF16>
 {
-	typedef int(*PrepareStatementV)( 
+	static int prepareStatement( 
 		sqlite3* db,            //* Database handle 
 		typename DB_CONNECT<UTF16>::zSqlPtr zSql,       //* SQL statement, UTF-8 encoded 
 		int nByte,              //* Maximum length of zSql in bytes. 
 		sqlite3_stmt **ppStmt,  //* OUT: Statement handle 
 		typename DB_CONNECT<UTF16>::zSqlPtr* pzTail     //* OUT: Pointer to unused portion of zSql 
-	);
-
-	static PrepareStatementV prepareStatement;
+	){
+		return sqlite3_prepare16_v2(db, zSql, nByte, ppStmt, pzTail);
+	}
 };
 
 
@@ -550,31 +850,32 @@ struct SQLITE3_PREPARE<SQLite_v::v3, B>
 template<>
 struct SQLITE3_PREPARE<SQLite_v::v3, UTF8>
 {
-	typedef int(*PrepareStatementV)( 
+	static int prepareStatement( 
 		sqlite3* db,            //* Database handle 
 		typename DB_CONNECT<UTF8>::zSqlPtr zSql,       //* SQL statement, UTF-8 encoded 
 		int nByte,              //* Maximum length of zSql in bytes. 
 		unsigned int prepFlags, //* Zero or more SQLITE3_CONNECTION_ flags 
 		sqlite3_stmt **ppStmt,  //* OUT: Statement handle * /
 		typename DB_CONNECT<UTF8>::zSqlPtr* pzTail     //* OUT: Pointer to unused portion of zSql 
-	);
-
-	static PrepareStatementV prepareStatement;
+	){
+		return sqlite3_prepare_v3(db, zSql, nByte, prepFlags, ppStmt, pzTail);
+	}
 };
 
 
 template<>
 struct SQLITE3_PREPARE<SQLite_v::v3, UTF16>
 {
-	typedef int(*PrepareStatementV)( 
+	static int prepareStatement( 
 		sqlite3* db,            //* Database handle * /
 		typename DB_CONNECT<UTF16>::zSqlPtr zSql,       //* SQL statement, UTF-8 encoded * /
 		int nByte,              //* Maximum length of zSql in bytes. * /
 		unsigned int prepFlags, //* Zero or more SQLITE3_CONNECTION_ flags * /
 		sqlite3_stmt **ppStmt,  //* OUT: Statement handle * /
 		typename DB_CONNECT<UTF16>::zSqlPtr* pzTail     //* OUT: Pointer to unused portion of zSql * /
-	);
-	static PrepareStatementV prepareStatement;
+	){
+		return sqlite3_prepare16_v3(db, zSql, nByte, prepFlags, ppStmt, pzTail);
+	}
 };
 
 //======================================================================
@@ -589,49 +890,56 @@ struct QParams
 	:m_pzTail(nullptr),
 	m_nByte(nbytes),
 	m_prepFlags(0),
-	m_isUTF8(false)
+	m_isUTF8(false),
+	m_sqlHash(0)
 	{}
 
 	QParams(int nbytes, bool isUTF8)
 	:m_pzTail(nullptr),
 	m_nByte(nbytes),
 	m_prepFlags(0),
-	m_isUTF8(isUTF8)
+	m_isUTF8(isUTF8),
+	m_sqlHash(0)
 	{}
 
 	QParams(int nbytes, const char** tail)
 	:m_pzTail(tail),
 	m_nByte(nbytes),
 	m_prepFlags(0),
-	m_isUTF8(true)
+	m_isUTF8(true),
+	m_sqlHash(0)
 	{}
 
 	QParams(int nbytes, const void** tail)
 	:m_pzTail(reinterpret_cast<const char**>(tail)),
 	m_nByte(nbytes),
 	m_prepFlags(0),
-	m_isUTF8(false)
+	m_isUTF8(false),
+	m_sqlHash(0)
 	{}
 
 	QParams(int nbytes, bool isUTF8, unsigned int prepFlags)
 	: m_pzTail(nullptr),
 	m_nByte(nbytes),
 	m_prepFlags(prepFlags),
-	m_isUTF8(isUTF8)
+	m_isUTF8(isUTF8),
+	m_sqlHash(0)
 	{};
 
 	QParams(int nbytes, const char** tail, unsigned int prepFlags)
 	: m_pzTail(tail),
 	m_nByte(nbytes),
 	m_prepFlags(prepFlags),
-	m_isUTF8(true)
+	m_isUTF8(true),
+	m_sqlHash(0)
 	{};
 
 	QParams(int nbytes, const void** tail, unsigned int prepFlags)
 	: m_pzTail(reinterpret_cast<const char**>(tail)),
 	m_nByte(nbytes),
 	m_prepFlags(prepFlags),
-	m_isUTF8(false)
+	m_isUTF8(false),
+	m_sqlHash(0)
 	{};
 
 	virtual ~QParams(){}
@@ -648,6 +956,9 @@ struct QParams
 	const int m_nByte;
 	const unsigned int m_prepFlags;
 	bool m_isUTF8;
+	// StatementCache::sqlHash of the query when known beforehand 
+	// (sql_literal), 0 otherwise; m_nByte is then its exact size + 1
+	size_t m_sqlHash;
 };
 
 
@@ -699,6 +1010,24 @@ struct IS_QParam<unsigned int>
 };
 
 
+//======================================================================
+
+/*
+ * Quote an identifier (table or column name) to be used in a SQL 
+ * statement built at run time.
+ */
+inline std::string quoteIdentifier(const char* identifier){
+	std::string quoted("\"");
+	for(const char* c=identifier; *c; c++){
+		if(*c=='"'){
+			quoted+='"';
+		}
+		quoted+=*c;
+	}
+	quoted+='"';
+	return quoted;
+}
+
 //======================================================================
 
 
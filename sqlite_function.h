@@ -0,0 +1,252 @@
+/*********************************************************************
+* ScalarFunction class                                               *
+* AggregateFunction class                                            *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_FUNCTION_H
+#define SQLITE_FUNCTION_H
+
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <sqlite3.h>
+
+#include "sqlite_db_traits.h"
+
+//######################################################################
+
+/*
+ * Result type and argument types of a callable: a function, a function
+ * pointer, or a class with a single non template operator() (a lambda
+ * without auto parameters).
+ */
+template<typename F>
+struct FunctionSignature : FunctionSignature<decltype(&F::operator())>
+{};
+
+
+template<typename R, typename... Args>
+struct FunctionSignature<R(*)(Args...)>
+{
+	typedef R result;
+	typedef std::tuple<Args...> arguments;
+};
+
+
+template<typename R, typename... Args>
+struct FunctionSignature<R(*)(Args...) noexcept> : FunctionSignature<R(*)(Args...)>
+{};
+
+
+template<typename C, typename R, typename... Args>
+struct FunctionSignature<R(C::*)(Args...)> : FunctionSignature<R(*)(Args...)>
+{};
+
+
+template<typename C, typename R, typename... Args>
+struct FunctionSignature<R(C::*)(Args...) const> : FunctionSignature<R(*)(Args...)>
+{};
+
+
+template<typename C, typename R, typename... Args>
+struct FunctionSignature<R(C::*)(Args...) noexcept> : FunctionSignature<R(*)(Args...)>
+{};
+
+
+template<typename C, typename R, typename... Args>
+struct FunctionSignature<R(C::*)(Args...) const noexcept> : FunctionSignature<R(*)(Args...)>
+{};
+
+//----------------------------------------------------------------------
+
+/*
+ * Text encoding and flags of a function registered by SQLiteDB. Both
+ * flags are opt-in: SQLITE_DETERMINISTIC lets the function be used in
+ * indexes on expressions, CHECK constraints and generated columns, and
+ * SQLITE_INNOCUOUS (no side effects, no information leak) lets the
+ * schema use it as well with trusted_schema=OFF.
+ */
+inline int sqlFunctionFlags(bool deterministic, bool innocuous){
+	return SQLITE_UTF8|(deterministic ? SQLITE_DETERMINISTIC : 0)|(innocuous ? SQLITE_INNOCUOUS : 0);
+}
+
+/*
+ * Report the exception being handled as the error of the SQL function.
+ */
+inline void sqlFunctionError(sqlite3_context* context){
+	try{
+		throw;
+	}
+	catch(const std::bad_alloc&){
+		sqlite3_result_error_nomem(context);
+	}
+	catch(const std::exception& e){
+		sqlite3_result_error(context, e.what(), -1);
+	}
+	catch(const char* msg){
+		sqlite3_result_error(context, msg, -1);
+	}
+	catch(...){
+		sqlite3_result_error(context, "Exception in SQL function.", -1);
+	}
+}
+
+/*
+ * Call function with prefix... followed by argv converted by ValueData to
+ * the types of Arguments from position Skip on, and set its result with
+ * ResultDataTrait (NULL if it returns void).
+ */
+template<typename Arguments, size_t Skip, typename F, size_t... I, typename... Prefix>
+inline void callSqlFunction(sqlite3_context* context, F& function, sqlite3_value** argv, std::index_sequence<I...>, Prefix&... prefix){
+	typedef typename FunctionSignature<F>::result Result;
+	if constexpr(std::is_void_v<Result>){
+		function(prefix..., ValueData<std::decay_t<std::tuple_element_t<I+Skip, Arguments>>>::getValueData(argv[I])...);
+		sqlite3_result_null(context);
+	}
+	else{
+		ResultDataTrait<BindType<Result>>::resultData(context, function(prefix..., ValueData<std::decay_t<std::tuple_element_t<I+Skip, Arguments>>>::getValueData(argv[I])...));
+	}
+}
+
+//######################################################################
+
+/**
+ * A callable registered as a scalar SQL function by
+ * SQLiteDB::registerFunction. It is allocated once, passed to SQLite as
+ * the user data of the function and deleted by SQLite with destroy.
+ */
+template<typename F>
+class ScalarFunction
+{
+	public:
+		typedef typename FunctionSignature<F>::arguments Arguments;
+		static constexpr int ARGUMENTS=static_cast<int>(std::tuple_size_v<Arguments>);
+
+		explicit ScalarFunction(F function)
+		:m_function(std::move(function))
+		{}
+
+		// xFunc
+		static void call(sqlite3_context* context, int, sqlite3_value** argv){
+			ScalarFunction* self=static_cast<ScalarFunction*>(sqlite3_user_data(context));
+			try{
+				callSqlFunction<Arguments, 0>(context, self->m_function, argv, std::make_index_sequence<ARGUMENTS>());
+			}
+			catch(...){
+				sqlFunctionError(context);
+			}
+		}
+
+		// xDestroy
+		static void destroy(void* function){
+			delete static_cast<ScalarFunction*>(function);
+		}
+
+	private:
+		F m_function;
+};
+
+//######################################################################
+
+/**
+ * An aggregate SQL function registered by SQLiteDB::registerAggregate:
+ * step(State&, args...) is called for every row of a group and
+ * finalize(State&) returns the result of the group.
+ *
+ * The State of each group lives in the memory of
+ * sqlite3_aggregate_context: it is constructed on the first step and
+ * destroyed after finalize, without any allocation of its own. A group
+ * without rows gets a value initialized State.
+ */
+template<typename State, typename Step, typename Final>
+class AggregateFunction
+{
+	public:
+		typedef typename FunctionSignature<Step>::arguments StepArguments;
+		static constexpr int ARGUMENTS=static_cast<int>(std::tuple_size_v<StepArguments>)-1;
+
+		static_assert(ARGUMENTS>=0, "step should take State& as first parameter");
+		// alignment of the memory of sqlite3_aggregate_context
+		static_assert(alignof(State)<=8, "State should not need an alignment larger than 8");
+
+		AggregateFunction(Step step, Final finalize)
+		:m_step(std::move(step)),
+		m_finalize(std::move(finalize))
+		{}
+
+		// xStep
+		static void step(sqlite3_context* context, int, sqlite3_value** argv){
+			AggregateFunction* self=static_cast<AggregateFunction*>(sqlite3_user_data(context));
+			Group* group=static_cast<Group*>(sqlite3_aggregate_context(context, sizeof(Group)));
+			if(!group){
+				sqlite3_result_error_nomem(context);
+				return;
+			}
+			try{
+				if(!group->constructed){
+					new (group->state) State();
+					group->constructed=true;
+				}
+				callSqlFunction<StepArguments, 1>(context, self->m_step, argv, std::make_index_sequence<ARGUMENTS>(), *group->get());
+			}
+			catch(...){
+				sqlFunctionError(context);
+			}
+		}
+
+		// xFinal, also called by SQLite after an error in step
+		static void finalize(sqlite3_context* context){
+			AggregateFunction* self=static_cast<AggregateFunction*>(sqlite3_user_data(context));
+			Group* group=static_cast<Group*>(sqlite3_aggregate_context(context, 0));
+			try{
+				if(group && group->constructed){
+					Destroy destroy{group->get()};
+					callSqlFunction<std::tuple<>, 0>(context, self->m_finalize, nullptr, std::index_sequence<>(), *destroy.state);
+				}
+				else{
+					State state{};
+					callSqlFunction<std::tuple<>, 0>(context, self->m_finalize, nullptr, std::index_sequence<>(), state);
+				}
+			}
+			catch(...){
+				sqlFunctionError(context);
+			}
+		}
+
+		// xDestroy
+		static void destroy(void* function){
+			delete static_cast<AggregateFunction*>(function);
+		}
+
+	private:
+		// the memory of sqlite3_aggregate_context, zeroed by SQLite
+		struct Group
+		{
+			bool constructed;
+			alignas(State) unsigned char state[sizeof(State)];
+
+			State* get(){
+				return std::launder(reinterpret_cast<State*>(state));
+			}
+		};
+
+		struct Destroy
+		{
+			State* state;
+
+			~Destroy(){
+				state->~State();
+			}
+		};
+
+		Step m_step;
+		Final m_finalize;
+};
+
+#endif
@@ -0,0 +1,278 @@
+/*********************************************************************
+* MappedFile class                                                   *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_MAPPED_FILE_H
+#define SQLITE_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sqlite3.h>
+
+#include "sqlite_db_traits.h"
+
+//######################################################################
+
+/**
+ * A file mapped in memory with mmap (POSIX).
+ *
+ * Opened read-only, MappedFile::asBlob binds its content straight from the
+ * mapping with SQLITE_STATIC, without copying it into a user space buffer
+ * first. Created with a size, the file is truncated to that size and
+ * mapped for writing, to be filled for example with sqlite3_blob_read.
+ *
+ * Example:
+ * MappedFile picture("tree.jpg");
+ * if(picture.isOpen()){
+ *     dbConnection.executeSecureQuery(0, "update COMPANY set Data=? where ID=?", picture.asBlob(), 5);
+ * }
+ *
+ * @note the mapping must outlive every statement the blob is bound to,
+ *     the statement cache clears the bindings when a statement is
+ *     released.
+ */
+
+class MappedFile
+{
+	public:
+		/**
+		 * Map an existing file for reading.
+		 */
+		explicit MappedFile(const char* filePath);
+
+		/**
+		 * Create (or truncate) a file of size bytes and map it for writing.
+		 */
+		MappedFile(const char* filePath, size_t size);
+
+		MappedFile(MappedFile&& other);
+
+		MappedFile(const MappedFile&)=delete;
+		MappedFile& operator=(const MappedFile&)=delete;
+
+		/**
+		 * Destructor, unmap and close the file.
+		 */
+		virtual ~MappedFile();
+
+		bool isOpen() const;
+
+		const void* data() const;
+
+		void* data();
+
+		size_t size() const;
+
+		/**
+		 * The content of the file as a blob64 with SQLITE_STATIC, ready
+		 * to be bound.
+		 */
+		blob64 asBlob() const;
+
+		/**
+		 * Flush the changes of a writable mapping to the file (msync).
+		 *
+		 * @return SQLITE_OK or SQLITE_IOERR.
+		 */
+		int sync();
+
+	private:
+		int m_fd;
+		void* m_data;
+		size_t m_size;
+
+		void map(int prot);
+};
+
+//----------------------------------------------------------------------
+
+inline MappedFile::MappedFile(const char* filePath)
+:m_fd(::open(filePath, O_RDONLY)),
+m_data(nullptr),
+m_size(0)
+{
+	struct stat fileStat;
+	if(m_fd>=0 && ::fstat(m_fd, &fileStat)==0){
+		m_size=static_cast<size_t>(fileStat.st_size);
+		map(PROT_READ);
+		if(m_data){
+			::madvise(m_data, m_size, MADV_SEQUENTIAL);
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline MappedFile::MappedFile(const char* filePath, size_t size)
+:m_fd(::open(filePath, O_RDWR|O_CREAT|O_TRUNC, 0644)),
+m_data(nullptr),
+m_size(size)
+{
+	if(m_fd>=0 && ::ftruncate(m_fd, static_cast<off_t>(size))==0){
+		map(PROT_READ|PROT_WRITE);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline MappedFile::MappedFile(MappedFile&& other)
+:m_fd(other.m_fd),
+m_data(other.m_data),
+m_size(other.m_size)
+{
+	other.m_fd=-1;
+	other.m_data=nullptr;
+	other.m_size=0;
+}
+
+//----------------------------------------------------------------------
+
+inline MappedFile::~MappedFile(){
+	if(m_data && m_size>0){
+		::munmap(m_data, m_size);
+	}
+	if(m_fd>=0){
+		::close(m_fd);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void MappedFile::map(int prot){
+	if(m_size==0){
+		// mmap does not map empty files, but an empty file is still valid
+		static char empty[1]={0};
+		m_data=empty;
+		return;
+	}
+	void* data=::mmap(nullptr, m_size, prot, MAP_SHARED, m_fd, 0);
+	m_data=(data==MAP_FAILED) ? nullptr : data;
+}
+
+//----------------------------------------------------------------------
+
+inline bool MappedFile::isOpen() const{
+	return m_data!=nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline const void* MappedFile::data() const{
+	return m_data;
+}
+
+//----------------------------------------------------------------------
+
+inline void* MappedFile::data(){
+	return m_data;
+}
+
+//----------------------------------------------------------------------
+
+inline size_t MappedFile::size() const{
+	return m_size;
+}
+
+//----------------------------------------------------------------------
+
+inline blob64 MappedFile::asBlob() const{
+	return blob64(m_data, m_size, SQLITE_STATIC);
+}
+
+//----------------------------------------------------------------------
+
+inline int MappedFile::sync(){
+	if(m_size==0){
+		return SQLITE_OK;
+	}
+	return ::msync(m_data, m_size, MS_SYNC)==0 ? SQLITE_OK : SQLITE_IOERR;
+}
+
+//######################################################################
+
+/*
+ * Write n bytes of data to the file descriptor fd, return false on error.
+ */
+inline bool writeAll(int fd, const void* data, size_t n){
+	const char* bytes=static_cast<const char*>(data);
+	while(n>0){
+		ssize_t written=::write(fd, bytes, n);
+		if(written<0){
+			if(errno==EINTR){
+				continue;
+			}
+			return false;
+		}
+		bytes+=written;
+		n-=static_cast<size_t>(written);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+/*
+ * Write n bytes of data to a new file (or truncate an existing one)
+ * with write(2) calls straight from data.
+ *
+ * Return SQLITE_OK, SQLITE_CANTOPEN or SQLITE_IOERR.
+ */
+inline int writeToFile(const char* filePath, const void* data, size_t n){
+	int fd=::open(filePath, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if(fd<0){
+		return SQLITE_CANTOPEN;
+	}
+	if(!writeAll(fd, data, n)){
+		::close(fd);
+		return SQLITE_IOERR;
+	}
+	return ::close(fd)==0 ? SQLITE_OK : SQLITE_IOERR;
+}
+
+//----------------------------------------------------------------------
+
+/*
+ * Replace filePath with n bytes of data atomically: they are written to
+ * a temporary file in the same directory, synced to disk and renamed
+ * over filePath, so readers see either the old or the new content.
+ *
+ * Return SQLITE_OK, SQLITE_CANTOPEN or SQLITE_IOERR.
+ */
+inline int replaceFile(const char* filePath, const void* data, size_t n){
+	std::string tmpPath=std::string(filePath)+".XXXXXX";
+	int fd=::mkstemp(&tmpPath[0]);
+	if(fd<0){
+		return SQLITE_CANTOPEN;
+	}
+	if(::fchmod(fd, 0644)!=0 || !writeAll(fd, data, n) || ::fsync(fd)!=0){
+		::close(fd);
+		::unlink(tmpPath.c_str());
+		return SQLITE_IOERR;
+	}
+	if(::close(fd)!=0 || ::rename(tmpPath.c_str(), filePath)!=0){
+		::unlink(tmpPath.c_str());
+		return SQLITE_IOERR;
+	}
+
+	// make the rename itself durable
+	std::string directory(filePath);
+	size_t slash=directory.find_last_of('/');
+	directory=(slash==std::string::npos) ? std::string(".") : directory.substr(0, slash>0 ? slash : 1);
+	int dirFd=::open(directory.c_str(), O_RDONLY);
+	if(dirFd>=0){
+		::fsync(dirFd);
+		::close(dirFd);
+	}
+	return SQLITE_OK;
+}
+
+#endif
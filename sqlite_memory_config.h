@@ -0,0 +1,986 @@
+/*********************************************************************
+* PoolAllocator class                                                *
+* PageArena class                                                    *
+* SQLiteMemory class                                                 *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_MEMORY_CONFIG_H
+#define SQLITE_MEMORY_CONFIG_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <unordered_map>
+#include <sqlite3.h>
+
+#include "sqlite_performance_profile.h"
+
+//######################################################################
+
+/**
+ * Process wide memory settings installed by SQLiteMemory::install.
+ */
+struct MemoryConfig
+{
+	// SQLITE_CONFIG_MALLOC backed by size class pools: one pool per power
+	// of two from 16 bytes to maxPooledSize, grown slabSize bytes at a
+	// time up to maxPoolBytes in total; larger allocations, or any once
+	// the limit is reached, go to malloc. false keeps the SQLite default.
+	bool pools=true;
+	size_t maxPooledSize=4096;
+	size_t slabSize=256*1024;
+	size_t maxPoolBytes=64*1024*1024;
+
+	// SQLITE_CONFIG_PCACHE2 backed by an arena of arenaPages page slots
+	// preallocated at install, for pages up to arenaPageSize bytes; pages
+	// that do not fit, or once the arena is full, are allocated with
+	// sqlite3_malloc. 0 keeps the SQLite default page cache.
+	size_t arenaPages=0;
+	int arenaPageSize=4096;
+
+	// SQLITE_CONFIG_LOOKASIDE, the default lookaside of new connections
+	// (PerformanceProfile::lookaside sets it per connection)
+	std::optional<PerformanceProfile::Lookaside> lookaside;
+
+	// SQLITE_CONFIG_MEMSTATUS: false removes the global mutex SQLite takes
+	// on every allocation to keep sqlite3_memory_used up to date
+	std::optional<bool> memStatus;
+};
+
+//######################################################################
+
+struct MemoryStats
+{
+	uint64_t poolHits;          // allocations served by a size class pool
+	uint64_t poolFallbacks;     // allocations passed to malloc
+	uint64_t bytesInUse;        // usable bytes handed to SQLite
+	uint64_t peakBytes;
+	uint64_t poolBytes;         // bytes reserved by the pools
+	uint64_t pageHits;          // pages taken from the arena
+	uint64_t pageFallbacks;     // pages allocated with sqlite3_malloc
+	uint64_t pagesInUse;
+	uint64_t peakPages;
+};
+
+//######################################################################
+
+/**
+ * Current and peak value of a quantity updated from several threads.
+ */
+class UsageCounter
+{
+	public:
+		void add(uint64_t n){
+			uint64_t value=m_current.fetch_add(n, std::memory_order_relaxed)+n;
+			uint64_t peak=m_peak.load(std::memory_order_relaxed);
+			while(value>peak && !m_peak.compare_exchange_weak(peak, value, std::memory_order_relaxed)){}
+		}
+
+		void sub(uint64_t n){
+			m_current.fetch_sub(n, std::memory_order_relaxed);
+		}
+
+		uint64_t current() const{
+			return m_current.load(std::memory_order_relaxed);
+		}
+
+		uint64_t peak() const{
+			return m_peak.load(std::memory_order_relaxed);
+		}
+
+		void resetPeak(){
+			m_peak.store(current(), std::memory_order_relaxed);
+		}
+
+	private:
+		std::atomic<uint64_t> m_current{0};
+		std::atomic<uint64_t> m_peak{0};
+};
+
+//######################################################################
+
+/**
+ * The SQLITE_CONFIG_MALLOC allocator of SQLiteMemory: blocks of up to
+ * maxPooledSize bytes come from per size class free lists carved out of
+ * slabs, larger ones from malloc. Every block is preceded by an 8 byte
+ * header with its size class (or its size, for malloc blocks), as the
+ * SQLite allocators do, so xSize does not need a lookup.
+ *
+ * Each thread keeps its own free lists, refilled from and flushed to the
+ * shared pools BATCH blocks at a time, so most allocations take no lock
+ * and no atomic operation. For the same reason bytesInUse counts the
+ * blocks cached by the threads as in use, and poolHits is updated once
+ * per batch.
+ *
+ * The slabs are kept while the library is initialized and released by
+ * sqlite3_shutdown if no block is left in use.
+ */
+class PoolAllocator
+{
+	public:
+		static PoolAllocator& instance();
+
+		static sqlite3_mem_methods methods();
+
+		void configure(const MemoryConfig& config);
+
+		void* allocate(int n);
+
+		void release(void* p);
+
+		void* reallocate(void* p, int n);
+
+		int size(void* p) const;
+
+		int roundup(int n) const;
+
+		void stats(MemoryStats& result) const;
+
+		void resetPeak();
+
+	private:
+		static constexpr int MAX_CLASSES=16;
+		static constexpr size_t HEADER=8;
+		static constexpr uint64_t LARGE=0xFF;
+		static constexpr int BATCH=32;
+
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct Pool
+		{
+			std::mutex mutex;
+			FreeBlock* freeList=nullptr;
+		};
+
+		struct ThreadCache
+		{
+			FreeBlock* lists[MAX_CLASSES]={};
+			int counts[MAX_CLASSES]={};
+			uint64_t hits=0;
+
+			// gives the blocks back to the pools when the thread ends
+			~ThreadCache();
+		};
+
+		Pool m_pools[MAX_CLASSES];
+		int m_classes=0;
+		size_t m_slabSize=0;
+		size_t m_maxPoolBytes=0;
+
+		std::mutex m_slabMutex;
+		void* m_slabs=nullptr;     // each slab starts with a pointer to the previous one
+		std::atomic<size_t> m_poolBytes{0};
+
+		std::atomic<uint64_t> m_hits{0};
+		std::atomic<uint64_t> m_fallbacks{0};
+		UsageCounter m_usage;
+
+		static size_t classSize(int sizeClass){
+			return size_t(16)<<sizeClass;
+		}
+
+		static int sizeClass(size_t n){
+			int c=0;
+			while(classSize(c)<n){
+				c++;
+			}
+			return c;
+		}
+
+		static ThreadCache& threadCache();
+
+		// carve a new slab into blocks of sizeClass, called with the pool locked
+		bool grow(int sizeClass, Pool& pool);
+
+		// move up to BATCH blocks from the pool to the thread cache
+		bool refill(int sizeClass, ThreadCache& cache);
+
+		// move the blocks of the thread cache beyond keep to the pool
+		void flush(int sizeClass, ThreadCache& cache, int keep);
+
+		void releaseSlabs();
+};
+
+//----------------------------------------------------------------------
+
+inline PoolAllocator& PoolAllocator::instance(){
+	static PoolAllocator allocator;
+	return allocator;
+}
+
+//----------------------------------------------------------------------
+
+inline PoolAllocator::ThreadCache& PoolAllocator::threadCache(){
+	thread_local ThreadCache cache;
+	return cache;
+}
+
+//----------------------------------------------------------------------
+
+inline PoolAllocator::ThreadCache::~ThreadCache(){
+	for(int c=0; c<MAX_CLASSES; c++){
+		instance().flush(c, *this, 0);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline sqlite3_mem_methods PoolAllocator::methods(){
+	sqlite3_mem_methods methods;
+	methods.xMalloc=[](int n){ return instance().allocate(n); };
+	methods.xFree=[](void* p){ instance().release(p); };
+	methods.xRealloc=[](void* p, int n){ return instance().reallocate(p, n); };
+	methods.xSize=[](void* p){ return instance().size(p); };
+	methods.xRoundup=[](int n){ return instance().roundup(n); };
+	methods.xInit=[](void*){ return SQLITE_OK; };
+	methods.xShutdown=[](void*){ instance().releaseSlabs(); };
+	methods.pAppData=nullptr;
+	return methods;
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::configure(const MemoryConfig& config){
+	releaseSlabs();
+	m_classes=0;
+	while(m_classes<MAX_CLASSES && classSize(m_classes)<=config.maxPooledSize){
+		m_classes++;
+	}
+	m_slabSize=config.slabSize;
+	m_maxPoolBytes=config.maxPoolBytes;
+}
+
+//----------------------------------------------------------------------
+
+inline bool PoolAllocator::grow(int sizeClass, Pool& pool){
+	const size_t stride=HEADER+classSize(sizeClass);
+	const size_t bytes=std::max(m_slabSize, 2*HEADER+stride);
+	if(m_poolBytes.fetch_add(bytes, std::memory_order_relaxed)+bytes>m_maxPoolBytes){
+		m_poolBytes.fetch_sub(bytes, std::memory_order_relaxed);
+		return false;
+	}
+	char* slab=static_cast<char*>(std::malloc(bytes));
+	if(!slab){
+		m_poolBytes.fetch_sub(bytes, std::memory_order_relaxed);
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_slabMutex);
+		*reinterpret_cast<void**>(slab)=m_slabs;
+		m_slabs=slab;
+	}
+	// blocks are pushed from the end so they are handed out in address order
+	for(size_t i=(bytes-2*HEADER)/stride; i>0; i--){
+		FreeBlock* block=reinterpret_cast<FreeBlock*>(slab+2*HEADER+(i-1)*stride+HEADER);
+		block->next=pool.freeList;
+		pool.freeList=block;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+inline bool PoolAllocator::refill(int sizeClass, ThreadCache& cache){
+	Pool& pool=m_pools[sizeClass];
+	int moved=0;
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		if(!pool.freeList && !grow(sizeClass, pool)){
+			return false;
+		}
+		while(pool.freeList && moved<BATCH){
+			FreeBlock* block=pool.freeList;
+			pool.freeList=block->next;
+			block->next=cache.lists[sizeClass];
+			cache.lists[sizeClass]=block;
+			moved++;
+		}
+	}
+	cache.counts[sizeClass]+=moved;
+	m_usage.add(moved*classSize(sizeClass));
+	m_hits.fetch_add(cache.hits, std::memory_order_relaxed);
+	cache.hits=0;
+	return true;
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::flush(int sizeClass, ThreadCache& cache, int keep){
+	int moved=cache.counts[sizeClass]-keep;
+	if(moved<=0){
+		return;
+	}
+	FreeBlock* first=cache.lists[sizeClass];
+	FreeBlock* last=first;
+	for(int i=1; i<moved; i++){
+		last=last->next;
+	}
+	cache.lists[sizeClass]=last->next;
+	cache.counts[sizeClass]=keep;
+	{
+		Pool& pool=m_pools[sizeClass];
+		std::lock_guard<std::mutex> lock(pool.mutex);
+		last->next=pool.freeList;
+		pool.freeList=first;
+	}
+	m_usage.sub(moved*classSize(sizeClass));
+	m_hits.fetch_add(cache.hits, std::memory_order_relaxed);
+	cache.hits=0;
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::releaseSlabs(){
+	ThreadCache& cache=threadCache();
+	for(int c=0; c<MAX_CLASSES; c++){
+		flush(c, cache, 0);
+	}
+	if(m_usage.current()!=0){
+		// SQLite still holds memory (a connection was not closed)
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_slabMutex);
+	while(m_slabs){
+		void* previous=*static_cast<void**>(m_slabs);
+		std::free(m_slabs);
+		m_slabs=previous;
+	}
+	for(Pool& pool : m_pools){
+		pool.freeList=nullptr;
+	}
+	m_poolBytes.store(0, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+inline void* PoolAllocator::allocate(int n){
+	if(n<=0){
+		return nullptr;
+	}
+	size_t bytes=static_cast<size_t>(n);
+	if(m_classes>0 && bytes<=classSize(m_classes-1)){
+		int c=sizeClass(bytes);
+		ThreadCache& cache=threadCache();
+		if(cache.lists[c] || refill(c, cache)){
+			FreeBlock* block=cache.lists[c];
+			cache.lists[c]=block->next;
+			cache.counts[c]--;
+			cache.hits++;
+			reinterpret_cast<uint64_t*>(block)[-1]=static_cast<uint64_t>(c);
+			return block;
+		}
+	}
+	bytes=(bytes+7)&~size_t(7);
+	uint64_t* block=static_cast<uint64_t*>(std::malloc(HEADER+bytes));
+	if(!block){
+		return nullptr;
+	}
+	block[0]=(static_cast<uint64_t>(bytes)<<8)|LARGE;
+	m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+	m_usage.add(bytes);
+	return block+1;
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::release(void* p){
+	if(!p){
+		return;
+	}
+	uint64_t header=static_cast<uint64_t*>(p)[-1];
+	if((header&0xFF)==LARGE){
+		m_usage.sub(header>>8);
+		std::free(static_cast<uint64_t*>(p)-1);
+		return;
+	}
+	int c=static_cast<int>(header);
+	ThreadCache& cache=threadCache();
+	FreeBlock* block=static_cast<FreeBlock*>(p);
+	block->next=cache.lists[c];
+	cache.lists[c]=block;
+	if(++cache.counts[c]>2*BATCH){
+		flush(c, cache, BATCH);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void* PoolAllocator::reallocate(void* p, int n){
+	int current=size(p);
+	if(n<=current && roundup(n)==current){
+		return p;
+	}
+	void* q=allocate(n);
+	if(q){
+		std::memcpy(q, p, std::min(current, n));
+		release(p);
+	}
+	return q;
+}
+
+//----------------------------------------------------------------------
+
+inline int PoolAllocator::size(void* p) const{
+	if(!p){
+		return 0;
+	}
+	uint64_t header=static_cast<uint64_t*>(p)[-1];
+	return static_cast<int>((header&0xFF)==LARGE ? header>>8 : classSize(static_cast<int>(header)));
+}
+
+//----------------------------------------------------------------------
+
+inline int PoolAllocator::roundup(int n) const{
+	if(m_classes>0 && static_cast<size_t>(n)<=classSize(m_classes-1)){
+		return static_cast<int>(classSize(sizeClass(n)));
+	}
+	return (n+7)&~7;
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::stats(MemoryStats& result) const{
+	result.poolHits=m_hits.load(std::memory_order_relaxed);
+	result.poolFallbacks=m_fallbacks.load(std::memory_order_relaxed);
+	result.bytesInUse=m_usage.current();
+	result.peakBytes=m_usage.peak();
+	result.poolBytes=m_poolBytes.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------
+
+inline void PoolAllocator::resetPeak(){
+	m_usage.resetPeak();
+}
+
+//######################################################################
+
+/**
+ * The SQLITE_CONFIG_PCACHE2 page cache of SQLiteMemory. Page slots come
+ * from an arena allocated once by configure and shared by all the
+ * caches; every cache keeps its pages in a hash map by page number and
+ * its unpinned pages in an LRU list, recycled once the cache reaches its
+ * cache_size.
+ *
+ * Each cache belongs to one pager and SQLite serializes the calls for
+ * it; only the arena free list is shared between threads.
+ */
+class PageArena
+{
+	public:
+		static PageArena& instance();
+
+		static sqlite3_pcache_methods2 methods();
+
+		/**
+		 * Allocate pages slots for pages of up to pageSize bytes.
+		 *
+		 * @return SQLITE_OK, SQLITE_MISUSE if pages of the current arena
+		 *     are still in use or SQLITE_NOMEM if the arena cannot be
+		 *     allocated.
+		 */
+		int configure(size_t pages, int pageSize);
+
+		void stats(MemoryStats& result) const;
+
+		void resetPeak();
+
+	private:
+		// room for the page header of the pager and the b-tree, szExtra
+		static constexpr size_t MAX_EXTRA=512;
+
+		struct Page
+		{
+			sqlite3_pcache_page base;
+			unsigned key;
+			Page* prev;   // LRU links, nullptr while pinned
+			Page* next;
+			bool inArena;
+		};
+
+		class Cache
+		{
+			public:
+				Cache(PageArena* arena, int pageSize, int extraSize, bool purgeable);
+
+				~Cache();
+
+				sqlite3_pcache_page* fetch(unsigned key, int createFlag);
+
+				void unpin(Page* page, bool discard);
+
+				void rekey(Page* page, unsigned oldKey, unsigned newKey);
+
+				void truncate(unsigned limit);
+
+				void shrink();
+
+				void setCacheSize(int pages);
+
+				int pageCount() const;
+
+			private:
+				PageArena* m_arena;
+				int m_pageSize;
+				int m_extraSize;
+				bool m_purgeable;
+				size_t m_maxPages;
+				std::unordered_map<unsigned, Page*> m_pages;
+				Page m_lru;    // sentinel, m_lru.next is the least recently used
+
+				void unlink(Page* page);
+
+				void discard(Page* page);
+
+				void trim();
+		};
+
+		char* m_arena=nullptr;
+		size_t m_slots=0;
+		size_t m_slotSize=0;
+		std::mutex m_mutex;
+		Page* m_freeSlots=nullptr;
+
+		std::atomic<uint64_t> m_hits{0};
+		std::atomic<uint64_t> m_fallbacks{0};
+		UsageCounter m_pages;
+
+		static size_t headerSize(){
+			return (sizeof(Page)+15)&~size_t(15);
+		}
+
+		Page* allocate(int pageSize, int extraSize);
+
+		void release(Page* page);
+};
+
+//----------------------------------------------------------------------
+
+inline PageArena& PageArena::instance(){
+	static PageArena arena;
+	return arena;
+}
+
+//----------------------------------------------------------------------
+
+inline sqlite3_pcache_methods2 PageArena::methods(){
+	sqlite3_pcache_methods2 methods;
+	methods.iVersion=1;
+	methods.pArg=&instance();
+	methods.xInit=[](void*){ return SQLITE_OK; };
+	methods.xShutdown=[](void*){};
+	methods.xCreate=[](int szPage, int szExtra, int bPurgeable){
+		return reinterpret_cast<sqlite3_pcache*>(new (std::nothrow) Cache(&instance(), szPage, szExtra, bPurgeable!=0));
+	};
+	methods.xCachesize=[](sqlite3_pcache* cache, int nCachesize){
+		reinterpret_cast<Cache*>(cache)->setCacheSize(nCachesize);
+	};
+	methods.xPagecount=[](sqlite3_pcache* cache){
+		return reinterpret_cast<Cache*>(cache)->pageCount();
+	};
+	methods.xFetch=[](sqlite3_pcache* cache, unsigned key, int createFlag){
+		return reinterpret_cast<Cache*>(cache)->fetch(key, createFlag);
+	};
+	methods.xUnpin=[](sqlite3_pcache* cache, sqlite3_pcache_page* page, int discard){
+		reinterpret_cast<Cache*>(cache)->unpin(reinterpret_cast<Page*>(page), discard!=0);
+	};
+	methods.xRekey=[](sqlite3_pcache* cache, sqlite3_pcache_page* page, unsigned oldKey, unsigned newKey){
+		reinterpret_cast<Cache*>(cache)->rekey(reinterpret_cast<Page*>(page), oldKey, newKey);
+	};
+	methods.xTruncate=[](sqlite3_pcache* cache, unsigned iLimit){
+		reinterpret_cast<Cache*>(cache)->truncate(iLimit);
+	};
+	methods.xDestroy=[](sqlite3_pcache* cache){
+		delete reinterpret_cast<Cache*>(cache);
+	};
+	methods.xShrink=[](sqlite3_pcache* cache){
+		reinterpret_cast<Cache*>(cache)->shrink();
+	};
+	return methods;
+}
+
+//----------------------------------------------------------------------
+
+inline int PageArena::configure(size_t pages, int pageSize){
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_pages.current()!=0){
+		// pages of the current arena are still in use
+		return SQLITE_MISUSE;
+	}
+	std::free(m_arena);
+	m_arena=nullptr;
+	m_freeSlots=nullptr;
+	m_slots=0;
+	m_slotSize=(headerSize()+static_cast<size_t>(pageSize)+MAX_EXTRA+15)&~size_t(15);
+	if(pages==0){
+		return SQLITE_OK;
+	}
+	if(pages>SIZE_MAX/m_slotSize){
+		return SQLITE_NOMEM;
+	}
+	m_arena=static_cast<char*>(std::malloc(pages*m_slotSize));
+	if(!m_arena){
+		return SQLITE_NOMEM;
+	}
+	m_slots=pages;
+	for(size_t i=pages; i>0; i--){
+		Page* page=reinterpret_cast<Page*>(m_arena+(i-1)*m_slotSize);
+		page->next=m_freeSlots;
+		m_freeSlots=page;
+	}
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+inline PageArena::Page* PageArena::allocate(int pageSize, int extraSize){
+	size_t bytes=headerSize()+static_cast<size_t>(pageSize)+static_cast<size_t>(extraSize);
+	Page* page=nullptr;
+	if(bytes<=m_slotSize){
+		std::lock_guard<std::mutex> lock(m_mutex);
+		page=m_freeSlots;
+		if(page){
+			m_freeSlots=page->next;
+		}
+	}
+	if(page){
+		page->inArena=true;
+		m_hits.fetch_add(1, std::memory_order_relaxed);
+	}
+	else{
+		page=static_cast<Page*>(sqlite3_malloc64(bytes));
+		if(!page){
+			return nullptr;
+		}
+		page->inArena=false;
+		m_fallbacks.fetch_add(1, std::memory_order_relaxed);
+	}
+	char* memory=reinterpret_cast<char*>(page);
+	page->base.pBuf=memory+headerSize();
+	page->base.pExtra=memory+headerSize()+pageSize;
+	page->prev=nullptr;
+	page->next=nullptr;
+	m_pages.add(1);
+	return page;
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::release(Page* page){
+	m_pages.sub(1);
+	if(!page->inArena){
+		sqlite3_free(page);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	page->next=m_freeSlots;
+	m_freeSlots=page;
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::stats(MemoryStats& result) const{
+	result.pageHits=m_hits.load(std::memory_order_relaxed);
+	result.pageFallbacks=m_fallbacks.load(std::memory_order_relaxed);
+	result.pagesInUse=m_pages.current();
+	result.peakPages=m_pages.peak();
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::resetPeak(){
+	m_pages.resetPeak();
+}
+
+//----------------------------------------------------------------------
+
+inline PageArena::Cache::Cache(PageArena* arena, int pageSize, int extraSize, bool purgeable)
+:m_arena(arena),
+m_pageSize(pageSize),
+m_extraSize(extraSize),
+m_purgeable(purgeable),
+m_maxPages(0)
+{
+	m_lru.prev=&m_lru;
+	m_lru.next=&m_lru;
+}
+
+//----------------------------------------------------------------------
+
+inline PageArena::Cache::~Cache(){
+	for(const std::pair<const unsigned, Page*>& entry : m_pages){
+		m_arena->release(entry.second);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::unlink(Page* page){
+	if(page->prev){
+		page->prev->next=page->next;
+		page->next->prev=page->prev;
+		page->prev=nullptr;
+		page->next=nullptr;
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::discard(Page* page){
+	unlink(page);
+	m_pages.erase(page->key);
+	m_arena->release(page);
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::trim(){
+	while(m_purgeable && m_pages.size()>m_maxPages && m_lru.next!=&m_lru){
+		discard(m_lru.next);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline sqlite3_pcache_page* PageArena::Cache::fetch(unsigned key, int createFlag){
+	std::unordered_map<unsigned, Page*>::iterator it=m_pages.find(key);
+	if(it!=m_pages.end()){
+		unlink(it->second);
+		return &it->second->base;
+	}
+	if(createFlag==0){
+		return nullptr;
+	}
+
+	Page* page=nullptr;
+	if(m_purgeable && m_pages.size()>=m_maxPages){
+		if(m_lru.next!=&m_lru){
+			page=m_lru.next;
+			unlink(page);
+			m_pages.erase(page->key);
+		}
+		else if(createFlag==1){
+			// every page is pinned, let the pager spill some first
+			return nullptr;
+		}
+	}
+	if(!page){
+		page=m_arena->allocate(m_pageSize, m_extraSize);
+		if(!page){
+			return nullptr;
+		}
+	}
+	page->key=key;
+	std::memset(page->base.pExtra, 0, m_extraSize);
+	try{
+		m_pages.emplace(key, page);
+	}
+	catch(const std::bad_alloc&){
+		m_arena->release(page);
+		return nullptr;
+	}
+	return &page->base;
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::unpin(Page* page, bool discardPage){
+	if(discardPage || (m_purgeable && m_pages.size()>m_maxPages)){
+		discard(page);
+		return;
+	}
+	page->prev=m_lru.prev;
+	page->next=&m_lru;
+	m_lru.prev->next=page;
+	m_lru.prev=page;
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::rekey(Page* page, unsigned oldKey, unsigned newKey){
+	std::unordered_map<unsigned, Page*>::iterator it=m_pages.find(newKey);
+	if(it!=m_pages.end()){
+		// never pinned, see sqlite3_pcache_methods2
+		discard(it->second);
+	}
+	m_pages.erase(oldKey);
+	page->key=newKey;
+	m_pages.emplace(newKey, page);
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::truncate(unsigned limit){
+	for(std::unordered_map<unsigned, Page*>::iterator it=m_pages.begin(); it!=m_pages.end();){
+		if(it->first>=limit){
+			Page* page=it->second;
+			unlink(page);
+			it=m_pages.erase(it);
+			m_arena->release(page);
+		}
+		else{
+			++it;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::shrink(){
+	while(m_lru.next!=&m_lru){
+		discard(m_lru.next);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void PageArena::Cache::setCacheSize(int pages){
+	m_maxPages=pages>0 ? static_cast<size_t>(pages) : 0;
+	trim();
+}
+
+//----------------------------------------------------------------------
+
+inline int PageArena::Cache::pageCount() const{
+	return static_cast<int>(m_pages.size());
+}
+
+//######################################################################
+
+/**
+ * Installs the SQLite allocator and page cache described by a
+ * MemoryConfig for the whole process.
+ *
+ * sqlite3_config only works while the library is not initialized, so
+ * install must be called before the first connection is opened, or
+ * after every connection has been closed and sqlite3_shutdown called:
+ *
+ * MemoryConfig config;
+ * config.arenaPages=16384;     // 64 MiB of 4 KiB pages
+ * config.memStatus=false;
+ * if(SQLiteMemory::install(config)!=SQLITE_OK){
+ *     ...
+ * }
+ * SQLiteDB dbConnection("database_test.db");
+ * ...
+ * MemoryStats stats=SQLiteMemory::stats();
+ *
+ * Installing a MemoryConfig with pools=false and arenaPages=0 restores
+ * the SQLite allocator and page cache.
+ *
+ * @see [Dynamic Memory Allocation In SQLite](https://www.sqlite.org/malloc.html)
+ */
+class SQLiteMemory
+{
+	public:
+		/**
+		 * @return SQLITE_OK, SQLITE_MISUSE if the library is initialized
+		 *     or pages of the arena are still in use, or SQLITE_NOMEM if
+		 *     the page arena cannot be allocated. Nothing is changed
+		 *     unless it returns SQLITE_OK.
+		 */
+		static int install(const MemoryConfig& config);
+
+		static MemoryStats stats();
+
+		/**
+		 * Start the peaks over from the current usage.
+		 */
+		static void resetPeaks();
+
+	private:
+		struct Defaults
+		{
+			sqlite3_mem_methods malloc;
+			sqlite3_pcache_methods2 pcache;
+			bool saved=false;
+		};
+
+		static Defaults& defaults();
+};
+
+//----------------------------------------------------------------------
+
+inline SQLiteMemory::Defaults& SQLiteMemory::defaults(){
+	static Defaults values;
+	return values;
+}
+
+//----------------------------------------------------------------------
+
+inline int SQLiteMemory::install(const MemoryConfig& config){
+	// SQLITE_MISUSE if the library is initialized, before anything is
+	// changed
+	sqlite3_mem_methods current;
+	int rc=sqlite3_config(SQLITE_CONFIG_GETMALLOC, &current);
+	if(rc!=SQLITE_OK){
+		return rc;
+	}
+	Defaults& values=defaults();
+	if(!values.saved){
+		rc=sqlite3_config(SQLITE_CONFIG_GETPCACHE2, &values.pcache);
+		if(rc!=SQLITE_OK){
+			return rc;
+		}
+		values.malloc=current;
+		values.saved=true;
+	}
+
+	// the arena first, the only step that can fail for lack of memory:
+	// the allocator is not switched to the pools if it does
+	if(config.arenaPages>0){
+		rc=PageArena::instance().configure(config.arenaPages, config.arenaPageSize);
+		if(rc!=SQLITE_OK){
+			return rc;
+		}
+	}
+
+	sqlite3_mem_methods mallocMethods=config.pools ? PoolAllocator::methods() : values.malloc;
+	rc=sqlite3_config(SQLITE_CONFIG_MALLOC, &mallocMethods);
+	if(rc!=SQLITE_OK){
+		return rc;
+	}
+	if(config.pools){
+		PoolAllocator::instance().configure(config);
+	}
+
+	sqlite3_pcache_methods2 pcacheMethods=config.arenaPages>0 ? PageArena::methods() : values.pcache;
+	rc=sqlite3_config(SQLITE_CONFIG_PCACHE2, &pcacheMethods);
+
+	if(rc==SQLITE_OK && config.lookaside){
+		rc=sqlite3_config(SQLITE_CONFIG_LOOKASIDE, config.lookaside->slotSize, config.lookaside->slots);
+	}
+	if(rc==SQLITE_OK && config.memStatus){
+		rc=sqlite3_config(SQLITE_CONFIG_MEMSTATUS, *config.memStatus ? 1 : 0);
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+inline MemoryStats SQLiteMemory::stats(){
+	MemoryStats result;
+	PoolAllocator::instance().stats(result);
+	PageArena::instance().stats(result);
+	return result;
+}
+
+//----------------------------------------------------------------------
+
+inline void SQLiteMemory::resetPeaks(){
+	PoolAllocator::instance().resetPeak();
+	PageArena::instance().resetPeak();
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*********************************************************************
+* PerformanceProfile struct                                          *
+* OpenOptions struct                                                 *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_PERFORMANCE_PROFILE_H
+#define SQLITE_PERFORMANCE_PROFILE_H
+
+#include <cstring>
+#include <optional>
+#include <string>
+#include <sqlite3.h>
+
+//######################################################################
+
+enum class JournalMode
+{
+	Delete,
+	Truncate,
+	Persist,
+	Memory,
+	WAL,
+	Off
+};
+
+// values of PRAGMA synchronous
+enum class Synchronous
+{
+	Off=0,
+	Normal=1,
+	Full=2,
+	Extra=3
+};
+
+// values of PRAGMA temp_store
+enum class TempStore
+{
+	Default=0,
+	File=1,
+	Memory=2
+};
+
+//######################################################################
+
+/**
+ * Connection settings applied when a SQLiteDB is opened with
+ * OpenOptions, or by SQLiteDB::applyProfile. A setting left empty keeps
+ * the SQLite default.
+ *
+ * page_size only takes effect on a database not created yet (or after
+ * VACUUM, not in WAL mode), and it is applied before journal_mode for
+ * that reason. Use SQLiteDB::verifyProfile to read back what the
+ * connection actually got.
+ *
+ * @see [PRAGMA Statements](https://www.sqlite.org/pragma.html)
+ */
+struct PerformanceProfile
+{
+	struct Lookaside
+	{
+		int slotSize;   // bytes per slot
+		int slots;      // number of slots
+	};
+
+	std::optional<JournalMode> journalMode;
+	std::optional<Synchronous> synchronous;
+	// pages if positive, KiB if negative, as PRAGMA cache_size
+	std::optional<int> cacheSize;
+	// bytes, capped by SQLITE_MAX_MMAP_SIZE
+	std::optional<sqlite3_int64> mmapSize;
+	std::optional<TempStore> tempStore;
+	// milliseconds
+	std::optional<int> busyTimeout;
+	std::optional<int> pageSize;
+	std::optional<Lookaside> lookaside;
+
+	/**
+	 * Many concurrent readers: WAL, a 64 MiB page cache and 256 MiB of
+	 * memory mapped I/O.
+	 */
+	static PerformanceProfile readHeavy();
+
+	/**
+	 * Frequent small write transactions: WAL with synchronous=NORMAL
+	 * (durable across application crashes, not power loss) and a long
+	 * busy timeout.
+	 */
+	static PerformanceProfile writeHeavy();
+
+	/**
+	 * Loading a large amount of data in a few transactions: in-memory
+	 * rollback journal, no fsync and a 256 MiB page cache.
+	 *
+	 * @note the database may be corrupted by a crash or power loss
+	 *     during the load; meant for a database that can be rebuilt.
+	 */
+	static PerformanceProfile bulkLoad();
+
+	/**
+	 * The PRAGMA statements for the settings of the profile, in the
+	 * order they are applied (busy timeout and lookaside are set through
+	 * the C API instead).
+	 */
+	std::string pragmas() const;
+
+	static const char* journalModeName(JournalMode mode);
+
+	/**
+	 * Inverse of journalModeName, case insensitive; false if name is not
+	 * a journal mode.
+	 */
+	static bool journalModeFromName(const char* name, JournalMode& mode);
+};
+
+//######################################################################
+
+/**
+ * Parameters to open a SQLiteDB: the flags and VFS for sqlite3_open_v2
+ * and the performance profile applied right after.
+ *
+ * Example:
+ * OpenOptions options;
+ * options.flags=SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE;
+ * options.profile=PerformanceProfile::readHeavy();
+ * options.profile.cacheSize=-16384;
+ * SQLiteDB dbConnection("my_database_file.db", options);
+ */
+struct OpenOptions
+{
+	int flags=SQLITE_OPEN_READWRITE;
+	const char* vfs=nullptr;
+	PerformanceProfile profile;
+};
+
+//----------------------------------------------------------------------
+
+inline PerformanceProfile PerformanceProfile::readHeavy(){
+	PerformanceProfile profile;
+	profile.journalMode=JournalMode::WAL;
+	profile.synchronous=Synchronous::Normal;
+	profile.cacheSize=-64*1024;
+	profile.mmapSize=256*1024*1024;
+	profile.tempStore=TempStore::Memory;
+	profile.busyTimeout=5000;
+	profile.lookaside=Lookaside{1200, 250};
+	return profile;
+}
+
+//----------------------------------------------------------------------
+
+inline PerformanceProfile PerformanceProfile::writeHeavy(){
+	PerformanceProfile profile;
+	profile.journalMode=JournalMode::WAL;
+	profile.synchronous=Synchronous::Normal;
+	profile.cacheSize=-32*1024;
+	profile.tempStore=TempStore::Memory;
+	profile.busyTimeout=10000;
+	profile.lookaside=Lookaside{1200, 250};
+	return profile;
+}
+
+//----------------------------------------------------------------------
+
+inline PerformanceProfile PerformanceProfile::bulkLoad(){
+	PerformanceProfile profile;
+	// MEMORY rather than OFF so ROLLBACK still works
+	profile.journalMode=JournalMode::Memory;
+	profile.synchronous=Synchronous::Off;
+	profile.cacheSize=-256*1024;
+	profile.tempStore=TempStore::Memory;
+	profile.busyTimeout=10000;
+	return profile;
+}
+
+//----------------------------------------------------------------------
+
+inline std::string PerformanceProfile::pragmas() const{
+	std::string sql;
+	if(pageSize){
+		sql+="PRAGMA page_size="+std::to_string(*pageSize)+";";
+	}
+	if(journalMode){
+		sql+=std::string("PRAGMA journal_mode=")+journalModeName(*journalMode)+";";
+	}
+	if(synchronous){
+		sql+="PRAGMA synchronous="+std::to_string(static_cast<int>(*synchronous))+";";
+	}
+	if(cacheSize){
+		sql+="PRAGMA cache_size="+std::to_string(*cacheSize)+";";
+	}
+	if(mmapSize){
+		sql+="PRAGMA mmap_size="+std::to_string(*mmapSize)+";";
+	}
+	if(tempStore){
+		sql+="PRAGMA temp_store="+std::to_string(static_cast<int>(*tempStore))+";";
+	}
+	return sql;
+}
+
+//----------------------------------------------------------------------
+
+inline const char* PerformanceProfile::journalModeName(JournalMode mode){
+	switch(mode){
+		case JournalMode::Delete:
+			return "delete";
+		case JournalMode::Truncate:
+			return "truncate";
+		case JournalMode::Persist:
+			return "persist";
+		case JournalMode::Memory:
+			return "memory";
+		case JournalMode::WAL:
+			return "wal";
+		case JournalMode::Off:
+			return "off";
+	}
+	return "";
+}
+
+//----------------------------------------------------------------------
+
+inline bool PerformanceProfile::journalModeFromName(const char* name, JournalMode& mode){
+	for(JournalMode m : {JournalMode::Delete, JournalMode::Truncate, JournalMode::Persist, JournalMode::Memory, JournalMode::WAL, JournalMode::Off}){
+		if(sqlite3_stricmp(name, journalModeName(m))==0){
+			mode=m;
+			return true;
+		}
+	}
+	return false;
+}
+
+#endif
@@ -12,9 +12,21 @@
 #include <cstring>
 #include <string>
 #include <sqlite3.h> 
-#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <string_view>
+#include <cstddef>
+#if __cplusplus>=202002L && __has_include(<span>)
+#include <span>
+#endif
 
 #include "sqlite_db_traits.h"
+#include "sqlite_column_index.h"
+#include "sqlite_statement_cache.h"
+#include "sqlite_mapped_file.h"
+#include "sqlite_column_batch.h"
 
 //######################################################################
 
@@ -30,6 +42,50 @@ class SqlRows
 	public:			
 		virtual ~SqlRows();
 
+		SqlRows(const SqlRows&)=delete;
+		SqlRows& operator=(const SqlRows&)=delete;
+
+		SqlRows(SqlRows&& other);
+
+		/**
+		 * Input iterator over the rows, advancing calls SqlRows::yield().
+		 * Dereferencing gives the SqlRows itself, positioned at the 
+		 * current row.
+		 */
+		class iterator
+		{
+			public:
+				typedef std::input_iterator_tag iterator_category;
+				typedef SqlRows value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef SqlRows* pointer;
+				typedef SqlRows& reference;
+
+				explicit iterator(SqlRows* rows);
+
+				SqlRows& operator*() const;
+				iterator& operator++();
+				bool operator==(const iterator& other) const;
+				bool operator!=(const iterator& other) const;
+
+			private:
+				SqlRows* m_rows;
+		};
+
+		/**
+		 * Step to the first row, so that
+		 * for(SqlRows& row : rows){...} 
+		 * is the same as while(rows.yield()){...}
+		 */
+		iterator begin();
+
+		iterator end();
+
+		/**
+		 * Number of columns in the result.
+		 */
+		int columnCount() const;
+
 		/**
 		 * Iterate through the rows in the result.
 		 * 
@@ -98,6 +154,50 @@ class SqlRows
 		 */
 		int as_type(const char* field);
 
+		/**
+		 * Text of a column as a view over the buffer owned by SQLite, 
+		 * pointer and length are fetched with a single column lookup 
+		 * and nothing is allocated.
+		 * 
+		 * @note the view is valid until the next call to SqlRows::yield() 
+		 *     or SqlRows::reset() (or the destruction of the SqlRows), and 
+		 *     as long as the same column is not read with as_text16 or 
+		 *     as_u16string_view, which may convert it in place.
+		 */
+		std::string_view as_string_view(const char* field);
+
+		/**
+		 * UTF-16 text of a column as a view over the buffer owned 
+		 * by SQLite.
+		 * 
+		 * @note same validity as SqlRows::as_string_view, reading the 
+		 *     column with as_text or as_string_view invalidates it.
+		 */
+		std::u16string_view as_u16string_view(const char* field);
+
+		/**
+		 * Write the content of a BLOB (or text) column to a file straight 
+		 * from the buffer owned by SQLite, with no intermediate copy.
+		 * 
+		 * @param field the name of the column in the result
+		 * @param filePath file to create or truncate
+		 * @return SQLITE_OK, SQLITE_CANTOPEN or SQLITE_IOERR.
+		 */
+		int exportBlob(const char* field, const char* filePath);
+
+#ifdef __cpp_lib_span
+		/**
+		 * Content of a BLOB column as a span over the buffer owned by 
+		 * SQLite (C++20).
+		 * 
+		 * @tparam T the element type, std::byte by default; trailing 
+		 *     bytes not filling a whole T are not part of the span.
+		 * @note same validity as SqlRows::as_string_view.
+		 */
+		template<typename T=std::byte>
+		std::span<const T> as_span(const char* field);
+#endif
+
 		/**
 		 * Access the value in the current result row of a specific column 
 		 * by the name of the column.
@@ -113,58 +213,235 @@ class SqlRows
 		template<typename T>
 		typename ColumnData<T>::returnType data_as(const char* field);
 
-		struct FieldName {
-			const char* field;
-			FieldName(const char* cstr)
-				:field(std::move(cstr))
-			{}
-		};
+		/**
+		 * Get a handle to the column with name field. The handle can be
+		 * resolved once, outside of the SqlRows::yield() loop, and then 
+		 * passed to the accessors below at the cost of an array index.
+		 * 
+		 * @param field the name of the column in the result
+		 * @throws const char* if there is no column with name field.
+		 */
+		ColumnRef column(const char* field);
+
+		/**
+		 * Overloads of the accessors above for a column handle 
+		 * obtained with SqlRows::column.
+		 */
+		int as_int(ColumnRef col);
+
+		double as_double(ColumnRef col);
+
+		const unsigned char* as_text(ColumnRef col);
+
+		const void* as_blob(ColumnRef col);
+
+		sqlite3_int64 as_int64(ColumnRef col);
+
+		const void* as_text16(ColumnRef col);
+
+		sqlite3_value* as_value(ColumnRef col);
+
+		int as_bytes(ColumnRef col);
+
+		int as_bytes16(ColumnRef col);
+
+		int as_type(ColumnRef col);
+
+		std::string_view as_string_view(ColumnRef col);
+
+		std::u16string_view as_u16string_view(ColumnRef col);
+
+		int exportBlob(ColumnRef col, const char* filePath);
+
+#ifdef __cpp_lib_span
+		template<typename T=std::byte>
+		std::span<const T> as_span(ColumnRef col);
+#endif
+
+		template<typename T>
+		typename ColumnData<T>::returnType data_as(ColumnRef col);
+
+		/**
+		 * Decode the current row positionally, in one pass: the first
+		 * column as Ts[0], the second as Ts[1]...
+		 * 
+		 * Example:
+		 * auto [id, name, salary]=rows.get<int, std::string_view, double>();
+		 * 
+		 * @tparam Ts a type with a ColumnData specialization per column.
+		 * @return std::tuple of ColumnData<Ts>::returnType...
+		 */
+		template<typename... Ts>
+		std::tuple<typename ColumnData<Ts>::returnType...> get();
+
+		/**
+		 * Fetch the next batchSize rows (or less at the end of the 
+		 * result) column by column into batch, replacing its content. 
+		 * Reusing the same batch from one call to the next saves the 
+		 * allocations.
+		 * 
+		 * Example:
+		 * ColumnBatch batch;
+		 * while(rows.fetchColumns(batch, 4096)>0){
+		 *     const std::vector<double>& salary=batch.column(2).reals;
+		 *     ...
+		 * }
+		 * 
+		 * @return the number of rows fetched, 0 when there are no rows 
+		 *     left (until SqlRows::reset() is called).
+		 * @see ColumnBatch
+		 */
+		size_t fetchColumns(ColumnBatch& batch, size_t batchSize);
+
+		/**
+		 * Fetch the next batchSize rows into a new ColumnBatch.
+		 */
+		ColumnBatch fetchColumns(size_t batchSize);
 
 	private:
-		std::map<FieldName, int> m_fieldNames;
+		ColumnIndex m_ownColumns;
+		const ColumnIndex* m_columns;
 		sqlite3_stmt* m_statement;
+		std::weak_ptr<StatementCache> m_cache;
+		StatementCache::Entry* m_cacheEntry;
+		bool m_done;   // the last step returned no row
 		 
-		SqlRows(sqlite3_stmt* statement);
+		SqlRows(sqlite3_stmt* statement, std::weak_ptr<StatementCache> cache=std::weak_ptr<StatementCache>(), StatementCache::Entry* cacheEntry=nullptr);
 		
 		int findKey(const char* field);
 
+		void loadColumns(bool rebuild);
+
+		template<typename... Ts, size_t... I>
+		std::tuple<typename ColumnData<Ts>::returnType...> getColumns(std::index_sequence<I...>);
+
 	friend SQLiteDB;
 };
 
+
 //----------------------------------------------------------------------
 
-inline bool operator<(const SqlRows::FieldName& fieldNameL, const SqlRows::FieldName& fieldNameR) {
-	return std::strcmp(fieldNameL.field, fieldNameR.field) < 0;
+inline SqlRows::SqlRows(sqlite3_stmt* statement, std::weak_ptr<StatementCache> cache, StatementCache::Entry* cacheEntry)
+:m_statement(statement),
+m_cache(std::move(cache)),
+m_cacheEntry(cacheEntry),
+m_done(false)
+{
+	loadColumns(false);
 }
 
 //----------------------------------------------------------------------
 
-SqlRows::SqlRows(sqlite3_stmt* statement)
-:m_statement(statement)					
+inline SqlRows::SqlRows(SqlRows&& other)
+:m_ownColumns(std::move(other.m_ownColumns)),
+m_columns(other.m_columns==&other.m_ownColumns ? &m_ownColumns : other.m_columns),
+m_statement(other.m_statement),
+m_cache(std::move(other.m_cache)),
+m_cacheEntry(other.m_cacheEntry),
+m_done(other.m_done)
 {
-	for (int i = 0; i < sqlite3_column_count(statement); i++) {
-		m_fieldNames[reinterpret_cast<const char*>(sqlite3_column_name(statement, i))] = i;
+	other.m_statement=nullptr;
+	other.m_cacheEntry=nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline void SqlRows::loadColumns(bool rebuild){
+	if(m_cacheEntry){
+		// the index is kept with the cached statement
+		if(rebuild || !m_cacheEntry->columns.built()){
+			m_cacheEntry->columns.build(m_statement);
+		}
+		m_columns=&m_cacheEntry->columns;
+		return;
 	}
+	m_ownColumns.build(m_statement);
+	m_columns=&m_ownColumns;
 }
 
 //----------------------------------------------------------------------
 
 inline SqlRows::~SqlRows(){
+	if(m_cacheEntry){
+		if(std::shared_ptr<StatementCache> cache=m_cache.lock()){
+			cache->release(m_statement, m_cacheEntry);
+			return;
+		}
+	}
 	sqlite3_finalize(m_statement);
 }
 
 //----------------------------------------------------------------------
 
-bool SqlRows::yield(){
-	if (SQLITE_ROW == sqlite3_step(m_statement)){
-		return true;
+inline bool SqlRows::yield(){
+	int rc=sqlite3_step(m_statement);
+	if(rc==SQLITE_SCHEMA && m_cacheEntry){
+		std::shared_ptr<StatementCache> cache=m_cache.lock();
+		if(cache && cache->reprepare(m_cacheEntry)==SQLITE_OK){
+			m_statement=m_cacheEntry->statement;
+			loadColumns(true);
+			rc=sqlite3_step(m_statement);
+		}
+	}
+	m_done=(SQLITE_ROW != rc);
+	return !m_done;
+}
+
+//----------------------------------------------------------------------
+
+inline SqlRows::iterator::iterator(SqlRows* rows)
+:m_rows(rows)
+{}
+
+//----------------------------------------------------------------------
+
+inline SqlRows& SqlRows::iterator::operator*() const{
+	return *m_rows;
+}
+
+//----------------------------------------------------------------------
+
+inline SqlRows::iterator& SqlRows::iterator::operator++(){
+	if(!m_rows->yield()){
+		m_rows=nullptr;
 	}
-	return false;
+	return *this;
+}
+
+//----------------------------------------------------------------------
+
+inline bool SqlRows::iterator::operator==(const iterator& other) const{
+	return m_rows==other.m_rows;
+}
+
+//----------------------------------------------------------------------
+
+inline bool SqlRows::iterator::operator!=(const iterator& other) const{
+	return m_rows!=other.m_rows;
+}
+
+//----------------------------------------------------------------------
+
+inline SqlRows::iterator SqlRows::begin(){
+	return ++iterator(this);
 }
 
 //----------------------------------------------------------------------
 
-int SqlRows::reset(){
+inline SqlRows::iterator SqlRows::end(){
+	return iterator(nullptr);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::columnCount() const{
+	return sqlite3_column_count(m_statement);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::reset(){
+	m_done=false;
 	return sqlite3_reset(m_statement);
 }
 
@@ -196,14 +473,21 @@ typename ColumnData<T>::returnType SqlRows::data_as(const char* field){
 //----------------------------------------------------------------------
 
 inline int SqlRows::findKey(const char* field){
-	if(m_fieldNames.find(field)!=m_fieldNames.end()){
-		return m_fieldNames[field];
+	int column=m_columns->find(field);
+	if(column>=0){
+		return column;
 	}
 	throw "Key not found.";
 }
 
 //----------------------------------------------------------------------
 
+inline ColumnRef SqlRows::column(const char* field){
+	return ColumnRef(findKey(field));
+}
+
+//----------------------------------------------------------------------
+
 inline const void* SqlRows::as_blob(const char* field){
 	return sqlite3_column_blob(m_statement, findKey(field));
 }
@@ -244,5 +528,256 @@ inline int SqlRows::as_type(const char* field){
 	return sqlite3_column_type(m_statement, findKey(field));
 }
 
+//----------------------------------------------------------------------
+
+inline int SqlRows::as_int(ColumnRef col){
+	return sqlite3_column_int(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline double SqlRows::as_double(ColumnRef col){
+	return sqlite3_column_double(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline const unsigned char* SqlRows::as_text(ColumnRef col){
+	return sqlite3_column_text(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline const void* SqlRows::as_blob(ColumnRef col){
+	return sqlite3_column_blob(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline sqlite3_int64 SqlRows::as_int64(ColumnRef col){
+	return sqlite3_column_int64(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline const void* SqlRows::as_text16(ColumnRef col){
+	return sqlite3_column_text16(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline sqlite3_value* SqlRows::as_value(ColumnRef col){
+	return sqlite3_column_value(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::as_bytes(ColumnRef col){
+	return sqlite3_column_bytes(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::as_bytes16(ColumnRef col){
+	return sqlite3_column_bytes16(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::as_type(ColumnRef col){
+	return sqlite3_column_type(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline std::string_view SqlRows::as_string_view(const char* field){
+	return ColumnData<std::string_view>::getColumnData(m_statement, findKey(field));
+}
+
+//----------------------------------------------------------------------
+
+inline std::string_view SqlRows::as_string_view(ColumnRef col){
+	return ColumnData<std::string_view>::getColumnData(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline std::u16string_view SqlRows::as_u16string_view(const char* field){
+	return ColumnData<std::u16string_view>::getColumnData(m_statement, findKey(field));
+}
+
+//----------------------------------------------------------------------
+
+inline std::u16string_view SqlRows::as_u16string_view(ColumnRef col){
+	return ColumnData<std::u16string_view>::getColumnData(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::exportBlob(ColumnRef col, const char* filePath){
+	// sqlite3_column_blob before sqlite3_column_bytes
+	const void* data=sqlite3_column_blob(m_statement, col.m_index);
+	return writeToFile(filePath, data, sqlite3_column_bytes(m_statement, col.m_index));
+}
+
+//----------------------------------------------------------------------
+
+inline int SqlRows::exportBlob(const char* field, const char* filePath){
+	return exportBlob(ColumnRef(findKey(field)), filePath);
+}
+
+#ifdef __cpp_lib_span
+//----------------------------------------------------------------------
+
+template<typename T>
+std::span<const T> SqlRows::as_span(ColumnRef col){
+	// sqlite3_column_blob before sqlite3_column_bytes
+	const T* data=static_cast<const T*>(sqlite3_column_blob(m_statement, col.m_index));
+	if(!data){
+		return std::span<const T>();
+	}
+	return std::span<const T>(data, sqlite3_column_bytes(m_statement, col.m_index)/sizeof(T));
+}
+
+//----------------------------------------------------------------------
+
+template<typename T>
+std::span<const T> SqlRows::as_span(const char* field){
+	return as_span<T>(ColumnRef(findKey(field)));
+}
+#endif
+
+//----------------------------------------------------------------------
+
+template<typename T>
+typename ColumnData<T>::returnType SqlRows::data_as(ColumnRef col){
+	return ColumnData<T>::getColumnData(m_statement, col.m_index);
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+std::tuple<typename ColumnData<Ts>::returnType...> SqlRows::get(){
+	return getColumns<Ts...>(std::index_sequence_for<Ts...>());
+}
+
+//----------------------------------------------------------------------
+
+inline size_t SqlRows::fetchColumns(ColumnBatch& batch, size_t batchSize){
+	// stepping again once the result is exhausted would restart it
+	if(batchSize==0 || m_done || !yield()){
+		batch.clear();
+		return 0;
+	}
+	batch.setColumns(m_statement);
+	batch.reserve(batchSize);
+	do{
+		batch.appendRow(m_statement);
+	}while(batch.rows()<batchSize && yield());
+	return batch.rows();
+}
+
+//----------------------------------------------------------------------
+
+inline ColumnBatch SqlRows::fetchColumns(size_t batchSize){
+	ColumnBatch batch;
+	fetchColumns(batch, batchSize);
+	return batch;
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts, size_t... I>
+std::tuple<typename ColumnData<Ts>::returnType...> SqlRows::getColumns(std::index_sequence<I...>){
+	// braced initialization: the columns are read in order
+	return std::tuple<typename ColumnData<Ts>::returnType...>{ColumnData<Ts>::getColumnData(m_statement, static_cast<int>(I))...};
+}
+
+//######################################################################
+
+/**
+ * Rows of a result decoded as std::tuple<ColumnData<Ts>::returnType...>,
+ * to be used in a range-for loop with structured bindings:
+ * 
+ * for(auto [id, name, salary] : dbConnection.query<int, std::string_view, double>("select ID, Name, Salary from COMPANY")){
+ *     ...
+ * }
+ * 
+ * @see SQLiteDB::query
+ */
+
+template<typename... Ts>
+class TypedRows
+{
+	public:
+		typedef std::tuple<typename ColumnData<Ts>::returnType...> value_type;
+
+		class iterator
+		{
+			public:
+				typedef std::input_iterator_tag iterator_category;
+				typedef typename TypedRows::value_type value_type;
+				typedef std::ptrdiff_t difference_type;
+				typedef const value_type* pointer;
+				typedef value_type reference;
+
+				explicit iterator(SqlRows* rows)
+				:m_rows(rows)
+				{}
+
+				value_type operator*() const{
+					return m_rows->get<Ts...>();
+				}
+
+				iterator& operator++(){
+					if(!m_rows->yield()){
+						m_rows=nullptr;
+					}
+					return *this;
+				}
+
+				bool operator==(const iterator& other) const{
+					return m_rows==other.m_rows;
+				}
+
+				bool operator!=(const iterator& other) const{
+					return m_rows!=other.m_rows;
+				}
+
+			private:
+				SqlRows* m_rows;
+		};
+
+		/**
+		 * @throws const char* if rows has a different number of columns
+		 *     than sizeof...(Ts).
+		 */
+		explicit TypedRows(SqlRows&& rows)
+		:m_rows(std::move(rows))
+		{
+			if(m_rows.columnCount()!=0 && m_rows.columnCount()!=static_cast<int>(sizeof...(Ts))){
+				throw "Column count mismatch.";
+			}
+		}
+
+		iterator begin(){
+			return ++iterator(&m_rows);
+		}
+
+		iterator end(){
+			return iterator(nullptr);
+		}
+
+		/**
+		 * The underlying SqlRows.
+		 */
+		SqlRows& rows(){
+			return m_rows;
+		}
+
+	private:
+		SqlRows m_rows;
+};
+
 
 #endif
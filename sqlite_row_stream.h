@@ -0,0 +1,231 @@
+/*********************************************************************
+* RowStream class                                                    *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_ROW_STREAM_H
+#define SQLITE_ROW_STREAM_H
+
+#if __cplusplus>=202002L && __has_include(<coroutine>) && __has_include(<ranges>)
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <utility>
+#endif
+
+#include "sqlite_result_rows.h"
+
+#if defined(__cpp_lib_coroutine) && defined(__cpp_lib_ranges)
+#define SQLITE_DB_ROW_STREAM 1
+
+//######################################################################
+
+/**
+ * Coroutine generator of typed rows (C++20), returned by SQLiteDB::stream.
+ *
+ * The statement is stepped lazily, one row each time the iterator is
+ * incremented, so a loop that breaks early, or a range adaptor like
+ * std::views::take, stops stepping. RowStream is a std::ranges::view
+ * and composes with the standard adaptors:
+ *
+ * for(auto [id, name] : dbConnection.stream<int, std::string_view>("select ID, Name from COMPANY")
+ *         | std::views::filter([](const auto& row){ return std::get<0>(row)%2==0; })
+ *         | std::views::take(10)){
+ *     ...
+ * }
+ *
+ * The statement goes back to the statement cache (or is finalized) as
+ * soon as the RowStream is destroyed, whether or not the rows were all
+ * consumed.
+ *
+ * @note a RowStream can be iterated once. Views like std::string_view
+ *     in a row are valid until the next row is stepped.
+ */
+
+template<typename... Ts>
+class RowStream : public std::ranges::view_base
+{
+	public:
+		typedef std::tuple<typename ColumnData<Ts>::returnType...> value_type;
+
+		struct promise_type
+		{
+			const value_type* m_row=nullptr;
+			std::exception_ptr m_exception;
+
+			RowStream get_return_object(){
+				return RowStream(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+
+			std::suspend_always initial_suspend() noexcept{
+				return {};
+			}
+
+			std::suspend_always final_suspend() noexcept{
+				return {};
+			}
+
+			// the row lives in the coroutine frame while it is suspended
+			std::suspend_always yield_value(const value_type& row) noexcept{
+				m_row=std::addressof(row);
+				return {};
+			}
+
+			void return_void(){}
+
+			void unhandled_exception(){
+				m_exception=std::current_exception();
+			}
+		};
+
+		class iterator
+		{
+			public:
+				typedef std::input_iterator_tag iterator_concept;
+				typedef std::input_iterator_tag iterator_category;
+				typedef typename RowStream::value_type value_type;
+				typedef std::ptrdiff_t difference_type;
+
+				iterator()=default;
+
+				const value_type& operator*() const{
+					return *m_handle.promise().m_row;
+				}
+
+				iterator& operator++(){
+					resume(m_handle);
+					return *this;
+				}
+
+				void operator++(int){
+					++*this;
+				}
+
+				friend bool operator==(const iterator& it, std::default_sentinel_t){
+					return !it.m_handle || it.m_handle.done();
+				}
+
+			private:
+				std::coroutine_handle<promise_type> m_handle;
+
+				explicit iterator(std::coroutine_handle<promise_type> handle)
+				:m_handle(handle)
+				{}
+
+			friend RowStream;
+		};
+
+		RowStream()=default;
+
+		RowStream(RowStream&& other) noexcept;
+
+		RowStream& operator=(RowStream&& other) noexcept;
+
+		RowStream(const RowStream&)=delete;
+		RowStream& operator=(const RowStream&)=delete;
+
+		/**
+		 * Destructor, destroy the coroutine and with it the SqlRows
+		 * holding the statement.
+		 */
+		~RowStream();
+
+		/**
+		 * Step the first row.
+		 */
+		iterator begin();
+
+		std::default_sentinel_t end() const;
+
+		/**
+		 * Generator over rows, the coroutine behind SQLiteDB::stream.
+		 */
+		static RowStream generate(TypedRows<Ts...> rows);
+
+	private:
+		std::coroutine_handle<promise_type> m_handle;
+
+		explicit RowStream(std::coroutine_handle<promise_type> handle);
+
+		static void resume(std::coroutine_handle<promise_type> handle);
+};
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+RowStream<Ts...>::RowStream(std::coroutine_handle<promise_type> handle)
+:m_handle(handle)
+{}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+RowStream<Ts...>::RowStream(RowStream&& other) noexcept
+:m_handle(std::exchange(other.m_handle, nullptr))
+{}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+RowStream<Ts...>& RowStream<Ts...>::operator=(RowStream&& other) noexcept{
+	if(this!=&other){
+		if(m_handle){
+			m_handle.destroy();
+		}
+		m_handle=std::exchange(other.m_handle, nullptr);
+	}
+	return *this;
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+RowStream<Ts...>::~RowStream(){
+	if(m_handle){
+		m_handle.destroy();
+	}
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+void RowStream<Ts...>::resume(std::coroutine_handle<promise_type> handle){
+	handle.resume();
+	if(handle.promise().m_exception){
+		std::rethrow_exception(std::exchange(handle.promise().m_exception, nullptr));
+	}
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+typename RowStream<Ts...>::iterator RowStream<Ts...>::begin(){
+	if(m_handle && !m_handle.done()){
+		resume(m_handle);
+	}
+	return iterator(m_handle);
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+std::default_sentinel_t RowStream<Ts...>::end() const{
+	return std::default_sentinel;
+}
+
+//----------------------------------------------------------------------
+
+template<typename... Ts>
+RowStream<Ts...> RowStream<Ts...>::generate(TypedRows<Ts...> rows){
+	for(SqlRows& row : rows.rows()){
+		co_yield row.template get<Ts...>();
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,226 @@
+/*********************************************************************
+* ScriptResult struct                                                *
+* ScriptCache class                                                  *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_SCRIPT_H
+#define SQLITE_SCRIPT_H
+
+#include <cstring>
+#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sqlite3.h>
+
+#include "sqlite_statement_cache.h"
+
+//######################################################################
+
+/**
+ * Outcome of one statement of a script run by SQLiteDB::executeScript.
+ */
+struct StatementResult
+{
+	size_t offset;              // byte offset of the statement in the script
+	int errorCode;              // SQLITE_OK or the error of the statement
+	sqlite3_int64 changes;      // rows changed, by triggers as well
+	std::string errorMessage;   // sqlite3_errmsg if errorCode is not SQLITE_OK
+};
+
+/**
+ * Outcome of SQLiteDB::executeScript: one StatementResult for each
+ * statement run, in the order of the script.
+ */
+struct ScriptResult
+{
+	std::vector<StatementResult> statements;
+	int errorCode;              // SQLITE_OK or the first error
+	sqlite3_int64 changes;      // rows changed by the whole script
+	bool rolledBack;            // the transaction of the script was rolled back
+	double seconds;             // wall time of the whole script
+
+	bool ok() const{
+		return errorCode==SQLITE_OK;
+	}
+};
+
+//######################################################################
+
+/**
+ * Bounded LRU cache of parsed scripts for a single connection, used by
+ * SQLiteDB::executeScript.
+ *
+ * A script is the list of the statements of a SQL text, prepared one at
+ * a time walking the pzTail pointer of sqlite3_prepare_v3. Statements are
+ * prepared lazily, right before they run, because a statement may refer
+ * to a table created by a previous one; a statement that fails to
+ * prepare is not kept, so the next run parses the text again from there.
+ * Later runs of the same text reuse the prepared statements; a change of
+ * schema between runs is handled by sqlite3_step, which prepares the
+ * statement again.
+ *
+ * Like StatementCache, a script is owned by the caller between acquire
+ * and release, so a script run from inside another one (a SQL function
+ * running executeScript) gets its own copy.
+ */
+class ScriptCache
+{
+	public:
+		static constexpr size_t CAPACITY=8;
+
+		struct Statement
+		{
+			sqlite3_stmt* statement;
+			size_t offset;
+		};
+
+		struct Script
+		{
+			std::string sql;
+			size_t hash;
+			std::vector<Statement> statements;
+			// offset of the text not prepared yet
+			size_t parsed;
+			bool complete;
+		};
+
+		typedef std::list<Script>::iterator Entry;
+
+		explicit ScriptCache(sqlite3* db, size_t capacity=CAPACITY);
+
+		~ScriptCache();
+
+		ScriptCache(const ScriptCache&)=delete;
+		ScriptCache& operator=(const ScriptCache&)=delete;
+
+		/**
+		 * Get the cached script for sql, or an empty one.
+		 */
+		Entry acquire(std::string_view sql);
+
+		/**
+		 * Give back a script obtained from ScriptCache::acquire, it
+		 * becomes the most recently used one.
+		 */
+		void release(Entry script);
+
+		/**
+		 * Prepare the statement of script at position i if it is not
+		 * prepared yet.
+		 *
+		 * @param[out] statement the statement, nullptr at the end of the
+		 *     script
+		 * @param[out] offset offset of the statement in the script
+		 * @return SQLITE_OK or the error code of sqlite3_prepare_v3
+		 */
+		int statement(Script& script, size_t i, sqlite3_stmt*& statement, size_t& offset);
+
+		/**
+		 * Finalize the statements of all the idle scripts.
+		 */
+		void clear();
+
+	private:
+		sqlite3* m_DB;
+		std::list<Script> m_idle;
+		std::list<Script> m_inUse;
+		size_t m_capacity;
+
+		static void finalize(Script& script);
+};
+
+//----------------------------------------------------------------------
+
+inline ScriptCache::ScriptCache(sqlite3* db, size_t capacity)
+:m_DB(db),
+m_capacity(capacity)
+{}
+
+//----------------------------------------------------------------------
+
+inline ScriptCache::~ScriptCache(){
+	clear();
+	for(Script& script : m_inUse){
+		finalize(script);
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void ScriptCache::finalize(Script& script){
+	for(const Statement& statement : script.statements){
+		sqlite3_finalize(statement.statement);
+	}
+	script.statements.clear();
+}
+
+//----------------------------------------------------------------------
+
+inline ScriptCache::Entry ScriptCache::acquire(std::string_view sql){
+	const size_t hash=StatementCache::sqlHash(sql);
+	for(Entry it=m_idle.begin(); it!=m_idle.end(); ++it){
+		if(it->hash==hash && it->sql==sql){
+			m_inUse.splice(m_inUse.begin(), m_idle, it);
+			return it;
+		}
+	}
+	m_inUse.push_front(Script{std::string(sql), hash, {}, 0, false});
+	return m_inUse.begin();
+}
+
+//----------------------------------------------------------------------
+
+inline void ScriptCache::release(Entry script){
+	m_idle.splice(m_idle.begin(), m_inUse, script);
+	while(m_idle.size()>m_capacity){
+		finalize(m_idle.back());
+		m_idle.pop_back();
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline int ScriptCache::statement(Script& script, size_t i, sqlite3_stmt*& statement, size_t& offset){
+	statement=nullptr;
+	while(i>=script.statements.size()){
+		if(script.complete){
+			return SQLITE_OK;
+		}
+		const char* begin=script.sql.c_str()+script.parsed;
+		const char* tail=nullptr;
+		sqlite3_stmt* prepared=nullptr;
+		int rc=sqlite3_prepare_v3(m_DB, begin, static_cast<int>(script.sql.size()-script.parsed), SQLITE_PREPARE_PERSISTENT, &prepared, &tail);
+		if(rc!=SQLITE_OK){
+			offset=script.parsed;
+			return rc;
+		}
+		// skip the whitespace before the statement
+		size_t start=script.parsed+std::strspn(begin, " \t\r\n");
+		script.parsed=static_cast<size_t>(tail-script.sql.c_str());
+		if(prepared){
+			script.statements.push_back(Statement{prepared, start});
+		}
+		else if(script.parsed>=script.sql.size()){
+			// only whitespace or comments left
+			script.complete=true;
+		}
+	}
+	statement=script.statements[i].statement;
+	offset=script.statements[i].offset;
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+inline void ScriptCache::clear(){
+	for(Script& script : m_idle){
+		finalize(script);
+	}
+	m_idle.clear();
+}
+
+#endif
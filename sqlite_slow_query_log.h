@@ -0,0 +1,226 @@
+/*********************************************************************
+* SlowQueryLog class                                                 *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_SLOW_QUERY_LOG_H
+#define SQLITE_SLOW_QUERY_LOG_H
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sqlite3.h>
+
+//######################################################################
+
+/**
+ * Log of the statements running longer than a threshold, written to a
+ * rotating file with their duration, their parameters (unless redacted)
+ * and their EXPLAIN QUERY PLAN tree.
+ *
+ * Slow executions are recorded from the SQLITE_TRACE_PROFILE event of
+ * the connection. The query plan cannot be asked for from inside the
+ * trace callback, so they are kept pending and written the next time
+ * the connection prepares a statement (or on SlowQueryLog::flush).
+ *
+ * Example entry:
+ * 2021-10-16 18:30:02 slow query: 182.000 ms, 299999 full scan steps
+ * sql: select count(*) from COMPANY where Name||Age=?
+ * parameters: select count(*) from COMPANY where Name||Age='n7'
+ * plan:
+ *   SCAN COMPANY
+ *
+ * @note the duration comes from SQLITE_TRACE_PROFILE, with the
+ *     resolution of the VFS clock (milliseconds).
+ * @see SQLiteDB::enableSlowQueryLog
+ */
+
+class SlowQueryLog
+{
+	public:
+		struct Options
+		{
+			std::string path;
+			std::chrono::microseconds threshold=std::chrono::milliseconds(100);
+			// the file is rotated to path.1, path.2... when it grows
+			// beyond maxFileSize, keeping maxFiles old files
+			size_t maxFileSize=10*1024*1024;
+			int maxFiles=5;
+			// log the SQL text only, not the values bound to it
+			bool redactParameters=true;
+		};
+
+		explicit SlowQueryLog(const Options& options);
+
+		/**
+		 * Returns true if the log file could be opened.
+		 */
+		bool isOpen() const;
+
+		/**
+		 * SQLITE_TRACE_PROFILE event: record statement if it ran for
+		 * longer than the threshold.
+		 */
+		void onProfile(sqlite3_stmt* statement, uint64_t nanoseconds);
+
+		bool hasPending() const;
+
+		/**
+		 * true while the pending entries are being written: the query
+		 * plans are statements of the connection as well.
+		 */
+		bool isFlushing() const;
+
+		/**
+		 * Write the pending entries, with the query plan obtained on db.
+		 */
+		void flush(sqlite3* db);
+
+	private:
+		struct Pending
+		{
+			std::time_t when;
+			double milliseconds;
+			int fullscanSteps;
+			std::string sql;
+			std::string parameters;
+		};
+
+		Options m_options;
+		std::ofstream m_file;
+		std::vector<Pending> m_pending;
+		bool m_flushing;
+
+		static std::string queryPlan(sqlite3* db, const std::string& sql);
+		void rotate();
+};
+
+//----------------------------------------------------------------------
+
+inline SlowQueryLog::SlowQueryLog(const Options& options)
+:m_options(options),
+m_file(options.path, std::ios::app),
+m_flushing(false)
+{}
+
+//----------------------------------------------------------------------
+
+inline bool SlowQueryLog::isOpen() const{
+	return m_file.is_open();
+}
+
+//----------------------------------------------------------------------
+
+inline void SlowQueryLog::onProfile(sqlite3_stmt* statement, uint64_t nanoseconds){
+	if(std::chrono::nanoseconds(nanoseconds)<m_options.threshold){
+		return;
+	}
+	Pending entry;
+	entry.when=std::time(nullptr);
+	entry.milliseconds=nanoseconds/1e6;
+	entry.fullscanSteps=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+	entry.sql=sqlite3_sql(statement);
+	if(!m_options.redactParameters && sqlite3_bind_parameter_count(statement)>0){
+		char* expanded=sqlite3_expanded_sql(statement);
+		if(expanded){
+			entry.parameters=expanded;
+			sqlite3_free(expanded);
+		}
+	}
+	m_pending.push_back(std::move(entry));
+}
+
+//----------------------------------------------------------------------
+
+inline bool SlowQueryLog::hasPending() const{
+	return !m_pending.empty();
+}
+
+//----------------------------------------------------------------------
+
+inline bool SlowQueryLog::isFlushing() const{
+	return m_flushing;
+}
+
+//----------------------------------------------------------------------
+
+inline std::string SlowQueryLog::queryPlan(sqlite3* db, const std::string& sql){
+	// rows of (id, parent, notused, detail), a child after its parent
+	std::string plan;
+	sqlite3_stmt* statement;
+	if(sqlite3_prepare_v2(db, ("EXPLAIN QUERY PLAN "+sql).c_str(), -1, &statement, nullptr)!=SQLITE_OK){
+		return "  (not available: "+std::string(sqlite3_errmsg(db))+")\n";
+	}
+	std::vector<std::pair<int, int>> depths;  // id, depth
+	while(sqlite3_step(statement)==SQLITE_ROW){
+		int id=sqlite3_column_int(statement, 0);
+		int parent=sqlite3_column_int(statement, 1);
+		int depth=0;
+		for(const std::pair<int, int>& node : depths){
+			if(node.first==parent){
+				depth=node.second+1;
+			}
+		}
+		depths.emplace_back(id, depth);
+		plan.append(2+2*depth, ' ');
+		plan+=reinterpret_cast<const char*>(sqlite3_column_text(statement, 3));
+		plan+='\n';
+	}
+	sqlite3_finalize(statement);
+	return plan;
+}
+
+//----------------------------------------------------------------------
+
+inline void SlowQueryLog::rotate(){
+	m_file.close();
+	for(int i=m_options.maxFiles-1; i>0; i--){
+		std::rename((m_options.path+"."+std::to_string(i)).c_str(), (m_options.path+"."+std::to_string(i+1)).c_str());
+	}
+	if(m_options.maxFiles>0){
+		std::rename(m_options.path.c_str(), (m_options.path+".1").c_str());
+	}
+	else{
+		std::remove(m_options.path.c_str());
+	}
+	m_file.open(m_options.path, std::ios::trunc);
+}
+
+//----------------------------------------------------------------------
+
+inline void SlowQueryLog::flush(sqlite3* db){
+	if(m_pending.empty() || !m_file.is_open()){
+		m_pending.clear();
+		return;
+	}
+	m_flushing=true;
+	std::vector<Pending> pending;
+	pending.swap(m_pending);
+	for(const Pending& entry : pending){
+		char when[32];
+		std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&entry.when));
+		char duration[32];
+		std::snprintf(duration, sizeof(duration), "%.3f", entry.milliseconds);
+
+		std::string text=std::string(when)+" slow query: "+duration+" ms, "+std::to_string(entry.fullscanSteps)+" full scan steps\n";
+		text+="sql: "+entry.sql+"\n";
+		if(!entry.parameters.empty()){
+			text+="parameters: "+entry.parameters+"\n";
+		}
+		text+="plan:\n"+queryPlan(db, entry.sql)+"\n";
+
+		if(static_cast<size_t>(m_file.tellp())+text.size()>m_options.maxFileSize && m_file.tellp()>0){
+			rotate();
+		}
+		m_file<<text;
+	}
+	m_file.flush();
+	m_flushing=false;
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*********************************************************************
+* sql_literal class                                                  *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_SQL_LITERAL_H
+#define SQLITE_SQL_LITERAL_H
+
+#include <cstddef>
+#include <string_view>
+
+#include "sqlite_statement_cache.h"
+
+//######################################################################
+
+/**
+ * Number of parameters of a SQL statement, as sqlite3_bind_parameter_count
+ * would report it: the largest parameter index, where '?' takes the next
+ * index, '?NNN' index NNN, and ':AAA', '@AAA', '$AAA' the next index the
+ * first time the name appears. String literals, quoted identifiers and
+ * comments are skipped.
+ */
+constexpr int sqlParameterCount(std::string_view sql){
+	auto isNameChar=[](char c){
+		return (c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9') || c=='_' || static_cast<unsigned char>(c)>=0x80;
+	};
+
+	// position after the parameter starting at i, i+1 if there is none
+	auto parameterEnd=[&](size_t i){
+		size_t end=i+1;
+		while(end<sql.size() && (sql[i]=='?' ? (sql[end]>='0' && sql[end]<='9') : isNameChar(sql[end]))){
+			end++;
+		}
+		return end;
+	};
+
+	// position of the next parameter from i, sql.size() if there is none
+	auto nextParameter=[&](size_t i){
+		while(i<sql.size()){
+			char c=sql[i];
+			if(c=='\'' || c=='"' || c=='`' || c=='['){
+				char close=(c=='[') ? ']' : c;
+				i++;
+				while(i<sql.size() && sql[i]!=close){
+					i++;
+				}
+				i++;
+			}
+			else if(c=='-' && i+1<sql.size() && sql[i+1]=='-'){
+				while(i<sql.size() && sql[i]!='\n'){
+					i++;
+				}
+			}
+			else if(c=='/' && i+1<sql.size() && sql[i+1]=='*'){
+				i+=2;
+				while(i+1<sql.size() && !(sql[i]=='*' && sql[i+1]=='/')){
+					i++;
+				}
+				i+=2;
+			}
+			else if(c=='?' || ((c==':' || c=='@' || c=='$') && parameterEnd(i)>i+1)){
+				return i;
+			}
+			else{
+				i++;
+			}
+		}
+		return sql.size();
+	};
+
+	int count=0;
+	for(size_t i=nextParameter(0); i<sql.size(); i=nextParameter(parameterEnd(i))){
+		std::string_view parameter=sql.substr(i, parameterEnd(i)-i);
+		if(parameter[0]=='?'){
+			if(parameter.size()==1){
+				count++;
+			}
+			else{
+				int index=0;
+				for(char digit : parameter.substr(1)){
+					index=10*index+(digit-'0');
+				}
+				count=index>count ? index : count;
+			}
+		}
+		else{
+			bool seen=false;
+			for(size_t j=nextParameter(0); j<i && !seen; j=nextParameter(parameterEnd(j))){
+				seen=sql.substr(j, parameterEnd(j)-j)==parameter;
+			}
+			if(!seen){
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+#if __cplusplus>=202002L && defined(__cpp_nontype_template_args) && __cpp_nontype_template_args>=201911L
+#define SQLITE_DB_SQL_LITERAL 1
+
+//######################################################################
+
+/**
+ * The characters of a string literal as a template parameter (C++20).
+ */
+template<size_t N>
+struct sql_text
+{
+	constexpr sql_text(const char (&sql)[N]){
+		for(size_t i=0; i<N; i++){
+			m_sql[i]=sql[i];
+		}
+	}
+
+	char m_sql[N];
+};
+
+//######################################################################
+
+/**
+ * A UTF-8 SQL query known at compile time, written "..."_sql (C++20).
+ *
+ * Its size, its number of parameters and the hash the statement cache
+ * uses for its key are computed by the compiler, so
+ * SQLiteDB::executeSecureQuery does not scan the text on each call,
+ * and a call with a number of arguments different from the number of
+ * parameters does not compile:
+ *
+ * dbConnection.executeSecureQueryNf("select Name from COMPANY where ID=? and Age>?"_sql, 3, 25);
+ *
+ * @see sqlParameterCount
+ */
+template<sql_text S>
+struct sql_literal
+{
+	static constexpr size_t size=sizeof(S.m_sql)-1;
+	static constexpr int parameters=sqlParameterCount(std::string_view(S.m_sql, size));
+	static constexpr size_t hash=StatementCache::sqlHash(std::string_view(S.m_sql, size));
+
+	static constexpr const char* c_str(){
+		return S.m_sql;
+	}
+
+	/**
+	 * The size to prepare the query with, as DB_CONNECT<UTF8>::strLength.
+	 */
+	static constexpr int nByte(){
+		return size==0 ? 0 : static_cast<int>(size)+1;
+	}
+};
+
+//----------------------------------------------------------------------
+
+template<sql_text S>
+constexpr sql_literal<S> operator""_sql(){
+	return sql_literal<S>();
+}
+
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+/*********************************************************************
+* StatementCache class                                               *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_STATEMENT_CACHE_H
+#define SQLITE_STATEMENT_CACHE_H
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <list>
+#include <type_traits>
+#include <unordered_map>
+#include <sqlite3.h>
+
+#include "sqlite_db_traits.h"
+#include "sqlite_column_index.h"
+
+//######################################################################
+
+/**
+ * Bounded LRU cache of prepared statements for a single connection.
+ *
+ * Statements are keyed by the bytes of the SQL text, its encoding and
+ * the prepFlags used to prepare it. A statement handed out by
+ * StatementCache::acquire is owned by the caller until it is given back
+ * through StatementCache::release, which resets it, clears its bindings
+ * and keeps it for the next query with the same key. When more than
+ * capacity() statements are idle the least recently used one is finalized.
+ * The column names index of a statement is kept with it, so a cached
+ * statement does not pay for building it again.
+ *
+ * A capacity of 0 disables the cache: every acquire prepares a new
+ * statement and every release finalizes it.
+ *
+ * @note queries prepared with a QParams holding a pzTail pointer are
+ *     never cached, as the caller expects the tail to be set.
+ */
+
+class StatementCache
+{
+	public:
+		struct Stats
+		{
+			unsigned long long hits;
+			unsigned long long misses;
+			unsigned long long evictions;
+			unsigned long long reprepares;
+			size_t size;
+			size_t capacity;
+		};
+
+		struct Entry
+		{
+			std::string sql;
+			size_t hash;
+			unsigned int prepFlags;
+			bool isUTF8;
+			sqlite3_stmt* statement;
+			ColumnIndex columns;
+			std::list<Entry>::iterator self;
+		};
+
+		StatementCache(sqlite3* db, size_t capacity);
+
+		~StatementCache();
+
+		StatementCache(const StatementCache&)=delete;
+		StatementCache& operator=(const StatementCache&)=delete;
+
+		/**
+		 * Get a prepared statement for query, either from the cache or
+		 * by preparing it.
+		 *
+		 * @param query a SQL query
+		 * @param[out] ppStmt the prepared statement
+		 * @param qParams prepFlags or QParams as for sqlite3Prepare
+		 * @param[out] entry handle to be passed back to
+		 *     StatementCache::release, nullptr if the statement is not cached
+		 * @return SQLITE_OK or the error code of sqlite3_prepare_*
+		 */
+		template<typename UTF, typename P>
+		int acquire(UTF query, sqlite3_stmt** ppStmt, P& qParams, Entry*& entry);
+
+		/**
+		 * Give back a statement obtained from StatementCache::acquire.
+		 *
+		 * @param statement the statement
+		 * @param entry the handle returned by StatementCache::acquire
+		 */
+		void release(sqlite3_stmt* statement, Entry* entry);
+
+		/**
+		 * Prepare again the SQL of entry after a SQLITE_SCHEMA error,
+		 * transferring the current bindings to the new statement.
+		 *
+		 * @return SQLITE_OK if entry->statement has been replaced.
+		 */
+		int reprepare(Entry* entry);
+
+		/**
+		 * Finalize all the idle statements.
+		 */
+		void clear();
+
+		/**
+		 * Set the maximum number of idle statements kept in the cache.
+		 */
+		void setCapacity(size_t capacity);
+
+		size_t capacity() const;
+
+		Stats stats() const;
+
+		/**
+		 * Hash of the bytes of a SQL text (FNV-1a), part of the key of a
+		 * cached statement. constexpr so a query known at compile time
+		 * (sql_literal) carries it, see QParams::m_sqlHash.
+		 */
+		static constexpr size_t sqlHash(std::string_view sql);
+
+	private:
+		sqlite3* m_DB;
+		std::list<Entry> m_idle;
+		std::list<Entry> m_inUse;
+		std::unordered_multimap<size_t, Entry*> m_index;
+		size_t m_capacity;
+		unsigned long long m_hits;
+		unsigned long long m_misses;
+		unsigned long long m_evictions;
+		unsigned long long m_reprepares;
+
+		static size_t sqlBytes(UTF8 query, int nByte);
+		static size_t sqlBytes(UTF16 query, int nByte);
+		static size_t keyHash(size_t sqlHash, unsigned int prepFlags, bool isUTF8);
+
+		void evict();
+		void unindex(Entry* entry);
+};
+
+//----------------------------------------------------------------------
+
+inline StatementCache::StatementCache(sqlite3* db, size_t capacity)
+:m_DB(db),
+m_capacity(capacity),
+m_hits(0),
+m_misses(0),
+m_evictions(0),
+m_reprepares(0)
+{}
+
+//----------------------------------------------------------------------
+
+inline StatementCache::~StatementCache(){
+	// statements in use are finalized by their SqlRows
+	clear();
+}
+
+//----------------------------------------------------------------------
+
+inline size_t StatementCache::sqlBytes(UTF8 query, int nByte){
+	if(nByte<0){
+		return std::strlen(query);
+	}
+	return strnlen(query, nByte);
+}
+
+//----------------------------------------------------------------------
+
+inline size_t StatementCache::sqlBytes(UTF16 query, int nByte){
+	const char16_t* str=static_cast<const char16_t*>(query);
+	size_t n=0;
+	size_t maxChars=nByte<0 ? static_cast<size_t>(-1) : static_cast<size_t>(nByte)/2;
+	while(n<maxChars && str[n]!=0){
+		n++;
+	}
+	return 2*n;
+}
+
+//----------------------------------------------------------------------
+
+constexpr size_t StatementCache::sqlHash(std::string_view sql){
+	unsigned long long h=0xcbf29ce484222325ULL;
+	for(char c : sql){
+		h^=static_cast<unsigned char>(c);
+		h*=0x100000001b3ULL;
+	}
+	return static_cast<size_t>(h);
+}
+
+//----------------------------------------------------------------------
+
+inline size_t StatementCache::keyHash(size_t h, unsigned int prepFlags, bool isUTF8){
+	return h ^ ((static_cast<size_t>(prepFlags)<<1 | static_cast<size_t>(isUTF8)) + 0x9e3779b97f4a7c15ULL + (h<<6) + (h>>2));
+}
+
+//----------------------------------------------------------------------
+
+template<typename UTF, typename P>
+int StatementCache::acquire(UTF query, sqlite3_stmt** ppStmt, P& qParams, Entry*& entry){
+	static_assert(DB_CONNECT<UTF>::is_valid, "parameter query should be const char* or const void*");
+	static_assert(IS_QParam<P>::is_valid, "qParams should be QParams or unsigned int");
+
+	entry=nullptr;
+	if(m_capacity==0){
+		return sqlite3Prepare(m_DB, query, ppStmt, qParams);
+	}
+
+	unsigned int prepFlags;
+	int nByte;
+	size_t textHash=0;
+	if constexpr(std::is_same<P, QParams>::value){
+		if(qParams.m_pzTail){
+			return sqlite3Prepare(m_DB, query, ppStmt, qParams);
+		}
+		prepFlags=qParams.m_prepFlags;
+		nByte=qParams.m_nByte;
+		if constexpr(DB_CONNECT<UTF>::is_utf8){
+			textHash=qParams.m_sqlHash;
+		}
+	}
+	else{
+		prepFlags=qParams;
+		nByte=-1;
+	}
+
+	std::string_view sql;
+	if(textHash!=0){
+		// a sql_literal: nByte counts the nul terminator
+		sql=std::string_view(static_cast<const char*>(static_cast<const void*>(query)), nByte>0 ? nByte-1 : 0);
+	}
+	else{
+		sql=std::string_view(static_cast<const char*>(static_cast<const void*>(query)), sqlBytes(query, nByte));
+		textHash=sqlHash(sql);
+	}
+	const bool isUTF8=DB_CONNECT<UTF>::is_utf8;
+	const size_t hash=keyHash(textHash, prepFlags, isUTF8);
+
+	auto range=m_index.equal_range(hash);
+	for(auto it=range.first; it!=range.second; ++it){
+		Entry* cached=it->second;
+		if(cached->prepFlags==prepFlags && cached->isUTF8==isUTF8 && cached->sql==sql){
+			m_index.erase(it);
+			m_inUse.splice(m_inUse.begin(), m_idle, cached->self);
+			m_hits++;
+			*ppStmt=cached->statement;
+			entry=cached;
+			return SQLITE_OK;
+		}
+	}
+
+	m_misses++;
+	int rc=sqlite3Prepare(m_DB, query, ppStmt, qParams);
+	if(rc!=SQLITE_OK || *ppStmt==nullptr){
+		return rc;
+	}
+
+	m_inUse.push_front(Entry{std::string(sql), hash, prepFlags, isUTF8, *ppStmt, ColumnIndex(), {}});
+	m_inUse.front().self=m_inUse.begin();
+	entry=&m_inUse.front();
+
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementCache::release(sqlite3_stmt* statement, Entry* entry){
+	if(!entry){
+		sqlite3_finalize(statement);
+		return;
+	}
+
+	int rc=sqlite3_reset(entry->statement);
+	if(rc==SQLITE_SCHEMA || m_capacity==0){
+		sqlite3_finalize(entry->statement);
+		m_inUse.erase(entry->self);
+		return;
+	}
+	sqlite3_clear_bindings(entry->statement);
+
+	m_idle.splice(m_idle.begin(), m_inUse, entry->self);
+	m_index.emplace(entry->hash, entry);
+	evict();
+}
+
+//----------------------------------------------------------------------
+
+inline int StatementCache::reprepare(Entry* entry){
+	sqlite3_stmt* statement=nullptr;
+	int rc;
+	int nByte=static_cast<int>(entry->sql.size());
+	QParams qParams(nByte, entry->isUTF8, entry->prepFlags);
+	if(entry->isUTF8){
+		rc=sqlite3Prepare(m_DB, entry->sql.c_str(), &statement, qParams);
+	}
+	else{
+		rc=sqlite3Prepare(m_DB, static_cast<UTF16>(entry->sql.c_str()), &statement, qParams);
+	}
+
+	if(rc!=SQLITE_OK){
+		sqlite3_finalize(statement);
+		return rc;
+	}
+
+	sqlite3_reset(entry->statement);
+	sqlite3_transfer_bindings(entry->statement, statement);
+	sqlite3_finalize(entry->statement);
+	entry->statement=statement;
+	entry->columns.clear();
+	m_reprepares++;
+
+	return SQLITE_OK;
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementCache::unindex(Entry* entry){
+	auto range=m_index.equal_range(entry->hash);
+	for(auto it=range.first; it!=range.second; ++it){
+		if(it->second==entry){
+			m_index.erase(it);
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementCache::evict(){
+	while(m_idle.size()>m_capacity){
+		Entry* last=&m_idle.back();
+		unindex(last);
+		sqlite3_finalize(last->statement);
+		m_idle.pop_back();
+		m_evictions++;
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementCache::clear(){
+	for(Entry& entry : m_idle){
+		sqlite3_finalize(entry.statement);
+	}
+	m_idle.clear();
+	m_index.clear();
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementCache::setCapacity(size_t capacity){
+	m_capacity=capacity;
+	evict();
+}
+
+//----------------------------------------------------------------------
+
+inline size_t StatementCache::capacity() const{
+	return m_capacity;
+}
+
+//----------------------------------------------------------------------
+
+inline StatementCache::Stats StatementCache::stats() const{
+	return Stats{m_hits, m_misses, m_evictions, m_reprepares, m_idle.size(), m_capacity};
+}
+
+#endif
@@ -0,0 +1,248 @@
+/*********************************************************************
+* StatementProfiler class                                            *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_STATEMENT_STATS_H
+#define SQLITE_STATEMENT_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sqlite3.h>
+
+//######################################################################
+
+/**
+ * Runtime statistics of all the executions of one SQL statement.
+ *
+ * The counters come from sqlite3_stmt_status, accumulated over all the
+ * executions, except memUsed which is the largest value seen.
+ */
+struct StatementStats
+{
+	std::string sql;          // normalized SQL text
+	uint64_t calls;
+	uint64_t rows;            // rows returned
+	double totalTime;         // seconds
+	double minTime;
+	double maxTime;
+	uint64_t fullscanSteps;   // SQLITE_STMTSTATUS_FULLSCAN_STEP
+	uint64_t sorts;           // SQLITE_STMTSTATUS_SORT
+	uint64_t autoIndexes;     // SQLITE_STMTSTATUS_AUTOINDEX
+	uint64_t vmSteps;         // SQLITE_STMTSTATUS_VM_STEP
+	uint64_t reprepares;      // SQLITE_STMTSTATUS_REPREPARE
+	uint64_t memUsed;         // SQLITE_STMTSTATUS_MEMUSED, bytes
+
+	double meanTime() const{
+		return calls>0 ? totalTime/calls : 0.0;
+	}
+};
+
+//######################################################################
+
+/**
+ * Collects StatementStats per normalized SQL text from the
+ * SQLITE_TRACE_STMT, SQLITE_TRACE_ROW and SQLITE_TRACE_PROFILE events of
+ * a connection.
+ *
+ * SQLITE_TRACE_STMT marks the start of an execution and
+ * SQLITE_TRACE_PROFILE its end, when the statement finishes or is reset
+ * before finishing; the time is measured between both with a steady
+ * clock, as the time reported by SQLITE_TRACE_PROFILE only has the
+ * resolution of the VFS clock (milliseconds). The sqlite3_stmt_status
+ * counters are read and reset at the end, so every execution of a
+ * statement kept in the statement cache is counted on its own.
+ *
+ * @see SQLiteDB::enableStatementStats
+ */
+
+class StatementProfiler
+{
+	public:
+		StatementProfiler();
+
+		/**
+		 * SQLITE_TRACE_STMT event, statement starts running.
+		 */
+		void onStart(sqlite3_stmt* statement);
+
+		/**
+		 * SQLITE_TRACE_ROW event, a row of statement is ready.
+		 */
+		void onRow(sqlite3_stmt* statement);
+
+		/**
+		 * SQLITE_TRACE_PROFILE event, statement finished after
+		 * nanoseconds according to SQLite (only used if the start
+		 * was not seen).
+		 */
+		void onProfile(sqlite3_stmt* statement, uint64_t nanoseconds);
+
+		/**
+		 * The statistics collected so far, by total time descending.
+		 */
+		std::vector<StatementStats> report() const;
+
+		void reset();
+
+		/**
+		 * Normalize sql so executions that only differ in literal values
+		 * or whitespace are counted together: runs of whitespace become a
+		 * single space, string and numeric literals become '?'.
+		 */
+		static std::string normalize(const char* sql);
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Execution
+		{
+			Clock::time_point start;
+			uint64_t rows;
+		};
+
+		std::unordered_map<std::string, StatementStats> m_stats;
+		std::unordered_map<sqlite3_stmt*, Execution> m_running;
+		// most of the rows come from the same statement in a row
+		sqlite3_stmt* m_lastStatement;
+		Execution* m_lastExecution;
+};
+
+//----------------------------------------------------------------------
+
+inline StatementProfiler::StatementProfiler()
+:m_lastStatement(nullptr),
+m_lastExecution(nullptr)
+{}
+
+//----------------------------------------------------------------------
+
+inline void StatementProfiler::onStart(sqlite3_stmt* statement){
+	// raised again for each trigger the statement fires: keep the first
+	m_running.emplace(statement, Execution{Clock::now(), 0});
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementProfiler::onRow(sqlite3_stmt* statement){
+	if(statement!=m_lastStatement){
+		m_lastStatement=statement;
+		m_lastExecution=&m_running.emplace(statement, Execution{Clock::now(), 0}).first->second;
+	}
+	m_lastExecution->rows++;
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementProfiler::onProfile(sqlite3_stmt* statement, uint64_t nanoseconds){
+	uint64_t rows=0;
+	std::unordered_map<sqlite3_stmt*, Execution>::iterator it=m_running.find(statement);
+	if(it!=m_running.end()){
+		rows=it->second.rows;
+		nanoseconds=std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now()-it->second.start).count();
+		m_running.erase(it);
+		m_lastStatement=nullptr;
+	}
+
+	std::string sql=normalize(sqlite3_sql(statement));
+	StatementStats& stats=m_stats[sql];
+	double seconds=nanoseconds/1e9;
+	if(stats.calls==0){
+		stats.sql=std::move(sql);
+		stats.minTime=seconds;
+	}
+	stats.calls++;
+	stats.rows+=rows;
+	stats.totalTime+=seconds;
+	stats.minTime=std::min(stats.minTime, seconds);
+	stats.maxTime=std::max(stats.maxTime, seconds);
+	stats.fullscanSteps+=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+	stats.sorts+=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_SORT, 1);
+	stats.autoIndexes+=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+	stats.vmSteps+=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_VM_STEP, 1);
+	stats.reprepares+=sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_REPREPARE, 1);
+	stats.memUsed=std::max<uint64_t>(stats.memUsed, sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_MEMUSED, 0));
+}
+
+//----------------------------------------------------------------------
+
+inline std::vector<StatementStats> StatementProfiler::report() const{
+	std::vector<StatementStats> result;
+	result.reserve(m_stats.size());
+	for(const auto& entry : m_stats){
+		result.push_back(entry.second);
+	}
+	std::sort(result.begin(), result.end(), [](const StatementStats& a, const StatementStats& b){
+		return a.totalTime>b.totalTime;
+	});
+	return result;
+}
+
+//----------------------------------------------------------------------
+
+inline void StatementProfiler::reset(){
+	m_stats.clear();
+	m_running.clear();
+	m_lastStatement=nullptr;
+}
+
+//----------------------------------------------------------------------
+
+inline std::string StatementProfiler::normalize(const char* sql){
+	std::string normalized;
+	if(!sql){
+		return normalized;
+	}
+	const unsigned char* c=reinterpret_cast<const unsigned char*>(sql);
+	while(*c){
+		if(std::isspace(*c)){
+			while(std::isspace(*c)){
+				c++;
+			}
+			if(!normalized.empty() && *c){
+				normalized+=' ';
+			}
+		}
+		else if(*c=='\''){
+			// '' inside a literal is an escaped quote
+			c++;
+			while(*c && !(*c=='\'' && c[1]!='\'')){
+				c+=(*c=='\'') ? 2 : 1;
+			}
+			if(*c){
+				c++;
+			}
+			normalized+='?';
+		}
+		else if(std::isdigit(*c) && (normalized.empty() || !(std::isalnum(static_cast<unsigned char>(normalized.back())) || normalized.back()=='_' || normalized.back()=='$'))){
+			while(std::isalnum(*c) || *c=='.'){
+				c++;
+			}
+			normalized+='?';
+		}
+		else if(*c=='"' || *c=='`' || *c=='['){
+			// quoted identifiers are kept as they are
+			unsigned char close=(*c=='[') ? ']' : *c;
+			normalized+=*c++;
+			while(*c && *c!=close){
+				normalized+=*c++;
+			}
+			if(*c){
+				normalized+=*c++;
+			}
+		}
+		else{
+			normalized+=*c++;
+		}
+	}
+	return normalized;
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*********************************************************************
+* Transaction class                                                  *
+* Savepoint class                                                    *
+*                                                                    *
+* Version: 2.0                                                       *
+* Date:    16-10-2021                                                *
+* Author:  Dan Machado                                               *                                         *
+**********************************************************************/
+#ifndef SQLITE_TRANSACTION_H
+#define SQLITE_TRANSACTION_H
+
+#include <exception>
+#include <string>
+#include <sqlite3.h>
+
+#include "sqlite_db.h"
+
+//######################################################################
+
+/**
+ * Scope guard for a transaction.
+ * 
+ * The transaction starts in the constructor and, unless 
+ * Transaction::commit or Transaction::rollback are called before, 
+ * it is committed when the guard goes out of scope, or rolled back if 
+ * the scope is left because of an exception.
+ * 
+ * Example:
+ * {
+ *     Transaction transaction(dbConnection, TransactionMode::Immediate);
+ *     dbConnection.executeSecureQueryNf("insert into COMPANY(ID, Name) values (?,?)", 41, "name");
+ *     dbConnection.executeSecureQueryNf("update COMPANY set Age=? where ID=?", 30, 41);
+ * } // COMMIT
+ */
+
+class Transaction
+{
+	public:
+		/**
+		 * @param db the connection
+		 * @param mode DEFERRED, IMMEDIATE or EXCLUSIVE
+		 * @throws const char* if the transaction cannot be started.
+		 */
+		explicit Transaction(SQLiteDB& db, TransactionMode mode=TransactionMode::Deferred);
+
+		~Transaction();
+
+		Transaction(const Transaction&)=delete;
+		Transaction& operator=(const Transaction&)=delete;
+
+		/**
+		 * Commit the transaction.
+		 * 
+		 * @return SQLITE_OK or the error code, in which case the 
+		 *     transaction is still active.
+		 */
+		int commit();
+
+		/**
+		 * Roll back the transaction.
+		 * 
+		 * @return SQLITE_OK or the error code.
+		 */
+		int rollback();
+
+		/**
+		 * Returns true until the transaction is committed or rolled back.
+		 */
+		bool active() const;
+
+	private:
+		SQLiteDB& m_db;
+		int m_uncaughtExceptions;
+		bool m_active;
+};
+
+//----------------------------------------------------------------------
+
+inline Transaction::Transaction(SQLiteDB& db, TransactionMode mode)
+:m_db(db),
+m_uncaughtExceptions(std::uncaught_exceptions()),
+m_active(false)
+{
+	if(m_db.beginTransaction(mode)!=SQLITE_OK){
+		throw m_db.lastErrorMsg();
+	}
+	m_active=true;
+}
+
+//----------------------------------------------------------------------
+
+inline Transaction::~Transaction(){
+	if(!m_active){
+		return;
+	}
+	if(std::uncaught_exceptions()>m_uncaughtExceptions || commit()!=SQLITE_OK){
+		rollback();
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline int Transaction::commit(){
+	int rc=m_db.commitTransaction();
+	if(rc==SQLITE_OK){
+		m_active=false;
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+inline int Transaction::rollback(){
+	m_active=false;
+	return m_db.rollbackTransaction();
+}
+
+//----------------------------------------------------------------------
+
+inline bool Transaction::active() const{
+	return m_active;
+}
+
+//######################################################################
+
+/**
+ * Scope guard for a savepoint, it can be nested in other savepoints 
+ * or in a Transaction.
+ * 
+ * On scope exit the savepoint is released, or rolled back to (and then 
+ * released) if the scope is left because of an exception. Outside of a 
+ * transaction the outermost savepoint behaves as BEGIN DEFERRED.
+ * 
+ * Savepoints are named after their nesting depth, so the SAVEPOINT, 
+ * RELEASE and ROLLBACK TO statements are taken from the statement cache.
+ */
+
+class Savepoint
+{
+	public:
+		/**
+		 * @param db the connection
+		 * @throws const char* if the savepoint cannot be created.
+		 */
+		explicit Savepoint(SQLiteDB& db);
+
+		~Savepoint();
+
+		Savepoint(const Savepoint&)=delete;
+		Savepoint& operator=(const Savepoint&)=delete;
+
+		/**
+		 * Release the savepoint, committing its changes into the 
+		 * enclosing transaction (or the database for the outermost).
+		 * 
+		 * @return SQLITE_OK or the error code.
+		 */
+		int release();
+
+		/**
+		 * Undo the changes done since the savepoint was created and 
+		 * release it.
+		 * 
+		 * @return SQLITE_OK or the error code.
+		 */
+		int rollback();
+
+		/**
+		 * Returns true until the savepoint is released or rolled back.
+		 */
+		bool active() const;
+
+	private:
+		SQLiteDB& m_db;
+		std::string m_name;
+		int m_uncaughtExceptions;
+		bool m_active;
+
+		int run(const char* command);
+};
+
+//----------------------------------------------------------------------
+
+inline Savepoint::Savepoint(SQLiteDB& db)
+:m_db(db),
+m_name("sqlite_db_sp"+std::to_string(db.m_savepointDepth)),
+m_uncaughtExceptions(std::uncaught_exceptions()),
+m_active(false)
+{
+	if(run("SAVEPOINT ")!=SQLITE_OK){
+		throw m_db.lastErrorMsg();
+	}
+	m_db.m_savepointDepth++;
+	m_active=true;
+}
+
+//----------------------------------------------------------------------
+
+inline Savepoint::~Savepoint(){
+	if(!m_active){
+		return;
+	}
+	if(std::uncaught_exceptions()>m_uncaughtExceptions || release()!=SQLITE_OK){
+		rollback();
+	}
+}
+
+//----------------------------------------------------------------------
+
+inline int Savepoint::run(const char* command){
+	std::string sql(command);
+	sql+=m_name;
+	return m_db.runStatement(sql.c_str());
+}
+
+//----------------------------------------------------------------------
+
+inline int Savepoint::release(){
+	int rc=run("RELEASE ");
+	if(rc==SQLITE_OK){
+		m_active=false;
+		m_db.m_savepointDepth--;
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+inline int Savepoint::rollback(){
+	int rc=run("ROLLBACK TO ");
+	if(rc==SQLITE_OK){
+		rc=run("RELEASE ");
+	}
+	if(m_active){
+		m_active=false;
+		m_db.m_savepointDepth--;
+	}
+	return rc;
+}
+
+//----------------------------------------------------------------------
+
+inline bool Savepoint::active() const{
+	return m_active;
+}
+
+#endif
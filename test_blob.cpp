@@ -7,8 +7,13 @@
 #include <locale>
 #include <string>
 #include "sqlite_db.h"
+#include "sqlite_transaction.h"
+#include "sqlite_db_pool.h"
+#include "sqlite_async_db.h"
+#include "sqlite_memory_config.h"
 
 #include <fstream>
+#include <thread>
 
 #include <cassert>
 //######################################################################
@@ -30,6 +35,12 @@ COMPANY table schema:
 
 int main() {
 
+	// the SQLite allocator and page cache are replaced before the first 
+	// connection is opened, see Example 28
+	MemoryConfig memoryConfig;
+	memoryConfig.arenaPages=2048;
+	int memoryInstalled=SQLiteMemory::install(memoryConfig);
+
 	SQLiteDB dbConnection("database_test.db");
 
 	std::cout<<"* * * * * * * Example 1* * * * * * *\n";
@@ -48,18 +59,11 @@ int main() {
 
 	const char* pictureIn="tree.jpg";
 	const char* pictureOut="tree_output.jpg";
-	std::ifstream infile(pictureIn, std::ios::in|std::ios::binary|std::ios::ate);
-	std::ofstream outfile(pictureOut, std::ios::out|std::ios::binary);
-
-	if (infile.is_open()){
-		int size = infile.tellg();
-		char* memblock = new char[size];
+	// the file is bound straight from its memory mapping (SQLITE_STATIC)
+	MappedFile picture(pictureIn);
 
-		infile.seekg(0, std::ios::beg); 
-		infile.read(memblock, size); 
-		infile.close(); 
-
-		SqlRows rows2=dbConnection.executeSecureQuery(0, "update COMPANY set Data=? where ID=?", blob(reinterpret_cast<const void*>(memblock), size, SQLITE_TRANSIENT), 5);
+	if (picture.isOpen()){
+		SqlRows rows2=dbConnection.executeSecureQuery(0, "update COMPANY set Data=? where ID=?", picture.asBlob(), 5);
 		if(dbConnection.dataChanged()){
 			std::cout<<"Record updated!\n";
 
@@ -69,15 +73,12 @@ int main() {
 			while(rows.yield()){
 				std::cout<<"ID: "<<rows.as_int("ID")<<" | Name: "<<rows.as_text("Name")<<" | utf16: "<<reinterpret_cast<const char*>(rows.as_text("utf16"))<<"\n";
 				std::cout<<"size: "<<rows.as_bytes("Data")<<"\n";
-				int fileSize=rows.as_bytes("Data");
-				outfile.write(static_cast<const char*>(rows.as_blob("Data")), fileSize);
-				outfile.close();
+				rows.exportBlob("Data", pictureOut);
 			}
 		}
 		else{
 			std::cout<<dbConnection.lastErrorMsg()<<"?\n";
 		}
-		delete[] memblock;
 	}
 
 	std::cout<<"\n* * * * * * * Example 3* * * * * * *\n";
@@ -131,10 +132,484 @@ int main() {
 	}
 
 	std::cout<<"Tail: "<<query5<<"\n";
-	
 
+	std::cout<<"\n* * * * * * * Example 8* * * * * * *\n";
+	int rowid;
+	if(dbConnection.uniqueAsInt("select rowid from COMPANY where ID='6'", rowid)){
+		// tree.jpg is streamed in chunks, never loaded whole in memory
+		if(dbConnection.importBlob("COMPANY", "Data", rowid, pictureIn)==SQLITE_OK){
+			BlobStream blob=dbConnection.openBlob("COMPANY", "Data", rowid);
+			std::cout<<"size: "<<blob.size()<<"\n";
+			BlobIStream blobIn(blob);
+			char header[2];
+			blobIn.read(header, 2);
+			std::cout<<"JPEG: "<<std::boolalpha<<(header[0]=='\xFF' && header[1]=='\xD8')<<"\n";
+
+			if(dbConnection.exportBlob("COMPANY", "Data", rowid, "tree_output2.jpg")==SQLITE_OK){
+				std::cout<<"Blob exported!\n";
+			}
+		}
+		else{
+			std::cout<<dbConnection.lastErrorMsg()<<"?\n";
+		}
+	}
+
+	std::cout<<"\n* * * * * * * Example 9* * * * * * *\n";
+	// the second run of the same query takes its statement from the cache
+	StatementCache::Stats cacheBefore=dbConnection.statementCacheStats();
+	for(int i=0; i<2; i++){
+		dbConnection.uniqueAsString("select Name from COMPANY where ID='7'", resultName);
+	}
+	StatementCache::Stats cacheAfter=dbConnection.statementCacheStats();
+	std::cout<<"Name: "<<resultName<<" | hits: "<<cacheAfter.hits-cacheBefore.hits<<" | misses: "<<cacheAfter.misses-cacheBefore.misses<<"\n";
+
+	std::cout<<"\n* * * * * * * Example 10* * * * * * *\n";
+	// the names are looked up once, before the loop
+	SqlRows rows4=dbConnection.getResultRows("select ID, Name, Age from COMPANY where ID>'25' and ID<'29'");
+	ColumnRef idColumn=rows4.column("ID");
+	ColumnRef ageColumn=rows4.column("Age");
+	while(rows4.yield()){
+		std::cout<<"ID: "<<rows4.as_int(idColumn)<<" | Age: "<<rows4.as_int(ageColumn)<<"\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 11* * * * * * *\n";
+	// a temporary table, database_test.db is left as it is
+	dbConnection.executeQuery("create temp table PHONE(ID INT PRIMARY KEY, Number TEXT)");
+	std::vector<std::tuple<int, std::string>> phones;
+	for(int i=0; i<1000; i++){
+		phones.emplace_back(i, "555-"+std::to_string(1000+i));
+	}
+	BatchResult batch=dbConnection.executeMany("insert into PHONE values (?,?)", phones, 300);
+	int phoneCount=0;
+	dbConnection.uniqueAsInt("select count(*) from PHONE", phoneCount);
+	std::cout<<"rows: "<<batch.rows<<" | errorCode: "<<batch.errorCode<<" | count: "<<phoneCount<<"\n";
+
+	// the second batch fails on a duplicate key: its rows since the last chunk are rolled back
+	batch=dbConnection.executeMany("insert into PHONE values (?,?)", std::vector<std::tuple<int, std::string>>{{2000, "555-0"}, {2001, "555-1"}, {5, "555-2"}});
+	dbConnection.uniqueAsInt("select count(*) from PHONE", phoneCount);
+	std::cout<<"rows: "<<batch.rows<<" | errorCode: "<<batch.errorCode<<" | count: "<<phoneCount<<"\n";
+
+	std::cout<<"\n* * * * * * * Example 12* * * * * * *\n";
+	try{
+		Transaction transaction(dbConnection, TransactionMode::Immediate);
+		dbConnection.executeSecureQueryNf("update PHONE set Number=? where ID=?", "555-7777", 7);
+		try{
+			Savepoint savepoint(dbConnection);
+			dbConnection.executeQuery("delete from PHONE");
+			throw "changed my mind";
+		}
+		catch(const char* reason){
+			// the savepoint was rolled back, the update is still there
+			std::cout<<"Savepoint: "<<reason<<"\n";
+		}
+	}
+	catch(const char* error){
+		std::cout<<error<<"?\n";
+	}
+	std::string phone;
+	dbConnection.uniqueAsInt("select count(*) from PHONE", phoneCount);
+	dbConnection.uniqueAsString("select Number from PHONE where ID=7", phone);
+	std::cout<<"count: "<<phoneCount<<" | Number: "<<phone<<" | inTransaction: "<<dbConnection.inTransaction()<<"\n";
+
+	std::cout<<"\n* * * * * * * Example 13* * * * * * *\n";
+	// the pool switches its database to WAL, so it gets a file of its own
+	const std::string poolFile="pool_test.db";
+	std::remove(poolFile.c_str());
+	{
+		SQLiteDB poolDB(poolFile.c_str(), SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+		poolDB.executeQuery("create table PHONE(ID INT PRIMARY KEY, Number TEXT)");
+		poolDB.executeMany("insert into PHONE values (?,?)", phones);
+	}
+	try{
+		SQLiteDBPool pool(poolFile.c_str(), 2);
+		{
+			SQLiteDBPool::ReadLease reader1=pool.acquireReader();
+			{
+				SQLiteDBPool::ReadLease reader2=pool.acquireReader();
+				// both readers are leased
+				std::cout<<"lease after timeout: "<<static_cast<bool>(pool.acquireReader(std::chrono::milliseconds(20)))<<"\n";
+			}
+			std::cout<<"lease after release: "<<static_cast<bool>(pool.acquireReader(std::chrono::milliseconds(20)))<<"\n";
+
+			// acquireReader sleeps until the other thread releases its lease
+			SQLiteDBPool::ReadLease reader2=pool.acquireReader();
+			std::thread holder([lease=std::move(reader2)]() mutable{
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				SQLiteDBPool::ReadLease released(std::move(lease));
+			});
+			SQLiteDBPool::ReadLease reader3=pool.acquireReader();
+			holder.join();
+			reader3->uniqueAsInt("select count(*) from PHONE", phoneCount);
+			std::cout<<"count: "<<phoneCount<<"\n";
+		}
+
+		std::atomic<long long> scanned(0);
+		int rc=pool.parallelScan("PHONE", "ID", nullptr, 2, [&scanned](SqlRows&){
+			scanned++;
+		});
+		std::cout<<"parallelScan: "<<rc<<" | rows: "<<scanned<<"\n";
+		std::vector<std::tuple<int, std::string>> evenPhones;
+		{
+			// the scan runs on the reader not held here
+			SQLiteDBPool::ReadLease held=pool.acquireReader();
+			rc=pool.parallelScanOrdered<int, std::string>("ID, Number", "PHONE", "ID", "ID%2=0", 2, evenPhones);
+		}
+		std::cout<<"parallelScanOrdered: "<<rc<<" | rows: "<<evenPhones.size()<<" | last: "<<std::get<1>(evenPhones.back())<<"\n";
+		{
+			// SQLITE_BUSY unless SQLITE_ENABLE_SNAPSHOT: the scan would lock the writer again
+			SQLiteDBPool::WriteLease writer=pool.acquireWriter();
+			rc=pool.parallelScan("PHONE", "ID", nullptr, 2, [](SqlRows&){});
+			std::cout<<"parallelScan holding the writer: "<<rc<<"\n";
+		}
+	}
+	catch(const char* error){
+		std::cout<<error<<"?\n";
+	}
+	for(std::string suffix : {"", "-wal", "-shm"}){
+		std::remove((poolFile+suffix).c_str());
+	}
+
+	std::cout<<"\n* * * * * * * Example 14* * * * * * *\n";
+	for(auto [id, name, salary] : dbConnection.query<int, std::string, double>("select ID, Name, Salary from COMPANY where ID<?", 3)){
+		std::cout<<"ID: "<<id<<" | Name: "<<name<<" | Salary: "<<salary<<"\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 15* * * * * * *\n";
+	// views over the memory of SQLite, valid until the next yield
+	SqlRows rows5=dbConnection.getResultRows("select Name, utf16, Data from COMPANY where ID='5'");
+	while(rows5.yield()){
+		std::string_view name=rows5.as_string_view("Name");
+		std::u16string_view utf16=rows5.as_u16string_view("utf16");
+#ifdef __cpp_lib_span
+		size_t dataBytes=rows5.as_span("Data").size();
+#else
+		size_t dataBytes=rows5.as_bytes("Data");
+#endif
+		std::cout<<"Name: "<<name<<" ("<<name.size()<<") | utf16: "<<utf16.size()<<" code units | Data: "<<dataBytes<<" bytes\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 16* * * * * * *\n";
+	ColumnBatch columns;
+	SqlRows rows6=dbConnection.getResultRows("select ID, Salary from COMPANY where ID<'10'");
+	double totalSalary=0;
+	while(rows6.fetchColumns(columns, 4)>0){
+		for(size_t i=0; i<columns.rows(); i++){
+			totalSalary+=columns.column(1).reals[i];
+		}
+	}
+	std::cout<<"Salary: "<<totalSalary<<"\n";
+	// same column names, different types: the batch is set up again
+	SqlRows number=dbConnection.getResultRows("select 1 as v");
+	number.fetchColumns(columns, 1);
+	std::cout<<"v: "<<columns.column(0).integers[0];
+	SqlRows text=dbConnection.getResultRows("select 'abc' as v");
+	text.fetchColumns(columns, 1);
+	std::cout<<" | v: "<<columns.column(0).bytesAt(0)<<" | Bytes: "<<(columns.column(0).kind==ColumnBatch::Kind::Bytes)<<"\n";
+
+	std::cout<<"\n* * * * * * * Example 17* * * * * * *\n";
+	{
+		AsyncSQLiteDB asyncDB(":memory:", SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+		asyncDB.executeSecureQuery("create table NOTE(ID INTEGER PRIMARY KEY, Text TEXT UNIQUE)");
+		// the rows of RETURNING are discarded, the insert still runs
+		std::future<int> inserted=asyncDB.executeSecureQuery("insert into NOTE(Text) values (?) returning ID", "first");
+		std::future<int> duplicate=asyncDB.executeSecureQuery("insert into NOTE(Text) values (?) returning ID", "first");
+		std::future<std::vector<std::tuple<int, std::string>>> returned=asyncDB.query<int, std::string>("insert into NOTE(Text) values (?) returning ID, Text", "second");
+		std::future<std::optional<int>> notes=asyncDB.uniqueAsInt("select count(*) from NOTE");
+		std::cout<<"insert: "<<inserted.get()<<" | duplicate: "<<duplicate.get();
+		for(auto& [id, text] : returned.get()){
+			std::cout<<" | returning ID: "<<id<<" Text: "<<text;
+		}
+		std::cout<<" | count: "<<notes.get().value_or(-1)<<"\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 18* * * * * * *\n";
+#ifdef SQLITE_DB_ROW_STREAM
+	// rows are stepped lazily: take(3) stops the statement after the third even ID
+	for(auto [id, name] : dbConnection.stream<int, std::string>("select ID, Name from COMPANY where ID<?", 30)
+			| std::views::filter([](const auto& row){ return std::get<0>(row)%2==0; })
+			| std::views::take(3)){
+		std::cout<<"ID: "<<id<<" | Name: "<<name<<"\n";
+	}
+#else
+	std::cout<<"SQLiteDB::stream needs C++20 (sqlite_test20)\n";
+#endif
+
+	std::cout<<"\n* * * * * * * Example 19* * * * * * *\n";
+	dbConnection.enableStatementStats(true);
+	int older=0;
+	for(int age : {25, 30, 35}){
+		dbConnection.uniqueAsInt(("select count(*) from COMPANY where Age>"+std::to_string(age)).c_str(), older);
+	}
+	// literals are normalized to '?': the three queries are counted together
+	for(const StatementStats& stats : dbConnection.statementStats()){
+		std::cout<<stats.sql<<" | calls: "<<stats.calls<<" | rows: "<<stats.rows<<" | full scan: "<<(stats.fullscanSteps>0)<<"\n";
+	}
+	dbConnection.enableStatementStats(false);
+	std::cout<<"after disable: "<<dbConnection.statementStats().size()<<"\n";
+
+	std::cout<<"\n* * * * * * * Example 20* * * * * * *\n";
+	{
+		SlowQueryLog::Options slowLog;
+		slowLog.path="slow_query.log";
+		// every statement is slow enough
+		slowLog.threshold=std::chrono::microseconds(0);
+		slowLog.redactParameters=false;
+		std::remove(slowLog.path.c_str());
+		std::cout<<"enabled: "<<dbConnection.enableSlowQueryLog(slowLog)<<"\n";
+		for(auto [count] : dbConnection.query<int>("select count(*) from COMPANY where Name like ?", "P%")){
+			std::cout<<"count: "<<count<<"\n";
+		}
+		dbConnection.disableSlowQueryLog();
+
+		// the log entries, without the time and duration line
+		std::ifstream logFile(slowLog.path);
+		for(std::string line; std::getline(logFile, line);){
+			if(line.compare(0, 4, "sql:")==0 || line.compare(0, 11, "parameters:")==0 || line.compare(0, 2, "  ")==0){
+				std::cout<<line<<"\n";
+			}
+		}
+		logFile.close();
+		std::remove(slowLog.path.c_str());
+	}
+
+	std::cout<<"\n* * * * * * * Example 21* * * * * * *\n";
+#ifdef SQLITE_DB_SQL_LITERAL
+	{
+		constexpr auto byAge="select ID, Name from COMPANY where Age>? and ID<?"_sql;
+		static_assert(decltype(byAge)::parameters==2, "two parameters");
+		std::cout<<"size: "<<byAge.size<<" | parameters: "<<byAge.parameters<<"\n";
+		// a third argument would not compile
+		{
+			SqlRows rows7=dbConnection.executeSecureQueryNf(byAge, 30, 10);
+			while(rows7.yield()){
+				std::cout<<"ID: "<<rows7.as_int("ID")<<" | Name: "<<rows7.as_string_view("Name")<<"\n";
+			}
+		}
+		// rows7 gave its statement back: query<> takes the literal overload
+		// as well, and finds the statement in the cache by its hash
+		StatementCache::Stats before=dbConnection.statementCacheStats();
+		for(auto [id, name] : dbConnection.query<int, std::string>(byAge, 40, 5)){
+			std::cout<<"ID: "<<id<<" | Name: "<<name<<"\n";
+		}
+		std::cout<<"cache hits: "<<dbConnection.statementCacheStats().hits-before.hits<<"\n";
+	}
+#else
+	std::cout<<"\"...\"_sql literals need C++20 (sqlite_test20)\n";
+#endif
+
+	std::cout<<"\n* * * * * * * Example 22* * * * * * *\n";
+	{
+		const std::string profileFile="profile_test.db";
+		std::remove(profileFile.c_str());
+		try{
+			OpenOptions options;
+			options.flags=SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE;
+			options.profile=PerformanceProfile::readHeavy();
+			options.profile.pageSize=8192;
+			SQLiteDB profileDB(profileFile.c_str(), options);
+			PerformanceProfile effective=profileDB.effectiveProfile();
+			std::cout<<"journal_mode: "<<PerformanceProfile::journalModeName(*effective.journalMode)<<" | page_size: "<<*effective.pageSize<<" | differences: "<<profileDB.verifyProfile(options.profile).size()<<"\n";
+
+			// an in-memory database has no WAL
+			OpenOptions memoryOptions;
+			memoryOptions.flags=SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE;
+			memoryOptions.profile.journalMode=JournalMode::WAL;
+			SQLiteDB memoryDB(":memory:", memoryOptions);
+			for(const std::string& difference : memoryDB.verifyProfile(memoryOptions.profile)){
+				std::cout<<difference<<"\n";
+			}
+		}
+		catch(const char* error){
+			std::cout<<error<<"?\n";
+		}
+		for(std::string suffix : {"", "-wal", "-shm"}){
+			std::remove((profileFile+suffix).c_str());
+		}
+	}
+
+	std::cout<<"\n* * * * * * * Example 23* * * * * * *\n";
+	{
+		const std::string memoryFile="memory_test.db";
+		std::remove(memoryFile.c_str());
+		try{
+			std::unique_ptr<SQLiteDB> copy;
+			{
+				SQLiteDB writer(memoryFile.c_str(), SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+				writer.executeQuery("PRAGMA journal_mode=WAL");
+				writer.executeQuery("create table PHONE(ID INT PRIMARY KEY, Number TEXT)");
+				writer.executeMany("insert into PHONE values (?,?)", phones);
+				// the rows are in the -wal file only
+				try{
+					SQLiteDB loaded(memoryFile.c_str(), InMemory::ReadOnly);
+				}
+				catch(const char* error){
+					std::cout<<error<<"\n";
+				}
+				writer.executeQuery("PRAGMA wal_checkpoint(TRUNCATE)");
+				copy.reset(new SQLiteDB(memoryFile.c_str(), InMemory::ReadWrite));
+			}
+			copy->uniqueAsInt("select count(*) from PHONE", phoneCount);
+			std::cout<<"loaded: "<<phoneCount;
+			copy->executeQuery("delete from PHONE where ID>=100");
+			std::cout<<" | serializeTo: "<<copy->serializeTo(memoryFile.c_str());
+			SQLiteDB reloaded(memoryFile.c_str(), InMemory::ReadOnly);
+			reloaded.uniqueAsInt("select count(*) from PHONE", phoneCount);
+			std::cout<<" | reloaded: "<<phoneCount<<"\n";
+		}
+		catch(const char* error){
+			std::cout<<error<<"?\n";
+		}
+		for(std::string suffix : {"", "-wal", "-shm"}){
+			std::remove((memoryFile+suffix).c_str());
+		}
+	}
+
+	std::cout<<"\n* * * * * * * Example 24* * * * * * *\n";
+	{
+		const std::string backupFile="backup_test.db";
+		std::remove(backupFile.c_str());
+		int steps=0;
+		int rc=dbConnection.backupTo(backupFile.c_str(), 1, std::chrono::milliseconds(0), [&steps](const BackupProgress& progress){
+			steps++;
+			return progress.pagesCopied<2;
+		});
+		std::cout<<"cancelled: "<<(rc==SQLITE_ABORT)<<" after "<<steps<<" steps\n";
+		{
+			// the target is locked: the busy steps are reported, and retried until busyTimeout
+			SQLiteDB locker(backupFile.c_str(), SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+			locker.executeQuery("BEGIN EXCLUSIVE");
+			int busySteps=0;
+			rc=dbConnection.backupTo(backupFile.c_str(), 100, std::chrono::milliseconds(0), [&busySteps](const BackupProgress& progress){
+				busySteps=progress.busySteps;
+				return true;
+			}, "main", std::chrono::milliseconds(20));
+			std::cout<<"busy: "<<(rc==SQLITE_BUSY)<<" | retried: "<<(busySteps>1);
+			rc=dbConnection.backupTo(backupFile.c_str(), 100, std::chrono::milliseconds(0), [](const BackupProgress& progress){
+				return progress.busySteps<3;
+			});
+			std::cout<<" | cancelled while busy: "<<(rc==SQLITE_ABORT)<<"\n";
+			locker.executeQuery("ROLLBACK");
+		}
+		rc=dbConnection.backupTo(backupFile.c_str(), 100, std::chrono::milliseconds(0));
+		{
+			SQLiteDB backup(backupFile.c_str(), SQLITE_OPEN_READONLY);
+			int companies=0;
+			backup.uniqueAsInt("select count(*) from COMPANY", companies);
+			std::cout<<"backup: "<<rc<<" | COMPANY rows: "<<companies<<"\n";
+		}
+		std::remove(backupFile.c_str());
+	}
+
+	std::cout<<"\n* * * * * * * Example 25* * * * * * *\n";
+	{
+		struct Mean{ double sum; int n; };
+		// not deterministic: it counts its calls, in a counter owned by the
+		// lambda as it stays registered after this block
+		dbConnection.registerFunction("call_number", [calls=0](int) mutable{ return ++calls; });
+		dbConnection.registerFunction("band", [](int age){ return age/10*10; }, true, true);
+		dbConnection.registerAggregate<Mean>("mean",
+			[](Mean& mean, double salary){ mean.sum+=salary; mean.n++; },
+			[](const Mean& mean){ return mean.n ? std::optional<double>(mean.sum/mean.n) : std::nullopt; });
+
+		bool created=dbConnection.executeQuery("create index temp.PhoneCall on PHONE(call_number(ID))");
+		std::cout<<"index on call_number: "<<created<<" ("<<dbConnection.lastErrorMsg()<<")\n";
+		for(auto [first, second] : dbConnection.query<int, int>("select call_number(0), call_number(0)")){
+			std::cout<<"call_number: "<<first<<", "<<second<<"\n";
+		}
+		created=dbConnection.executeQuery("create index temp.PhoneBand on PHONE(band(ID))");
+		std::cout<<"index on band: "<<created<<"\n";
+		for(auto [band, bands] : dbConnection.query<int, int>("select band(ID), count(*) from PHONE where band(ID)=?", 70)){
+			std::cout<<"band: "<<band<<" | rows: "<<bands<<"\n";
+		}
+		for(auto [band, mean] : dbConnection.query<int, double>("select band(Age), mean(Salary) from COMPANY where Age<40 group by 1")){
+			std::cout<<"band: "<<band<<" | mean Salary: "<<mean<<"\n";
+		}
+		dbConnection.executeQuery("drop index temp.PhoneBand");
+	}
+
+	std::cout<<"\n* * * * * * * Example 26* * * * * * *\n";
+	{
+		struct Extension{ int id; std::string office; double cost; };
+		std::vector<Extension> extensions;
+		for(int i=0; i<1000; i+=5){
+			extensions.push_back(Extension{i, i%2 ? "north" : "south", i/100.0});
+		}
+		// sorted by id: constraints on it are resolved by binary search
+		dbConnection.registerContainer("extensions", extensions,
+			sortedKeyColumn("id", &Extension::id),
+			tableColumn("office", &Extension::office),
+			tableColumn("cost", &Extension::cost));
+		std::vector<int> wanted{7, 10, 15};
+		dbConnection.registerContainer("wanted", wanted, elementColumn<int>("value"));
+
+		for(auto [id, number, office] : dbConnection.query<int, std::string, std::string>("select PHONE.ID, Number, office from PHONE join extensions on extensions.id=PHONE.ID where PHONE.ID in (select value from wanted) order by 1")){
+			std::cout<<"ID: "<<id<<" | Number: "<<number<<" | office: "<<office<<"\n";
+		}
+		for(auto [count, total] : dbConnection.query<int, double>("select count(*), sum(cost) from extensions where id between ? and ?", 100, 200)){
+			std::cout<<"between 100 and 200: "<<count<<" | cost: "<<total<<"\n";
+		}
+		// the vector is read in place: a change is seen by the next query
+		extensions[0].office="west";
+		for(auto [office] : dbConnection.query<std::string>("select office from extensions where id=0")){
+			std::cout<<"office of 0: "<<office<<"\n";
+		}
+		// the vectors end with this block, their tables must go first
+		dbConnection.unregisterContainer("extensions");
+		dbConnection.unregisterContainer("wanted");
+		std::cout<<"extensions after unregisterContainer: "<<dbConnection.executeQuery("select * from extensions")<<"\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 27* * * * * * *\n";
+	{
+		const char* migration="create temp table if not exists NOTE(ID INTEGER PRIMARY KEY, Text TEXT UNIQUE);\n"
+			"insert into NOTE(Text) values ('first'), ('second');\n"
+			"update NOTE set Text=upper(Text);";
+		ScriptResult result=dbConnection.executeScript(migration, true);
+		std::cout<<"ok: "<<result.ok()<<" | statements: "<<result.statements.size()<<" | changes: "<<result.changes<<"\n";
+
+		// the duplicate fails: the whole script is rolled back
+		result=dbConnection.executeScript("insert into NOTE(Text) values ('third');\n"
+			"insert into NOTE(Text) values ('FIRST');", true);
+		const StatementResult& failed=result.statements.back();
+		std::cout<<"ok: "<<result.ok()<<" | rolledBack: "<<result.rolledBack<<" | at offset "<<failed.offset<<": "<<failed.errorMessage<<"\n";
+		dbConnection.uniqueAsInt("select count(*) from NOTE", phoneCount);
+		std::cout<<"NOTE rows: "<<phoneCount<<"\n";
+
+		// without a transaction, the statements after the failed one still run
+		result=dbConnection.executeScript("insert into NOTE(Text) values ('FIRST');\n"
+			"insert into NOTE(Text) values ('third');", false, false);
+		dbConnection.uniqueAsInt("select count(*) from NOTE", phoneCount);
+		std::cout<<"errorCode: "<<result.errorCode<<" | statements: "<<result.statements.size()<<" | NOTE rows: "<<phoneCount<<"\n";
+		dbConnection.executeQuery("drop table temp.NOTE");
+	}
+
+	std::cout<<"\n* * * * * * * Example 28* * * * * * *\n";
+	{
+		// too late once a connection is open
+		int reinstalled=SQLiteMemory::install(memoryConfig);
+		MemoryStats stats=SQLiteMemory::stats();
+		std::cout<<"install: "<<memoryInstalled<<" | again: "<<(reinstalled==SQLITE_MISUSE)<<"\n";
+		std::cout<<"pooled allocations: "<<(stats.poolHits>0)<<" | arena pages: "<<(stats.pageHits>0)<<"\n";
+	}
+
+	std::cout<<"\n* * * * * * * Example 29* * * * * * *\n";
+	{
+		dbConnection.executeQuery("create temp table MIXED(i INT, s TEXT, d REAL, big INT, c TEXT)");
+		// every argument is bound by its BindDataTrait, the std::string without a copy
+		std::string label="label";
+		char buffer[]="buffer";
+		dbConnection.executeSecureQueryNf("insert into MIXED values (?,?,?,?,?)", 42, label, 2.5, sqlite3_int64(1)<<40, buffer);
+		for(auto [i, s, d, big, c] : dbConnection.query<int, std::string, double, sqlite3_int64, std::string>("select * from MIXED")){
+			std::cout<<"i: "<<i<<" | s: "<<s<<" | d: "<<d<<" | big: "<<big<<" | c: "<<c<<"\n";
+		}
+		// binding stops at the first parameter that fails: there is no sixth one
+		dbConnection.executeSecureQueryNf("insert into MIXED values (?,?,?,?,?)", 1, "a", 1.0, sqlite3_int64(1), "b", 6);
+		std::cout<<"extra argument: "<<(dbConnection.lastErrorCode()==SQLITE_RANGE);
+		dbConnection.uniqueAsInt("select count(*) from MIXED", phoneCount);
+		std::cout<<" | MIXED rows: "<<phoneCount<<"\n";
+		dbConnection.executeQuery("drop table temp.MIXED");
+	}
 
-	
 	return 0;
 }
 